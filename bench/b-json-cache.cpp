@@ -0,0 +1,83 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <huse/json/Parser.hpp>
+#include <huse/json/DocumentCache.hpp>
+
+#include <json-test-data.h>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+
+#define PICOBENCH_STD_FUNCTION_BENCHMARKS
+#define PICOBENCH_IMPLEMENT
+#include <picobench/picobench.hpp>
+
+std::string readFile(const char* path) {
+    std::ifstream fin(path);
+    if (!fin) {
+        throw std::runtime_error("Failed to open file: " + std::string(path));
+    }
+    std::string content((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+    return content;
+}
+
+void bench_parse(const char* path, picobench::state& s) {
+    auto content = readFile(path);
+
+    s.start_timer();
+    huse::json::Parser p(content);
+    s.stop_timer();
+
+    s.set_result(p.rootValue().get_length());
+}
+
+void bench_mapped_cache(const std::string& cachePath, picobench::state& s) {
+    s.start_timer();
+    huse::json::MappedDocumentCache cache(cachePath.c_str());
+    huse::json::Parser p(cache.document());
+    s.stop_timer();
+
+    s.set_result(p.rootValue().get_length());
+}
+
+int main(int argc, char* argv[]) {
+    picobench::local_runner r;
+
+    std::string_view files[] = { JSON_TEST_DATA_JSON_FILES };
+
+    std::vector<std::string> cachePaths;
+    cachePaths.reserve(std::size(files));
+
+    for (auto f : files) {
+        auto fname = f.substr(sizeof(JSON_TEST_DATA_DIR));
+
+        auto& cachePath = cachePaths.emplace_back(
+            (std::filesystem::temp_directory_path() / (std::string(fname) + ".huse-cache")).string());
+        {
+            huse::json::Parser p(readFile(f.data()));
+            std::ofstream fout(cachePath, std::ios::binary);
+            huse::json::saveDocumentCache(p, fout);
+        }
+
+        r.set_suite(fname.data());
+        r.add_benchmark("parse", [=](picobench::state& s) {
+            bench_parse(f.data(), s);
+        });
+        r.add_benchmark("mapped cache", [&cachePath](picobench::state& s) {
+            bench_mapped_cache(cachePath, s);
+        });
+    }
+
+    r.set_compare_results_across_samples(true);
+    r.set_compare_results_across_benchmarks(true);
+    r.set_default_state_iterations({1});
+    r.parse_cmd_line(argc, argv);
+    auto ret = r.run();
+
+    for (auto& p : cachePaths) {
+        std::filesystem::remove(p);
+    }
+
+    return ret;
+}
@@ -0,0 +1,200 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+// reports the throughput (json MB/s) and the peak heap memory of writing and reading
+// deflate-compressed json to and from raw buffers
+// * two-step: serialize to a std::string and then compress it,
+//   and decompress to a std::string and then parse it
+// * streaming: serialize through DeflateOutput, and parse with parseCompressed
+// the json is written by transcoding the (minified) input
+// zlib's own state is allocated with malloc and is not counted (it's the same for both)
+//
+#include <huse/json/Serializer.hpp>
+#include <huse/json/SizeSerializer.hpp>
+#include <huse/json/Transcoder.hpp>
+#include <huse/json/Validator.hpp>
+
+#if HUSE_HAS_ZLIB
+#include <huse/json/Deflate.hpp>
+#endif
+
+#include <itlib/mem_streambuf.hpp>
+#include <json-test-data.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <new>
+#include <sstream>
+#include <string_view>
+
+namespace {
+size_t allocated = 0;
+size_t peakAllocated = 0;
+}
+
+// count the heap memory (with the size stored before each block)
+void* operator new(size_t size) {
+    auto p = static_cast<size_t*>(std::malloc(size + sizeof(std::max_align_t)));
+    if (!p) throw std::bad_alloc();
+    *p = size;
+    allocated += size;
+    peakAllocated = std::max(peakAllocated, allocated);
+    return reinterpret_cast<char*>(p) + sizeof(std::max_align_t);
+}
+void operator delete(void* ptr) noexcept {
+    if (!ptr) return;
+    auto p = reinterpret_cast<size_t*>(static_cast<char*>(ptr) - sizeof(std::max_align_t));
+    allocated -= *p;
+    std::free(p);
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete[](void* ptr) noexcept { operator delete(ptr); }
+void operator delete(void* ptr, size_t) noexcept { operator delete(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { operator delete(ptr); }
+
+std::string readFile(const char* path) {
+    std::ifstream fin(path);
+    if (!fin) {
+        throw std::runtime_error("Failed to open file: " + std::string(path));
+    }
+    std::string content((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+    return content;
+}
+
+struct Result {
+    double mbPerSec = 0;
+    size_t peakBytes = 0;
+};
+
+// best of several runs, and the peak memory over what was allocated before them
+template <typename F>
+Result run(size_t bytes, F&& f) {
+    using clock = std::chrono::steady_clock;
+    Result ret;
+    for (int i = 0; i < 10; ++i) {
+        const size_t base = allocated;
+        peakAllocated = base;
+        auto start = clock::now();
+        f();
+        std::chrono::duration<double> t = clock::now() - start;
+        ret.mbPerSec = std::max(ret.mbPerSec, double(bytes) / (1024 * 1024) / t.count());
+        ret.peakBytes = peakAllocated - base;
+    }
+    return ret;
+}
+
+#if HUSE_HAS_ZLIB
+using namespace huse::json;
+
+// compressed output goes to a preallocated raw buffer
+struct RawOutput {
+    std::string buf;
+    impl::FixedBufferStreambuf streambuf;
+    std::ostream stream;
+
+    explicit RawOutput(size_t capacity)
+        : buf(capacity, '\0')
+        , streambuf(buf.data(), buf.size())
+        , stream(&streambuf)
+    {}
+    void reset() { streambuf = impl::FixedBufferStreambuf(buf.data(), buf.size()); }
+    std::string_view compressed() const { return std::string_view(buf.data(), streambuf.written()); }
+};
+
+int main() {
+    std::string_view files[] = { JSON_TEST_DATA_JSON_FILES };
+
+    std::cout << std::left << std::setw(32) << "file"
+        << std::right << std::setw(12) << "json"
+        << std::setw(12) << "deflated"
+        << std::setw(32) << "write MB/s (peak KB)"
+        << std::setw(32) << "read MB/s (peak KB)" << '\n';
+
+    auto print = [](Result twoStep, Result streaming) {
+        std::ostringstream sout;
+        sout << std::fixed << std::setprecision(1)
+            << twoStep.mbPerSec << " (" << twoStep.peakBytes / 1024 << ") / "
+            << streaming.mbPerSec << " (" << streaming.peakBytes / 1024 << ")";
+        std::cout << std::setw(32) << sout.str();
+    };
+
+    for (auto f : files) {
+        auto fname = f.substr(sizeof(JSON_TEST_DATA_DIR));
+        auto content = readFile(f.data());
+        if (!validate(content)) {
+            std::cout << std::left << std::setw(32) << fname << " parse error\n";
+            continue;
+        }
+
+        const auto jsonSize = serializedSize([&](auto& n) { transcode(content, n._s()); });
+
+        // deflate output can be slightly bigger than its input
+        RawOutput twoStepOut(jsonSize + jsonSize / 100 + 1024);
+        auto twoStepWrite = run(jsonSize, [&]() {
+            std::ostringstream json;
+            {
+                JsonSerializer s(json);
+                transcode(content, s);
+            }
+            twoStepOut.reset();
+            DeflateOutput out(twoStepOut.stream);
+            auto str = std::move(json).str();
+            out.stream().write(str.data(), std::streamsize(str.size()));
+            out.finish();
+        });
+
+        RawOutput streamingOut(jsonSize + jsonSize / 100 + 1024);
+        auto streamingWrite = run(jsonSize, [&]() {
+            streamingOut.reset();
+            DeflateOutput out(streamingOut.stream);
+            {
+                JsonSerializer s(out.stream());
+                transcode(content, s);
+            }
+            out.finish();
+        });
+
+        const auto compressed = streamingOut.compressed();
+        if (compressed != twoStepOut.compressed()) {
+            std::cout << std::left << std::setw(32) << fname << " output mismatch\n";
+            continue;
+        }
+
+        auto twoStepRead = run(jsonSize, [&]() {
+            itlib::mem_istreambuf<char> buf(compressed.data(), compressed.size());
+            std::istream in(&buf);
+            InflateInput inflate(in);
+            std::string json;
+            char chunk[64 * 1024];
+            while (auto n = inflate.read(chunk, sizeof(chunk))) {
+                json.append(chunk, n);
+            }
+            Parser p(json);
+        });
+
+        auto streamingRead = run(jsonSize, [&]() {
+            itlib::mem_istreambuf<char> buf(compressed.data(), compressed.size());
+            std::istream in(&buf);
+            parseCompressed(in);
+        });
+
+        std::cout << std::left << std::setw(32) << fname
+            << std::right << std::setw(12) << jsonSize
+            << std::setw(12) << compressed.size();
+        print(twoStepWrite, streamingWrite);
+        print(twoStepRead, streamingRead);
+        std::cout << '\n';
+    }
+    std::cout << "(two-step / streaming)\n";
+
+    return 0;
+}
+#else
+int main() {
+    std::cout << "huse was built without zlib\n";
+    return 0;
+}
+#endif
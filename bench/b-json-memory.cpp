@@ -0,0 +1,99 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+// not a timing benchmark
+// reports the memory footprint of the json AST relative to the input size
+// build with HUSE_JSON_COMPACT_AST to compare the two layouts
+//
+#include <huse/json/Parser.hpp>
+
+#include <json-test-data.h>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <string_view>
+
+namespace sajson = huse::json::sajson;
+
+std::string readFile(const char* path) {
+    std::ifstream fin(path);
+    if (!fin) {
+        throw std::runtime_error("Failed to open file: " + std::string(path));
+    }
+    std::string content((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+    return content;
+}
+
+// number of AST words used by the value and its children
+size_t usedWords(const sajson::value& v) {
+    switch (v.get_type()) {
+    case sajson::TYPE_INTEGER:
+        return sajson::integer_storage::word_length;
+    case sajson::TYPE_DOUBLE:
+        return sajson::double_storage::word_length;
+    case sajson::TYPE_STRING:
+        return 2; // start, end
+    case sajson::TYPE_ARRAY: {
+        if (v.is_lazy()) return 3;
+        const auto len = v.get_length();
+        size_t ret = 1 + len; // length, elements
+        for (size_t i = 0; i < len; ++i) {
+            ret += usedWords(v.get_array_element(i));
+        }
+        return ret;
+    }
+    case sajson::TYPE_OBJECT: {
+        if (v.is_lazy()) return 3;
+        const auto len = v.get_length();
+        size_t ret = 1 + 3 * len; // length, (key start, key end, value) records
+        for (size_t i = 0; i < len; ++i) {
+            ret += usedWords(v.get_object_value(i));
+        }
+        return ret;
+    }
+    default:
+        return 0; // literals are stored in the tag only
+    }
+}
+
+int main() {
+    std::string_view files[] = { JSON_TEST_DATA_JSON_FILES };
+
+    std::cout << "AST word: " << sizeof(sajson::ast_word) << " bytes\n";
+    std::cout << std::left << std::setw(32) << "file"
+        << std::right << std::setw(12) << "input"
+        << std::setw(12) << "allocated"
+        << std::setw(12) << "used"
+        << std::setw(12) << "used/byte" << '\n';
+
+    size_t totalInput = 0, totalUsed = 0;
+    for (auto f : files) {
+        auto fname = f.substr(sizeof(JSON_TEST_DATA_DIR));
+        auto content = readFile(f.data());
+        auto doc = huse::json::Parser::parseDocument(content);
+        if (!doc.is_valid()) {
+            std::cout << std::left << std::setw(32) << fname << " parse error\n";
+            continue;
+        }
+
+        // single allocation: one word per input byte
+        const size_t allocated = content.size() * sizeof(sajson::ast_word);
+        const size_t used = usedWords(doc.get_root()) * sizeof(sajson::ast_word);
+        totalInput += content.size();
+        totalUsed += used;
+
+        std::cout << std::left << std::setw(32) << fname
+            << std::right << std::setw(12) << content.size()
+            << std::setw(12) << allocated
+            << std::setw(12) << used
+            << std::setw(12) << std::fixed << std::setprecision(3) << double(used) / double(content.size())
+            << '\n';
+    }
+
+    if (totalInput) {
+        std::cout << "total used AST bytes per input byte: "
+            << std::fixed << std::setprecision(3) << double(totalUsed) / double(totalInput) << '\n';
+    }
+
+    return 0;
+}
@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: MIT
 //
 #include <huse/json/DeserializerRoot.hpp>
+#include <huse/json/Projection.hpp>
 #include <huse/DeserializerNode.hpp>
 #include <huse/impl/Charconv.hpp>
 
@@ -166,6 +167,31 @@ void bench_huse(picobench::state& s) {
 }
 PICOBENCH(bench_huse);
 
+void bench_huse_projection(picobench::state& s) {
+    // only what parse() reads
+    static const huse::json::Projection proj = {
+        "/ack",
+        "/setSubscriptions",
+        "/setRequestBatch/batchID",
+        "/setRequestBatch/requests/*/min",
+        "/setRequestBatch/requests/*/max",
+        "/ping/payload",
+        "/setInteraction",
+    };
+
+    auto lines = g_lines;
+    result_t res = 0;
+
+    for (auto i : s) {
+        auto& line = lines[i];
+        huse::json::DeserializerRoot d(line.data(), line.size(), huse::json::ParseOptions{.projection = &proj});
+        res += parse(d);
+    }
+
+    s.set_result(picobench::result_t(res));
+}
+PICOBENCH(bench_huse_projection);
+
 ////////////////////////////////////////////////////////////////////////////////
 // boost
 
@@ -3,11 +3,13 @@
 //
 #include <huse/json/DeserializerRoot.hpp>
 #include <huse/DeserializerNode.hpp>
+#include <huse/helpers/StdVector.hpp>
 #include <boost/json.hpp>
 #include <simdjson.h>
 
 #include <json-test-data.h>
 #include <fstream>
+#include <memory_resource>
 
 #define PICOBENCH_STD_FUNCTION_BENCHMARKS
 #define PICOBENCH_IMPLEMENT
@@ -37,6 +39,98 @@ void bench_huse(const char* path, picobench::state& s) {
     }
 }
 
+void bench_huse_lazy_numbers(const char* path, picobench::state& s) {
+    auto content = readFile(path);
+
+    s.start_timer();
+    huse::json::DeserializerRoot d(content, huse::json::ParseOptions{.lazyNumbers = true});
+    s.stop_timer();
+
+    if (d.type().isObject()) {
+        s.set_result(d.obj().size());
+    }
+    else if (d.type().isArray()) {
+        s.set_result(d.ar().size());
+    }
+}
+
+void bench_huse_lazy_strings(const char* path, picobench::state& s) {
+    auto content = readFile(path);
+
+    s.start_timer();
+    huse::json::DeserializerRoot d(content, huse::json::ParseOptions{.lazyStrings = true});
+    s.stop_timer();
+
+    if (d.type().isObject()) {
+        s.set_result(d.obj().size());
+    }
+    else if (d.type().isArray()) {
+        s.set_result(d.ar().size());
+    }
+}
+
+// generic tree of values, to measure allocation with and without a memory resource
+template <bool Pmr>
+struct Value {
+    template <typename T>
+    using Vector = std::conditional_t<Pmr, std::pmr::vector<T>, std::vector<T>>;
+    using String = std::conditional_t<Pmr, std::pmr::string, std::string>;
+
+    String str; // string value
+    double num = 0;
+    Vector<String> keys; // keys of object
+    Vector<Value> items; // values of object or array
+
+    void huseDeserialize(huse::DeserializerNode<huse::json::JsonDeserializer>& n) {
+        auto t = n.type();
+        if (t.isObject()) {
+            auto obj = n.obj();
+            const int len = obj.size();
+            keys.resize(size_t(len));
+            items.resize(size_t(len));
+            for (int i = 0; i < len; ++i) {
+                obj.keyval(keys[i], items[i]);
+            }
+        }
+        else if (t.isArray()) {
+            n.val(items);
+        }
+        else if (t.isString()) {
+            n.val(str);
+        }
+        else if (t.isNumber()) {
+            n.val(num);
+        }
+    }
+};
+
+void bench_huse_values(const char* path, picobench::state& s) {
+    auto content = readFile(path);
+
+    s.start_timer();
+    huse::json::DeserializerRoot d(content);
+    Value<false> v;
+    d.val(v);
+    s.stop_timer();
+
+    s.set_result(v.items.size());
+}
+
+void bench_huse_pmr_values(const char* path, picobench::state& s) {
+    auto content = readFile(path);
+
+    std::pmr::monotonic_buffer_resource mr(5 * content.size());
+
+    s.start_timer();
+    huse::json::DeserializerRoot d(content);
+    d.setMemoryResource(&mr);
+    Value<true> v;
+    d.val(v);
+    s.stop_timer();
+
+    s.set_result(v.items.size());
+}
+
 void bench_boost(const char* path, picobench::state& s) {
     auto content = readFile(path);
 
@@ -81,6 +175,18 @@ int main(int argc, char* argv[]) {
         r.add_benchmark("huse", [=](picobench::state& s) {
             bench_huse(f.data(), s);
         });
+        r.add_benchmark("huse lazy numbers", [=](picobench::state& s) {
+            bench_huse_lazy_numbers(f.data(), s);
+        });
+        r.add_benchmark("huse lazy strings", [=](picobench::state& s) {
+            bench_huse_lazy_strings(f.data(), s);
+        });
+        r.add_benchmark("huse values", [=](picobench::state& s) {
+            bench_huse_values(f.data(), s);
+        });
+        r.add_benchmark("huse pmr values", [=](picobench::state& s) {
+            bench_huse_pmr_values(f.data(), s);
+        });
         r.add_benchmark("boost", [=](picobench::state& s) {
             bench_boost(f.data(), s);
         });
@@ -0,0 +1,108 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+// aggregation over a document: sum of the numbers and number of strings
+//
+#include <huse/json/Parser.hpp>
+#include <huse/json/Sax.hpp>
+
+#include <json-test-data.h>
+#include <fstream>
+#include <cstdint>
+
+#define PICOBENCH_STD_FUNCTION_BENCHMARKS
+#define PICOBENCH_IMPLEMENT
+#include <picobench/picobench.hpp>
+
+namespace sajson = huse::json::sajson;
+
+std::string readFile(const char* path) {
+    std::ifstream fin(path);
+    if (!fin) {
+        throw std::runtime_error("Failed to open file: " + std::string(path));
+    }
+    std::string content((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+    return content;
+}
+
+struct Aggregate {
+    double sum = 0;
+    uintptr_t strings = 0;
+
+    uintptr_t result() const {
+        return uintptr_t(sum) + strings;
+    }
+};
+
+void walk(const sajson::value& v, Aggregate& a) {
+    switch (v.get_type()) {
+    case sajson::TYPE_INTEGER: a.sum += v.get_integer_value(); break;
+    case sajson::TYPE_DOUBLE: a.sum += v.get_double_value(); break;
+    case sajson::TYPE_STRING: ++a.strings; break;
+    case sajson::TYPE_ARRAY:
+        for (size_t i = 0; i < v.get_length(); ++i) {
+            walk(v.get_array_element(i), a);
+        }
+        break;
+    case sajson::TYPE_OBJECT:
+        for (size_t i = 0; i < v.get_length(); ++i) {
+            walk(v.get_object_value(i), a);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void bench_ast(const char* path, picobench::state& s) {
+    auto content = readFile(path);
+
+    Aggregate a;
+    s.start_timer();
+    auto doc = huse::json::Parser::parseDocument(content);
+    walk(doc.get_root(), a);
+    s.stop_timer();
+
+    s.set_result(a.result());
+}
+
+struct AggregateHandler : public huse::json::SaxHandler {
+    Aggregate a;
+    virtual void integerValue(int64_t i) override { a.sum += double(i); }
+    virtual void floatValue(double d) override { a.sum += d; }
+    virtual void stringValue(std::string_view) override { ++a.strings; }
+};
+
+void bench_sax(const char* path, picobench::state& s) {
+    auto content = readFile(path);
+
+    AggregateHandler h;
+    s.start_timer();
+    huse::json::parseSax(content, h);
+    s.stop_timer();
+
+    s.set_result(h.a.result());
+}
+
+int main(int argc, char* argv[]) {
+    picobench::local_runner r;
+
+    std::string_view files[] = { JSON_TEST_DATA_JSON_FILES };
+
+    for (auto f : files) {
+        auto fname = f.substr(sizeof(JSON_TEST_DATA_DIR));
+        r.set_suite(fname.data());
+        r.add_benchmark("ast", [=](picobench::state& s) {
+            bench_ast(f.data(), s);
+        });
+        r.add_benchmark("sax", [=](picobench::state& s) {
+            bench_sax(f.data(), s);
+        });
+    }
+
+    r.set_compare_results_across_samples(true);
+    r.set_compare_results_across_benchmarks(true);
+    r.set_default_state_iterations({1});
+    r.parse_cmd_line(argc, argv);
+    return r.run();
+}
@@ -0,0 +1,83 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+// reports the throughput (input MB/s) of transcoding json to json
+// validation (scanning only) is the upper bound
+//
+#include <huse/json/Serializer.hpp>
+#include <huse/json/Transcoder.hpp>
+#include <huse/json/Validator.hpp>
+
+#include <json-test-data.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string_view>
+
+std::string readFile(const char* path) {
+    std::ifstream fin(path);
+    if (!fin) {
+        throw std::runtime_error("Failed to open file: " + std::string(path));
+    }
+    std::string content((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+    return content;
+}
+
+// best of several runs
+template <typename F>
+double mbPerSec(size_t bytes, F&& f) {
+    using clock = std::chrono::steady_clock;
+    double best = 0;
+    for (int i = 0; i < 10; ++i) {
+        auto start = clock::now();
+        f();
+        std::chrono::duration<double> t = clock::now() - start;
+        const double mbs = double(bytes) / (1024 * 1024) / t.count();
+        if (mbs > best) best = mbs;
+    }
+    return best;
+}
+
+double transcodeMbPerSec(const std::string& content, bool pretty) {
+    std::ostringstream out;
+    return mbPerSec(content.size(), [&]() {
+        out.str({});
+        huse::json::JsonSerializer s(out, pretty);
+        huse::json::transcode(content, s);
+    });
+}
+
+int main() {
+    std::string_view files[] = { JSON_TEST_DATA_JSON_FILES };
+
+    std::cout << std::left << std::setw(32) << "file"
+        << std::right << std::setw(12) << "input"
+        << std::setw(12) << "validate"
+        << std::setw(12) << "minify"
+        << std::setw(12) << "pretty" << "  (MB/s)\n";
+
+    for (auto f : files) {
+        auto fname = f.substr(sizeof(JSON_TEST_DATA_DIR));
+        auto content = readFile(f.data());
+        if (!huse::json::validate(content)) {
+            std::cout << std::left << std::setw(32) << fname << " parse error\n";
+            continue;
+        }
+
+        const double validate = mbPerSec(content.size(), [&]() {
+            huse::json::validate(content);
+        });
+
+        std::cout << std::left << std::setw(32) << fname
+            << std::right << std::setw(12) << content.size()
+            << std::fixed << std::setprecision(1)
+            << std::setw(12) << validate
+            << std::setw(12) << transcodeMbPerSec(content, false)
+            << std::setw(12) << transcodeMbPerSec(content, true)
+            << '\n';
+    }
+
+    return 0;
+}
@@ -0,0 +1,64 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <huse/json/Parser.hpp>
+#include <huse/json/Validator.hpp>
+
+#include <json-test-data.h>
+#include <fstream>
+
+#define PICOBENCH_STD_FUNCTION_BENCHMARKS
+#define PICOBENCH_IMPLEMENT
+#include <picobench/picobench.hpp>
+
+std::string readFile(const char* path) {
+    std::ifstream fin(path);
+    if (!fin) {
+        throw std::runtime_error("Failed to open file: " + std::string(path));
+    }
+    std::string content((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+    return content;
+}
+
+void bench_parse(const char* path, picobench::state& s) {
+    auto content = readFile(path);
+
+    s.start_timer();
+    auto doc = huse::json::Parser::parseDocument(content);
+    s.stop_timer();
+
+    s.set_result(doc.is_valid());
+}
+
+void bench_validate(const char* path, picobench::state& s) {
+    auto content = readFile(path);
+
+    s.start_timer();
+    auto res = huse::json::validate(content);
+    s.stop_timer();
+
+    s.set_result(!!res);
+}
+
+int main(int argc, char* argv[]) {
+    picobench::local_runner r;
+
+    std::string_view files[] = { JSON_TEST_DATA_JSON_FILES };
+
+    for (auto f : files) {
+        auto fname = f.substr(sizeof(JSON_TEST_DATA_DIR));
+        r.set_suite(fname.data());
+        r.add_benchmark("parse", [=](picobench::state& s) {
+            bench_parse(f.data(), s);
+        });
+        r.add_benchmark("validate", [=](picobench::state& s) {
+            bench_validate(f.data(), s);
+        });
+    }
+
+    r.set_compare_results_across_samples(true);
+    r.set_compare_results_across_benchmarks(true);
+    r.set_default_state_iterations({1});
+    r.parse_cmd_line(argc, argv);
+    return r.run();
+}
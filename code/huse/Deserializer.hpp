@@ -4,7 +4,11 @@
 #pragma once
 #include "API.h"
 #include "ImValue.hpp"
+#include "Instrumentation.hpp"
 #include <splat/warnings.h>
+#include <memory_resource>
+#include <vector>
+#include <cstdint>
 
 namespace huse {
 
@@ -16,9 +20,72 @@ DISABLE_MSVC_WARNING(4250)
 
 class HUSE_API Deserializer {
 public:
+#if HUSE_INSTRUMENTATION
+    // virtual bases are constructed first, so this marks the start of parsing
+    Deserializer() : m_constructionStart(impl::InstrClock::now()) {}
+#endif
     virtual ~Deserializer();
 
     virtual ImValue getRootValue() const = 0;
+
+    // values which were skipped by a lazy parse (ImValue::is_lazy) are parsed on first access
+    // parseLazyValue returns the parsed value of v (parsing it if needed)
+    // parsedLazyValue returns the parsed value if v has already been parsed, or v itself otherwise
+    // both return v itself if it's not lazy
+    virtual ImValue parseLazyValue(const ImValue& v) { return v; }
+    virtual ImValue parsedLazyValue(const ImValue& v) const { return v; }
+
+    // memory resource for the empty std::pmr containers and strings which are deserialized
+    // (pmr values which aren't empty or already use a non-default resource are not affected)
+    // null by default, in which case the values are left as they are
+    std::pmr::memory_resource* memoryResource() const noexcept { return m_memoryResource; }
+    void setMemoryResource(std::pmr::memory_resource* resource) noexcept { m_memoryResource = resource; }
+
+    // the objects and arrays which were opened, each linked to the one it was opened from
+    // they are used to construct the paths of exceptions (see DeserializerNode) and are
+    // kept for the lifetime of the deserializer (8 bytes for each opened object or array)
+    static constexpr uint32_t No_Path_Link = ~uint32_t(0);
+
+    // link for the object or array value, opened from the element at index of parent
+    // value is kept only for roots (with no parent), from which paths are resolved
+    uint32_t _addPathLink(uint32_t parent, int index, const ImValue& value) {
+        if (parent == No_Path_Link) {
+            index = int(m_pathRoots.size());
+            m_pathRoots.push_back(value);
+        }
+        m_pathLinks.push_back({parent, index});
+        return uint32_t(m_pathLinks.size() - 1);
+    }
+
+    // path to the element at index of the object or array of link, or to the object
+    // or array itself if index is negative
+    std::vector<PathSegment> _path(uint32_t link, int index) const;
+
+    // instrumentation counters (all zeroes if HUSE_INSTRUMENTATION is disabled)
+    const InstrumentationCounters& stats() const noexcept {
+#if HUSE_INSTRUMENTATION
+        return m_stats;
+#else
+        return No_Instrumentation_Counters;
+#endif
+    }
+#if HUSE_INSTRUMENTATION
+    InstrumentationCounters& _stats() noexcept { return m_stats; }
+protected:
+    impl::InstrClock::time_point m_constructionStart;
+#endif
+private:
+    std::pmr::memory_resource* m_memoryResource = nullptr;
+
+    struct PathLink {
+        uint32_t parent;
+        int index; // in the parent, or in m_pathRoots for roots
+    };
+    std::vector<PathLink> m_pathLinks;
+    std::vector<ImValue> m_pathRoots;
+#if HUSE_INSTRUMENTATION
+    InstrumentationCounters m_stats;
+#endif
 };
 
 } // namespace huse
@@ -0,0 +1,38 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include "DeserializerNode.hpp"
+#include <algorithm>
+
+namespace huse {
+
+std::vector<PathSegment> Deserializer::_path(uint32_t link, int index) const {
+    std::vector<PathSegment> ret;
+    if (link == No_Path_Link) return ret; // root
+
+    // the indices from the node up to its root
+    if (index >= 0) ret.push_back({{}, index});
+    for (; m_pathLinks[link].parent != No_Path_Link; link = m_pathLinks[link].parent) {
+        ret.push_back({{}, m_pathLinks[link].index});
+    }
+    std::reverse(ret.begin(), ret.end());
+
+    // only the values on the path are visited and only their keys are copied
+    ImValue v = m_pathRoots[size_t(m_pathLinks[link].index)];
+    for (auto& seg : ret) {
+        const auto i = size_t(seg.index);
+        if (v.get_type() == json::sajson::TYPE_OBJECT) {
+            seg.key = v.get_object_key(i);
+            seg.index = -1;
+            v = v.get_object_value(i);
+        }
+        else {
+            v = v.get_array_element(i);
+        }
+        // the objects and arrays on the path were opened, so they are parsed
+        v = parsedLazyValue(v);
+    }
+    return ret;
+}
+
+}
@@ -4,13 +4,19 @@
 #pragma once
 #include "API.h"
 #include "ImValue.hpp"
+#include "Deserializer.hpp"
 #include "OpenStringStream.hpp"
+#include "Instrumentation.hpp"
 
 #include <itlib/mem_streambuf.hpp>
 #include <splat/unreachable.h>
 #include <string_view>
 #include <optional>
 #include <istream>
+#include <vector>
+#include <memory>
+#include <memory_resource>
+#include <concepts>
 
 namespace huse {
 
@@ -44,11 +50,33 @@ private:
 };
 
 namespace impl {
+template <typename Key>
+void assignKey(Key& k, std::string_view key) {
+    if constexpr (requires { k.assign(key.data(), key.size()); }) {
+        // keeps the capacity and the allocator of k
+        k.assign(key.data(), key.size());
+    }
+    else {
+        k = Key(key);
+    }
+}
+
 struct DeserializerNodeImpl {
     // have template independent functions here to reduce code bloat and speed up compile times
 protected:
     ImValue m_value;
 
+    // the path link (see Deserializer::_addPathLink) of the object or array which this
+    // node was opened from and the index in it
+    // objects and arrays get their own link when they're opened (and the index is -1)
+    // they are only used to construct a path when (and if) it's needed
+    uint32_t m_pathLink = Deserializer::No_Path_Link;
+    int m_indexInParent = -1;
+
+#if HUSE_INSTRUMENTATION
+    uint32_t m_depth = 0; // number of enclosing objects and arrays
+#endif
+
     DeserializerNodeImpl(const ImValue& value)
         : m_value(value)
     {}
@@ -57,12 +85,6 @@ protected:
     int size() const {
         return int(m_value.get_length());
     }
-
-public:
-    [[noreturn]] void throwException(std::string_view msg) const {
-        m_value.throwException(msg);
-        SPLAT_UNREACHABLE();
-    }
 };
 }
 
@@ -89,12 +111,25 @@ public:
 
     template <std::derived_from<Deserializer> OtherDeserializer>
     DeserializerNode(const DeserializerNode<OtherDeserializer>& other) noexcept
-        : impl::DeserializerNodeImpl(other.m_value)
+        : impl::DeserializerNodeImpl(other)
         , m_deserializer(other.m_deserializer)
     {}
 
     Deserializer& _d() noexcept { return *m_deserializer; }
 
+    [[noreturn]] void throwException(std::string_view msg) const {
+        throwException(DeserializerException(std::string(msg)));
+    }
+    [[noreturn]] void throwException(ErrorCode code) const {
+        throwException(DeserializerException(code));
+    }
+    [[noreturn]] void throwException(DeserializerException&& ex) const {
+        if (m_deserializer) {
+            ex.setPathSegments(m_deserializer->_path(this->m_pathLink, this->m_indexInParent));
+        }
+        throw std::move(ex);
+    }
+
     Type type() const {
         if (!m_deserializer) {
             return Type::Undefined;
@@ -117,6 +152,37 @@ public:
 
     DeserializerArray<Deserializer> ar();
     DeserializerObject<Deserializer> obj();
+
+protected:
+    // parse the value if it was skipped by a lazy parse
+    void parseLazy() {
+        if (!m_value.is_lazy()) return;
+        try {
+            m_value = m_deserializer->parseLazyValue(m_value);
+        }
+        catch (DeserializerException& ex) {
+            throwException(std::move(ex));
+        }
+    }
+
+    // called by objects and arrays when they're opened, so that their elements link to them
+    void addPathLink() {
+        if (!m_deserializer) return;
+        if (this->m_indexInParent < 0 && this->m_pathLink != Deserializer::No_Path_Link) return; // already linked
+        this->m_pathLink = m_deserializer->_addPathLink(this->m_pathLink, this->m_indexInParent, this->m_value);
+        this->m_indexInParent = -1;
+    }
+
+    // node for an element of this (object or array) node
+    DeserializerNode child(const ImValue& value, int index) const noexcept {
+        DeserializerNode ret(value, m_deserializer);
+        ret.m_pathLink = this->m_pathLink;
+        ret.m_indexInParent = index;
+#if HUSE_INSTRUMENTATION
+        ret.m_depth = m_depth;
+#endif
+        return ret;
+    }
 };
 
 template <typename Deserializer>
@@ -132,8 +198,20 @@ public:
         : Node(value, d)
     {
         if (!value.htype().isArray()) {
-            this->throwException("not an array");
+            this->throwException(ErrorCode::NotArray);
+        }
+        this->parseLazy();
+        this->addPathLink();
+    }
+
+    explicit DeserializerArray(const Node& node)
+        : Node(node)
+    {
+        if (!this->m_value.htype().isArray()) {
+            this->throwException(ErrorCode::NotArray);
         }
+        this->parseLazy();
+        this->addPathLink();
     }
 
     DeserializerArray(const DeserializerArray& other) = default;
@@ -153,7 +231,7 @@ public:
         if (done()) {
             return std::nullopt;
         }
-        auto ret = Node(this->m_value.get_array_element(m_index), this->m_deserializer);
+        auto ret = this->child(this->m_value.get_array_element(m_index), m_index);
         ++m_index;
         return ret;
     }
@@ -161,7 +239,7 @@ public:
     Node val() {
         auto v = optval();
         if (!v) {
-            this->throwException("array index out of bounds");
+            this->throwException(ErrorCode::IndexOutOfBounds);
         }
         return *v;
     }
@@ -202,7 +280,7 @@ public:
         {}
 
         Node operator*() const {
-            return Node(m_array->m_value.get_array_element(m_index), m_array->m_deserializer);
+            return m_array->child(m_array->m_value.get_array_element(m_index), m_index);
         }
 
         iterator& operator++() {
@@ -234,8 +312,20 @@ public:
         : Node(value, d)
     {
         if (!value.htype().isObject()) {
-            this->throwException("not an object");
+            this->throwException(ErrorCode::NotObject);
+        }
+        this->parseLazy();
+        this->addPathLink();
+    }
+
+    explicit DeserializerObject(const Node& node)
+        : Node(node)
+    {
+        if (!this->m_value.htype().isObject()) {
+            this->throwException(ErrorCode::NotObject);
         }
+        this->parseLazy();
+        this->addPathLink();
     }
 
     DeserializerObject(const DeserializerObject& other) = default;
@@ -261,10 +351,22 @@ public:
     }
 
     std::optional<Node> optkey(std::string_view k) {
+#if HUSE_INSTRUMENTATION
+        auto& stats = this->m_deserializer->_stats();
+        ++stats.keyLookups;
+#endif
         auto index = /*iile*/[&]() {
             if (!done() && this->m_value.get_object_key(m_index) == k) {
                 return m_index;
             }
+#if HUSE_INSTRUMENTATION
+            if (json::sajson::internal::should_binary_search(size_t(size()))) {
+                ++stats.binaryKeySearches;
+            }
+            else {
+                ++stats.linearKeySearches;
+            }
+#endif
             return int(this->m_value.find_object_key(k));
         }();
         if (index >= size()) {
@@ -272,13 +374,13 @@ public:
             return std::nullopt;
         }
         m_index = index + 1;
-        return Node(this->m_value.get_object_value(index), this->m_deserializer);
+        return this->child(this->m_value.get_object_value(index), index);
     }
 
     Node key(std::string_view k) {
         auto ret = optkey(k);
         if (!ret) {
-            this->throwException("key not found in object");
+            this->throwException(ErrorCode::KeyNotFound);
         }
         return *ret;
     }
@@ -319,7 +421,7 @@ public:
             return std::nullopt;
         }
         auto key = this->m_value.get_object_key(m_index);
-        auto val = Node(this->m_value.get_object_value(m_index), this->m_deserializer);
+        auto val = this->child(this->m_value.get_object_value(m_index), m_index);
         ++m_index;
         return std::make_pair(key, val);
     }
@@ -327,7 +429,7 @@ public:
     std::pair<std::string_view, Node> keyval() {
         auto r = optkeyval();
         if (!r) {
-            this->throwException("no more keys in object");
+            this->throwException(ErrorCode::NoMoreKeys);
         }
         return *r;
     }
@@ -335,7 +437,7 @@ public:
     template <typename Key, typename T>
     void keyval(Key& k, T& v) {
         auto p = keyval();
-        k = Key(p.first);
+        impl::assignKey(k, p.first);
         p.second.val(v);
     }
 
@@ -343,7 +445,7 @@ public:
     bool optkeyval(Key& k, T& v) {
         auto p = optkeyval();
         if (!p) return false;
-        k = Key(p->first);
+        impl::assignKey(k, p->first);
         p->second.val(v);
         return true;
     }
@@ -365,7 +467,7 @@ public:
             auto& val = m_object->m_value;
             return {
                 val.get_object_key(m_index),
-                Node(val.get_object_value(m_index), m_object->m_deserializer)
+                m_object->child(val.get_object_value(m_index), m_index)
             };
         }
 
@@ -387,11 +489,25 @@ public:
 
 template <typename Deserializer>
 inline DeserializerObject<Deserializer> DeserializerNode<Deserializer>::obj() {
-    return DeserializerObject<Deserializer>(m_value, this->m_deserializer);
+    DeserializerObject<Deserializer> ret(*this);
+#if HUSE_INSTRUMENTATION
+    auto& stats = m_deserializer->_stats();
+    ++stats.objects;
+    ret.m_depth = m_depth + 1;
+    if (ret.m_depth > stats.maxDepth) stats.maxDepth = ret.m_depth;
+#endif
+    return ret;
 }
 template <typename Deserializer>
 inline DeserializerArray<Deserializer> DeserializerNode<Deserializer>::ar() {
-    return DeserializerArray<Deserializer>(m_value, this->m_deserializer);
+    DeserializerArray<Deserializer> ret(*this);
+#if HUSE_INSTRUMENTATION
+    auto& stats = m_deserializer->_stats();
+    ++stats.arrays;
+    ret.m_depth = m_depth + 1;
+    if (ret.m_depth > stats.maxDepth) stats.maxDepth = ret.m_depth;
+#endif
+    return ret;
 }
 
 template <typename Deserializer>
@@ -409,9 +525,13 @@ template <typename Deserializer, typename T>
 concept HasDeserializerGetValue = requires(Deserializer& d, ImValue& v, T& t) {
     d.getValue(v, t);
 };
+template <typename Deserializer, typename T>
+concept HasDeserializerReadValue = requires(const Deserializer& d, const ImValue& v, T& t) {
+    { d.readValue(v, t) } -> std::same_as<ErrorCode>;
+};
 template <typename T>
-concept HasGetValue = requires(ImValue& v, T& t) {
-    v.getValue(t);
+concept HasReadValue = requires(const ImValue& v, T& t) {
+    v.readValue(t);
 };
 template <typename T, typename Deserializer>
 concept HasDeserializeMethod = requires(T& t, DeserializerNode<Deserializer>& node) {
@@ -430,16 +550,62 @@ template <typename T, typename Deserializer>
 concept HasDeserializeFlatFunc = requires(DeserializerObject<Deserializer>& obj, T& t) {
     huseDeserializeFlat(obj, t);
 };
+
+// containers and strings which use std::pmr::polymorphic_allocator
+template <typename T>
+concept PmrAllocatorAware = requires(const T& t) {
+    requires std::same_as<typename T::allocator_type,
+        std::pmr::polymorphic_allocator<typename T::allocator_type::value_type>>;
+    { t.empty() } -> std::convertible_to<bool>;
+} && std::constructible_from<T, typename T::allocator_type>;
+
+// pmr values can't change their memory resource after construction, so empty ones
+// which use the default resource are recreated with the one of the deserializer
+// nested values get it from their parents through uses-allocator construction
+template <PmrAllocatorAware T>
+void adoptMemoryResource(const Deserializer& d, T& t) {
+    auto resource = d.memoryResource();
+    if (!resource || !t.empty()) return;
+    if (t.get_allocator().resource() != std::pmr::get_default_resource()) return;
+    std::destroy_at(&t);
+    std::construct_at(&t, typename T::allocator_type(resource));
+}
 } // namespace impl
 
 template <typename Deserializer>
 template <typename T>
 void DeserializerNode<Deserializer>::val(T& v) {
+#if HUSE_INSTRUMENTATION
+    auto& stats = m_deserializer->_stats();
+    impl::PhaseTimer timer(m_depth == 0 ? &stats.walkNs : nullptr);
+#endif
+    if constexpr (impl::PmrAllocatorAware<T>) {
+        if (m_deserializer) impl::adoptMemoryResource(*m_deserializer, v);
+    }
+
     if constexpr (impl::HasDeserializerGetValue<Deserializer, T>) {
+#if HUSE_INSTRUMENTATION
+        ++stats.values;
+#endif
         this->m_deserializer->getValue(m_value, v);
     }
-    else if constexpr (impl::HasGetValue<T>) {
-        m_value.getValue(v);
+    else if constexpr (impl::HasDeserializerReadValue<Deserializer, T>) {
+#if HUSE_INSTRUMENTATION
+        ++stats.values;
+#endif
+        auto err = this->m_deserializer->readValue(m_value, v);
+        if (err != ErrorCode::None) {
+            throwException(err);
+        }
+    }
+    else if constexpr (impl::HasReadValue<T>) {
+#if HUSE_INSTRUMENTATION
+        ++stats.values;
+#endif
+        auto err = m_value.readValue(v);
+        if (err != ErrorCode::None) {
+            throwException(err);
+        }
     }
     else if constexpr (impl::HasDeserializeMethod<T, Deserializer>) {
         v.huseDeserialize(*this);
@@ -468,6 +634,9 @@ void DeserializerObject<Deserializer>::flatval(T& v) {
 
 template <typename Deserializer>
 DeserializerStream huseOpen(StringStream, DeserializerNode<Deserializer>& parent) {
+#if HUSE_INSTRUMENTATION
+    ++parent._d()._stats().stringStreamOpens;
+#endif
     std::string_view str;
     parent.val(str);
     return DeserializerStream(str);
@@ -0,0 +1,68 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include "Exception.hpp"
+
+namespace huse {
+
+const char* errorCodeMessage(ErrorCode code) noexcept {
+    switch (code) {
+    case ErrorCode::None: return "no error";
+    case ErrorCode::Custom: return "error";
+    case ErrorCode::IntegerTooBig: return "Integer value is bigger than maximum allowed for JSON";
+    case ErrorCode::NonFiniteFloat: return "Floating point value is not finite. Not supported by JSON";
+    case ErrorCode::SeekNotSupported: return "Seek is not supported by JSON string streams";
+    case ErrorCode::InvalidUtf8: return "invalid UTF-8";
+    case ErrorCode::Parse: return "parse error";
+    case ErrorCode::NotBoolean: return "not a boolean";
+    case ErrorCode::NotInteger: return "not an integer";
+    case ErrorCode::NegativeInteger: return "negative integer";
+    case ErrorCode::NotNumber: return "not a number";
+    case ErrorCode::NotString: return "not a string";
+    case ErrorCode::NotNull: return "not null";
+    case ErrorCode::NotArray: return "not an array";
+    case ErrorCode::NotObject: return "not an object";
+    case ErrorCode::IndexOutOfBounds: return "array index out of bounds";
+    case ErrorCode::SizeMismatch: return "array size mismatch";
+    case ErrorCode::KeyNotFound: return "key not found in object";
+    case ErrorCode::NoMoreKeys: return "no more keys in object";
+    case ErrorCode::NoSource: return "source not available";
+    case ErrorCode::SharedLazy: return "lazy value in a shared document";
+    case ErrorCode::NotUnescaped: return "string not unescaped";
+    case ErrorCode::CacheIo: return "document cache i/o error";
+    case ErrorCode::BadCache: return "invalid or incompatible document cache";
+    case ErrorCode::Compression: return "compressed stream error";
+    }
+    return "unknown error";
+}
+
+Exception::Exception(ErrorCode code, const char* staticMsg)
+    // an empty string doesn't allocate
+    : std::runtime_error(std::string())
+    , m_code(code)
+    , m_staticMsg(staticMsg ? staticMsg : errorCodeMessage(code))
+{}
+
+const char* Exception::what() const noexcept {
+    if (m_staticMsg) return m_staticMsg;
+    return std::runtime_error::what();
+}
+
+std::string DeserializerException::path() const {
+    std::string ret;
+    for (auto& seg : m_path) {
+        ret += '/';
+        if (seg.index >= 0) {
+            ret += std::to_string(seg.index);
+            continue;
+        }
+        for (auto c : seg.key) {
+            if (c == '~') ret += "~0";
+            else if (c == '/') ret += "~1";
+            else ret += c;
+        }
+    }
+    return ret;
+}
+
+}
@@ -5,14 +5,72 @@
 #include "API.h"
 
 #include <stdexcept>
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstddef>
 
 namespace huse
 {
+
+enum class ErrorCode : int {
+    None = 0,
+    Custom, // user-provided message
+
+    // serializer
+    IntegerTooBig,
+    NonFiniteFloat,
+    SeekNotSupported,
+    InvalidUtf8, // string which is not valid UTF-8 (with strict validation)
+
+    // deserializer
+    Parse, // invalid input (see the exception message for details)
+    NotBoolean,
+    NotInteger,
+    NegativeInteger,
+    NotNumber,
+    NotString,
+    NotNull,
+    NotArray,
+    NotObject,
+    IndexOutOfBounds,
+    SizeMismatch, // array size differs from the expected fixed size
+    KeyNotFound,
+    NoMoreKeys,
+    NoSource, // the source text of the value is not available
+    SharedLazy, // lazy values can't be parsed in shared documents
+    NotUnescaped, // string which was not unescaped read as a view without a deserializer which can unescape it
+
+    // document cache
+    CacheIo,
+    BadCache, // not a document cache or incompatible with this build
+
+    // compressed streams
+    Compression, // invalid or truncated compressed input, or a compressor error
+};
+
+// static message for an error code
+HUSE_API const char* errorCodeMessage(ErrorCode code) noexcept;
+
 class HUSE_API Exception : public std::runtime_error
 {
 public:
+    // custom message
     using std::runtime_error::runtime_error;
+
+    // errors with a code use a static message and don't allocate
+    // if no message is provided, errorCodeMessage(code) is used
+    explicit Exception(ErrorCode code, const char* staticMsg = nullptr);
+
     virtual ~Exception() = 0; // still need to export the vtable
+
+    virtual const char* what() const noexcept override;
+
+    ErrorCode code() const noexcept { return m_code; }
+
+private:
+    ErrorCode m_code = ErrorCode::Custom;
+    const char* m_staticMsg = nullptr;
 };
 
 class HUSE_API SerializerException : public Exception
@@ -22,11 +80,33 @@ public:
     ~SerializerException();
 };
 
+// element of the path from the root to a node
+struct PathSegment {
+    std::string key; // object key (if index < 0)
+    int index = -1; // array index
+};
+
 class HUSE_API DeserializerException : public Exception
 {
 public:
     using Exception::Exception;
     ~DeserializerException();
+
+    // path from the root to the node which failed
+    // empty if the failure is at the root or the path is unknown
+    const std::vector<PathSegment>& pathSegments() const noexcept { return m_path; }
+    void setPathSegments(std::vector<PathSegment> path) noexcept { m_path = std::move(path); }
+
+    // JSON pointer (RFC 6901) to the failed node, formatted on demand
+    std::string path() const;
+
+    // byte offset in the input for parse errors
+    size_t inputOffset() const noexcept { return m_inputOffset; }
+    void setInputOffset(size_t offset) noexcept { m_inputOffset = offset; }
+
+private:
+    std::vector<PathSegment> m_path;
+    size_t m_inputOffset = 0;
 };
 
 }
@@ -2,22 +2,45 @@
 // SPDX-License-Identifier: MIT
 //
 #pragma once
+#include "API.h"
 #include "Type.hpp"
 #include "Exception.hpp"
+#include "impl/Charconv.hpp"
 #include <splat/unreachable.h>
 #include <cmath>
 #include <optional>
+#include <string>
+#include <memory_resource>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <cstring>
 #include <algorithm>
 
 // huse config
 #define SAJSON_NO_STD_STRING
+
+// HUSE_JSON_COMPACT_AST
+// when enabled, the AST uses 32-bit words instead of size_t
+// this halves the memory used by documents on 64-bit hosts, but limits
+// their size: the input must be smaller than 4 GB and the offsets in the AST
+// must fit in 28 bits (as the other 4 are used for tags)
+// the AST takes a few words per value, so only documents with about a
+// hundred million values reach the second limit
+// parsing a larger document fails with a "document too large" error
+#if !defined(HUSE_JSON_COMPACT_AST)
+#   define HUSE_JSON_COMPACT_AST 0
+#endif
 //
 
 namespace huse::json::sajson {
 
+#if HUSE_JSON_COMPACT_AST
+using ast_word = uint32_t;
+#else
+using ast_word = size_t;
+#endif
+
 /**
  * Indicates a JSON value's type.
  *
@@ -89,24 +112,28 @@ enum class tag : uint8_t {
     string,
     array,
     object,
+    lazy, // unparsed array or object (huse addition), payload: start, end, parsed document
+    raw_number, // unconverted number (huse addition), payload: start, end
+    raw_string, // string which is not unescaped (huse addition), payload: start, end, unescaped length (see value::is_raw_string)
+    raw_integer, // unconverted number which is an integer that fits in 32 bits (huse addition), payload: start, end
 };
 
-static const size_t TAG_BITS = 3;
+static const size_t TAG_BITS = 4;
 static const size_t TAG_MASK = (1 << TAG_BITS) - 1;
-static const size_t VALUE_MASK = ~size_t{} >> TAG_BITS;
+static const ast_word VALUE_MASK = ~ast_word{} >> TAG_BITS;
 
-static const size_t ROOT_MARKER = VALUE_MASK;
+static const ast_word ROOT_MARKER = VALUE_MASK;
 
-constexpr inline tag get_element_tag(size_t s) {
+constexpr inline tag get_element_tag(ast_word s) {
     return static_cast<tag>(s & TAG_MASK);
 }
 
-constexpr inline size_t get_element_value(size_t s) { return s >> TAG_BITS; }
+constexpr inline size_t get_element_value(ast_word s) { return s >> TAG_BITS; }
 
 struct object_key_record {
-    size_t key_start;
-    size_t key_end;
-    size_t value;
+    ast_word key_start;
+    ast_word key_end;
+    ast_word value;
 
     bool match(const char* object_data, const string& str) const {
         size_t length = key_end - key_start;
@@ -159,33 +186,33 @@ struct object_key_comparator {
 namespace integer_storage {
 enum { word_length = 1 };
 
-inline int load(const size_t* location) {
+inline int load(const ast_word* location) {
     int value;
     memcpy(&value, location, sizeof(value));
     return value;
 }
 
-inline void store(size_t* location, int value) {
+inline void store(ast_word* location, int value) {
     // NOTE: Most modern compilers optimize away this constant-size
     // memcpy into a single instruction. If any don't, and treat
     // punning through a union as legal, they can be special-cased.
     static_assert(
         sizeof(value) <= sizeof(*location),
-        "size_t must not be smaller than int");
+        "ast_word must not be smaller than int");
     memcpy(location, &value, sizeof(value));
 }
 } // namespace integer_storage
 
 namespace double_storage {
-enum { word_length = sizeof(double) / sizeof(size_t) };
+enum { word_length = sizeof(double) / sizeof(ast_word) };
 
-inline double load(const size_t* location) {
+inline double load(const ast_word* location) {
     double value;
     memcpy(&value, location, sizeof(double));
     return value;
 }
 
-inline void store(size_t* location, double value) {
+inline void store(ast_word* location, double value) {
     // NOTE: Most modern compilers optimize away this constant-size
     // memcpy into a single instruction. If any don't, and treat
     // punning through a union as legal, they can be special-cased.
@@ -193,6 +220,12 @@ inline void store(size_t* location, double value) {
 }
 } // namespace double_storage
 
+/// Unescapes and validates the contents of a string which was not unescaped
+/// by the parse (huse addition, see value::is_raw_string) in place.  buf
+/// holds the contents followed by the closing quote, as in the input.
+/// Returns the length of the unescaped string, or size_t(-1) if it's invalid.
+HUSE_API size_t unescape_raw_string(char* buf, size_t length);
+
 /// Represents a JSON value.  First, call get_type() to check its type,
 /// which determines which methods are available.
 ///
@@ -230,6 +263,14 @@ public:
             return TYPE_ARRAY;
         case tag::object:
             return TYPE_OBJECT;
+        case tag::lazy:
+            return lazy_is_object() ? TYPE_OBJECT : TYPE_ARRAY;
+        case tag::raw_number:
+            return TYPE_DOUBLE;
+        case tag::raw_string:
+            return TYPE_STRING;
+        case tag::raw_integer:
+            return TYPE_INTEGER;
         }
         SPLAT_UNREACHABLE();
     }
@@ -246,6 +287,10 @@ public:
         case tag::string:  return { Type::String };
         case tag::array:   return { Type::Array };
         case tag::object:  return { Type::Object };
+        case tag::lazy:    return { lazy_is_object() ? Type::Object : Type::Array };
+        case tag::raw_number: return { Type::Float };
+        case tag::raw_string: return { Type::String };
+        case tag::raw_integer: return { Type::Integer };
         }
         SPLAT_UNREACHABLE();
     }
@@ -279,7 +324,7 @@ public:
     value get_array_element(size_t index) const {
         using namespace internal;
         assert_tag(tag::array);
-        size_t element = payload[1 + index];
+        ast_word element = payload[1 + index];
         return value(
             get_element_tag(element),
             payload + get_element_value(element),
@@ -291,7 +336,7 @@ public:
     /// Only legal if get_type() is TYPE_OBJECT.
     std::string_view get_object_key(size_t index) const {
         assert_tag(tag::object);
-        const size_t* s = payload + 1 + index * 3;
+        const ast_word* s = payload + 1 + index * 3;
         return std::string_view(text + s[0], s[1] - s[0]);
     }
 
@@ -300,7 +345,7 @@ public:
     value get_object_value(size_t index) const {
         using namespace internal;
         assert_tag(tag::object);
-        size_t element = payload[3 + index * 3];
+        ast_word element = payload[3 + index * 3];
         return value(
             get_element_tag(element),
             payload + get_element_value(element),
@@ -356,20 +401,35 @@ public:
     /// If a numeric value was parsed as a 32-bit integer, returns it.
     /// Only legal if get_type() is TYPE_INTEGER.
     int get_integer_value() const {
-        assert_tag(tag::integer);
+        assert_tag_2(tag::integer, tag::raw_integer);
+        if (value_tag == tag::raw_integer) {
+            int ret = 0;
+            read_raw_number(ret);
+            return ret;
+        }
         return integer_storage::load(payload);
     }
 
     /// If a numeric value was parsed as a double, returns it.
     /// Only legal if get_type() is TYPE_DOUBLE.
     double get_double_value() const {
-        assert_tag(tag::double_);
+        assert_tag_2(tag::double_, tag::raw_number);
+        if (value_tag == tag::raw_number) {
+            double ret = 0;
+            read_raw_number(ret);
+            return ret;
+        }
         return double_storage::load(payload);
     }
 
     /// Returns a numeric value as a double-precision float.
     /// Only legal if get_type() is TYPE_INTEGER or TYPE_DOUBLE.
     double get_number_value() const {
+        if (is_raw_number()) {
+            double ret = 0;
+            read_raw_number(ret);
+            return ret;
+        }
         assert_tag_2(tag::integer, tag::double_);
         if (value_tag == tag::integer) {
             return get_integer_value();
@@ -392,12 +452,11 @@ public:
         // https://gist.github.com/chadaustin/2c249cb850619ddec05b23ca42cf7a18
         *out = 0;
 
-        assert_tag_2(tag::integer, tag::double_);
-        switch (value_tag) {
-        case tag::integer:
+        switch (get_type()) {
+        case TYPE_INTEGER:
             *out = get_integer_value();
             return true;
-        case tag::double_: {
+        case TYPE_DOUBLE: {
             double v = get_double_value();
             if (v < -(1LL << 53) || v >(1LL << 53)) {
                 return false;
@@ -441,134 +500,319 @@ public:
     }
 #endif
 
+    /// An array or object which was skipped by a lazy parse.
+    /// get_type() reports its actual type, but it must be parsed before
+    /// its elements can be accessed.
+    bool is_lazy() const { return value_tag == tag::lazy; }
+
+    /// Returns the source text of a lazy value (from the opening to the
+    /// closing bracket).  It's changed if the value is parsed in place (see
+    /// huse::json::Parser::lazySource).
+    std::string_view get_lazy_source() const {
+        assert_tag(tag::lazy);
+        return std::string_view(text + payload[0], payload[1] - payload[0]);
+    }
+
+    /// A number which was not converted by a parse with lazy numbers.
+    /// get_type() reports its actual type (TYPE_INTEGER if it's an integer
+    /// which fits in 32 bits, as if it were converted, which is decided when
+    /// it's parsed), and it is converted when it's read.
+    bool is_raw_number() const { return value_tag == tag::raw_number || value_tag == tag::raw_integer; }
+
+    /// Returns the source text of a number which was not converted.
+    std::string_view get_number_source() const {
+        assert(is_raw_number());
+        return std::string_view(text + payload[0], payload[1] - payload[0]);
+    }
+
+    /// A string with escapes which were not unescaped by a parse with lazy
+    /// strings.  get_type() reports TYPE_STRING, but get_string_length() and
+    /// as_cstring() are not legal.  It can be read as a std::string, which
+    /// unescapes it, and as a std::string_view only through a deserializer
+    /// (see JsonDeserializer), which unescapes it in place once (reading it
+    /// directly as a view produces ErrorCode::NotUnescaped).
+    bool is_raw_string() const { return value_tag == tag::raw_string; }
+
+    /// Whether a raw string was unescaped in place (successfully or not).
+    /// Its source is not available after that.
+    bool is_unescaped_raw_string() const {
+        assert_tag(tag::raw_string);
+        return payload[2] != 0;
+    }
+
+    /// Returns the source text of a string which was not unescaped, without
+    /// the quotes.  It is valid JSON string contents only if unescaping it
+    /// succeeds.
+    std::string_view get_raw_string_source() const {
+        assert_tag(tag::raw_string);
+        assert(!is_unescaped_raw_string());
+        return std::string_view(text + payload[0], payload[1] - payload[0]);
+    }
+
     /// \cond INTERNAL
-    const size_t* _internal_get_payload() const { return payload; }
+    const ast_word* _internal_get_payload() const { return payload; }
+    const char* _internal_get_text() const { return text; }
+
+    // payload[2] of a raw string which was unescaped in place is the unescaped length + 1
+    // (the unescaped string is at the start of the source) or invalid_unescaped if it failed
+    static constexpr ast_word invalid_unescaped = ~ast_word{};
+    std::optional<std::string_view> _internal_get_unescaped_string() const {
+        if (payload[2] == invalid_unescaped) return std::nullopt;
+        return std::string_view(text + payload[0], size_t(payload[2] - 1));
+    }
     /// \endcond
 
     //////////////////////////////////////////
-    static inline constexpr std::string_view Not_Integer = "not an integer";
-    static inline constexpr std::string_view Out_of_Range = "out of range";
-
     template <typename Target, typename Source>
-    Target signedCheck(Source s)
+    static ErrorCode signedCheck(Source s, Target& val)
     {
         if constexpr (std::is_unsigned_v<Target>)
         {
-            if (s < 0) throwException("negative integer");
+            if (s < 0) return ErrorCode::NegativeInteger;
         }
-        return Target(s);
+        val = Target(s);
+        return ErrorCode::None;
     }
 
     template <typename T>
-    void readInt(T& val)
+    ErrorCode readInt(T& val) const
     {
-        if (get_type() != TYPE_INTEGER) throwException(Not_Integer);
-        val = signedCheck<T>(get_integer_value());
+        if (is_raw_number())
+        {
+            int i;
+            if (!read_raw_number(i)) return ErrorCode::NotInteger;
+            return signedCheck(i, val);
+        }
+        if (get_type() != TYPE_INTEGER) return ErrorCode::NotInteger;
+        return signedCheck(get_integer_value(), val);
     }
 
     template <typename T>
-    void readLargeInt(T& val)
+    ErrorCode readLargeInt(T& val) const
     {
+        if (is_raw_number())
+        {
+            // directly into the target type, so that all of its values are exact
+            auto src = get_number_source();
+            auto res = HUSE_CHARCONV_NAMESPACE::from_chars(src.data(), src.data() + src.size(), val);
+            if (res.ec == std::errc() && res.ptr == src.data() + src.size()) return ErrorCode::None;
+            if (res.ec == std::errc::result_out_of_range) return ErrorCode::IntegerTooBig;
+
+            // fractions, exponents, and negative values for unsigned targets
+            double d;
+            if (!read_raw_number(d)) return ErrorCode::NotNumber;
+            double tmp;
+            if (std::modf(d, &tmp) != 0) return ErrorCode::NotInteger;
+            return signedCheck(std::floor(d), val);
+        }
         if (get_type() == TYPE_INTEGER)
         {
-            val = signedCheck<T>(get_integer_value());
+            return signedCheck(get_integer_value(), val);
         }
         else if (get_type() == TYPE_DOUBLE)
         {
             auto d = get_double_value();
             double tmp;
-            if (std::modf(d, &tmp) != 0) throwException(Not_Integer);
-            val = signedCheck<T>(std::floor(d));
+            if (std::modf(d, &tmp) != 0) return ErrorCode::NotInteger;
+            return signedCheck(std::floor(d), val);
         }
         else
         {
-            throwException(Not_Integer);
+            return ErrorCode::NotInteger;
         }
     }
 
     template <typename T>
-    void readFloat(T& val)
+    ErrorCode readFloat(T& val) const
     {
+        if (is_raw_number())
+        {
+            // directly into the target type (no double rounding for floats)
+            if (!read_raw_number(val)) return ErrorCode::NotNumber;
+            return ErrorCode::None;
+        }
         if (get_type() == TYPE_INTEGER) val = T(get_integer_value());
         else if (get_type() == TYPE_DOUBLE) val = T(get_double_value());
-        else throwException("not a number");
+        else return ErrorCode::NotNumber;
+        return ErrorCode::None;
     }
 
     template <typename S>
-    void readString(S& val)
+    ErrorCode readString(S& val) const
     {
-        if (get_type() != TYPE_STRING) throwException("not a string");
-        val = { as_cstring(), get_string_length() };
+        if (value_tag == tag::raw_string) {
+            if (is_unescaped_raw_string()) {
+                auto str = _internal_get_unescaped_string();
+                if (!str) return ErrorCode::Parse;
+                if constexpr (std::is_same_v<S, std::string_view>) val = *str;
+                else val.assign(str->data(), str->size());
+                return ErrorCode::None;
+            }
+            // views need storage for the unescaped string
+            if constexpr (std::is_same_v<S, std::string_view>) return ErrorCode::NotUnescaped;
+            else {
+                // the closing quote is included, as unescaping stops at it
+                auto src = get_raw_string_source();
+                val.assign(src.data(), src.size() + 1);
+                const size_t length = unescape_raw_string(val.data(), val.size());
+                if (length == size_t(-1)) return ErrorCode::Parse;
+                val.resize(length);
+                return ErrorCode::None;
+            }
+        }
+        if (get_type() != TYPE_STRING) return ErrorCode::NotString;
+        if constexpr (std::is_same_v<S, std::string_view>) {
+            val = { as_cstring(), get_string_length() };
+        }
+        else {
+            // keeps the capacity and the allocator of val
+            val.assign(as_cstring(), get_string_length());
+        }
+        return ErrorCode::None;
     }
 
     [[noreturn]] void throwException(std::string_view msg) const {
         throw DeserializerException(std::string(msg));
     }
+    [[noreturn]] void throwException(ErrorCode code) const {
+        throw DeserializerException(code);
+    }
 
-    void getValue(bool& val) {
+    // non-throwing reads
+    // return ErrorCode::None on success
+    ErrorCode readValue(bool& val) const {
         auto t = get_type();
         if (t == TYPE_TRUE) val = true;
         else if (t == TYPE_FALSE) val = false;
-        else throwException("not a boolean");
+        else return ErrorCode::NotBoolean;
+        return ErrorCode::None;
     }
-    void getValue(short& val) {
-        readInt(val);
+    ErrorCode readValue(short& val) const {
+        return readInt(val);
     }
-    void getValue(unsigned short& val) {
-        readInt(val);
+    ErrorCode readValue(unsigned short& val) const {
+        return readInt(val);
     }
-    void getValue(int& val) {
-        readInt(val);
+    ErrorCode readValue(int& val) const {
+        return readInt(val);
     }
-    void getValue(unsigned int& val) {
-        readLargeInt(val);
+    ErrorCode readValue(unsigned int& val) const {
+        return readLargeInt(val);
     }
-    void getValue(long& val) {
+    ErrorCode readValue(long& val) const {
         if constexpr (sizeof(long) == 4) {
             // gcc and clang have long equal intptr_t, msvc has long at 4 bytes
-            readInt(val);
+            return readInt(val);
         }
         else {
-            readLargeInt(val);
+            return readLargeInt(val);
         }
     }
-    void getValue(unsigned long& val) {
-        readLargeInt(val);
+    ErrorCode readValue(unsigned long& val) const {
+        return readLargeInt(val);
     }
-    void getValue(long long& val) {
-        readLargeInt(val);
+    ErrorCode readValue(long long& val) const {
+        return readLargeInt(val);
     }
-    void getValue(unsigned long long& val) {
-        readLargeInt(val);
+    ErrorCode readValue(unsigned long long& val) const {
+        return readLargeInt(val);
     }
-    void getValue(float& val) {
-        readFloat(val);
+    ErrorCode readValue(float& val) const {
+        return readFloat(val);
     }
-    void getValue(double& val) {
-        readFloat(val);
+    ErrorCode readValue(double& val) const {
+        return readFloat(val);
     }
-    void getValue(std::string_view& val) {
-        readString(val);
+    ErrorCode readValue(std::string_view& val) const {
+        return readString(val);
     }
-    void getValue(std::string& val) {
-        readString(val);
+    ErrorCode readValue(std::string& val) const {
+        return readString(val);
     }
-    void getValue(std::nullptr_t) {
-        auto t = get_type();
-        if (t != TYPE_NULL) throwException("not null");
+    ErrorCode readValue(std::pmr::string& val) const {
+        return readString(val);
+    }
+    ErrorCode readValue(std::nullptr_t) const {
+        if (get_type() != TYPE_NULL) return ErrorCode::NotNull;
+        return ErrorCode::None;
+    }
+    ErrorCode readValue(std::nullopt_t) const {
+        return ErrorCode::None;
+    }
+
+    void throwIfError(ErrorCode err) const {
+        if (err != ErrorCode::None) throwException(err);
+    }
+
+    // throwing reads
+    void getValue(bool& val) const {
+        throwIfError(readValue(val));
+    }
+    void getValue(short& val) const {
+        throwIfError(readValue(val));
     }
-    void getValue(std::nullopt_t) {}
+    void getValue(unsigned short& val) const {
+        throwIfError(readValue(val));
+    }
+    void getValue(int& val) const {
+        throwIfError(readValue(val));
+    }
+    void getValue(unsigned int& val) const {
+        throwIfError(readValue(val));
+    }
+    void getValue(long& val) const {
+        throwIfError(readValue(val));
+    }
+    void getValue(unsigned long& val) const {
+        throwIfError(readValue(val));
+    }
+    void getValue(long long& val) const {
+        throwIfError(readValue(val));
+    }
+    void getValue(unsigned long long& val) const {
+        throwIfError(readValue(val));
+    }
+    void getValue(float& val) const {
+        throwIfError(readValue(val));
+    }
+    void getValue(double& val) const {
+        throwIfError(readValue(val));
+    }
+    void getValue(std::string_view& val) const {
+        throwIfError(readValue(val));
+    }
+    void getValue(std::string& val) const {
+        throwIfError(readValue(val));
+    }
+    void getValue(std::pmr::string& val) const {
+        throwIfError(readValue(val));
+    }
+    void getValue(std::nullptr_t) const {
+        throwIfError(readValue(nullptr));
+    }
+    void getValue(std::nullopt_t) const {}
     /////////////////
 
 private:
     using tag = internal::tag;
 
-    explicit value(tag value_tag_, const size_t* payload_, const char* text_)
+    explicit value(tag value_tag_, const ast_word* payload_, const char* text_)
         : value_tag(value_tag_)
         , payload(payload_)
         , text(text_) {
     }
 
+    bool lazy_is_object() const { return text[payload[0]] == '{'; }
+
+    // convert the whole source of a raw number to T
+    // val is not modified if it can't be
+    template <typename T>
+    bool read_raw_number(T& val) const {
+        auto src = get_number_source();
+        auto res = HUSE_CHARCONV_NAMESPACE::from_chars(src.data(), src.data() + src.size(), val);
+        return res.ec == std::errc() && res.ptr == src.data() + src.size();
+    }
+
     inline void assert_tag([[maybe_unused]] tag expected) const { assert(expected == value_tag); }
 
     inline void assert_tag_2([[maybe_unused]] tag e1, [[maybe_unused]] tag e2) const {
@@ -576,7 +820,7 @@ private:
     }
 
     tag value_tag;
-    const size_t* payload;
+    const ast_word* payload;
     const char* text;
 
     friend class document;
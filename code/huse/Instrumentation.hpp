@@ -0,0 +1,76 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include <cstdint>
+
+// HUSE_INSTRUMENTATION
+// when enabled, serializers and deserializers collect per-root counters
+// when disabled (the default), the counters are compiled out and stats()
+// returns an all-zero struct
+#if !defined(HUSE_INSTRUMENTATION)
+#   define HUSE_INSTRUMENTATION 0
+#endif
+
+#if HUSE_INSTRUMENTATION
+#   include <chrono>
+#endif
+
+namespace huse {
+
+static inline constexpr bool Instrumentation_Enabled = !!HUSE_INSTRUMENTATION;
+
+// plain struct so it can be copied out and scraped
+struct InstrumentationCounters {
+    uint64_t bytesWritten = 0;
+    uint64_t bytesRead = 0;
+
+    uint64_t values = 0; // leaf values written or read
+    uint64_t objects = 0;
+    uint64_t arrays = 0;
+    uint32_t maxDepth = 0; // max nesting of objects and arrays
+
+    uint64_t keyLookups = 0; // lookups by key in deserializer objects
+    uint64_t linearKeySearches = 0; // lookups which missed the cursor and scanned keys
+    uint64_t binaryKeySearches = 0; // lookups which missed the cursor and bisected sorted keys
+
+    uint64_t stringStreamOpens = 0;
+
+    // phase timings in nanoseconds
+    uint64_t parseNs = 0;
+    uint64_t walkNs = 0; // time in root-level val() calls of deserializers
+    uint64_t serializeNs = 0; // time in root-level val() calls of serializers
+};
+
+static inline constexpr InstrumentationCounters No_Instrumentation_Counters = {};
+
+#if HUSE_INSTRUMENTATION
+namespace impl {
+using InstrClock = std::chrono::steady_clock;
+
+inline uint64_t nsSince(InstrClock::time_point start) {
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(InstrClock::now() - start).count());
+}
+
+// adds the time of its lifetime to target (if target is not null)
+class PhaseTimer {
+public:
+    explicit PhaseTimer(uint64_t* target)
+        : m_target(target)
+    {
+        if (m_target) m_start = InstrClock::now();
+    }
+    ~PhaseTimer() {
+        if (m_target) *m_target += nsSince(m_start);
+    }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+private:
+    uint64_t* m_target;
+    InstrClock::time_point m_start;
+};
+} // namespace impl
+#endif
+
+} // namespace huse
@@ -3,6 +3,8 @@
 //
 #pragma once
 #include "API.h"
+#include "Instrumentation.hpp"
+#include "Exception.hpp"
 #include "impl/Assert.hpp"
 #include <splat/warnings.h>
 #include <string_view>
@@ -52,6 +54,7 @@ public:
     virtual void closeArray() = 0;
 
     [[noreturn]] void throwException(const std::string& msg);
+    [[noreturn]] void throwException(ErrorCode code);
 
     // stack control (for debugging purposes)
     int curNodeId() const noexcept {
@@ -59,15 +62,41 @@ public:
     }
     int getNewNodeId() noexcept {
         m_curNodeId = m_freeNodeId++;
+#if HUSE_INSTRUMENTATION
+        // the root node is open for the lifetime of the serializer
+        // so the depth is the number of open nodes other than it
+        if (m_openNodes > m_stats.maxDepth) m_stats.maxDepth = m_openNodes;
+        ++m_openNodes;
+#endif
         return m_curNodeId;
     }
     void releaseNodeId([[maybe_unused]] int released, int newCur) noexcept {
         HUSE_ASSERT_USAGE(released == m_curNodeId, "node id mismatch");
         m_curNodeId = newCur;
+#if HUSE_INSTRUMENTATION
+        --m_openNodes;
+#endif
     }
+
+    // instrumentation counters (all zeroes if HUSE_INSTRUMENTATION is disabled)
+    const InstrumentationCounters& stats() const noexcept {
+#if HUSE_INSTRUMENTATION
+        return m_stats;
+#else
+        return No_Instrumentation_Counters;
+#endif
+    }
+#if HUSE_INSTRUMENTATION
+    InstrumentationCounters& _stats() noexcept { return m_stats; }
+#endif
 private:
     int m_freeNodeId = 0;
     int m_curNodeId = -1;
+
+#if HUSE_INSTRUMENTATION
+    uint32_t m_openNodes = 0;
+    InstrumentationCounters m_stats;
+#endif
 };
 
 } // namespace huse
@@ -1,5 +1,6 @@
 #pragma once
 #include "OpenStringStream.hpp"
+#include "Instrumentation.hpp"
 #include <iosfwd>
 #include <concepts>
 #include <string_view>
@@ -267,11 +268,17 @@ public:
 
 template <typename Serializer>
 SerializerArray<Serializer> SerializerNode<Serializer>::ar() {
+#if HUSE_INSTRUMENTATION
+    ++m_serializer->_stats().arrays;
+#endif
     m_serializer->openArray();
     return SerializerArray<Serializer>(*this, 0);
 }
 template <typename Serializer>
 SerializerObject<Serializer> SerializerNode<Serializer>::obj() {
+#if HUSE_INSTRUMENTATION
+    ++m_serializer->_stats().objects;
+#endif
     m_serializer->openObject();
     return SerializerObject<Serializer>(*this, 0);
 }
@@ -304,7 +311,14 @@ concept HasSerializeFlatFunc = requires(SerializerObject<Serializer>& obj, T t)
 template <typename Serializer>
 template <typename V>
 void SerializerNode<Serializer>::val(V&& v) {
+#if HUSE_INSTRUMENTATION
+    // the root node is the first one to get an id
+    impl::PhaseTimer timer(m_id == 0 ? &m_serializer->_stats().serializeNs : nullptr);
+#endif
     if constexpr (impl::HasWriteValue<Serializer, V>) {
+#if HUSE_INSTRUMENTATION
+        ++m_serializer->_stats().values;
+#endif
         m_serializer->writeValue(std::forward<V>(v));
     }
     else if constexpr (impl::HasSerializeMethod<V, Serializer>) {
@@ -334,6 +348,9 @@ void SerializerObject<Serializer>::flatval(FV&& v) {
 
 template <typename Serializer>
 SerializerSStream<Serializer> huseOpen(StringStream, SerializerNode<Serializer>& parent) {
+#if HUSE_INSTRUMENTATION
+    ++parent._s()._stats().stringStreamOpens;
+#endif
     return SerializerSStream<Serializer>(parent, parent._s().openStringStream());
 }
 
@@ -14,6 +14,9 @@ Serializer::~Serializer() = default;
 void Serializer::throwException(const std::string& msg) {
     throw SerializerException(msg);
 }
+void Serializer::throwException(ErrorCode code) {
+    throw SerializerException(code);
+}
 
 Exception::~Exception() = default;
 SerializerException::~SerializerException() = default;
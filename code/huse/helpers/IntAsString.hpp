@@ -41,7 +41,7 @@ struct IntAsStringOpt {
             i = *emptyStringVal;
         }
         else if (!impl::int_from_string(val, i)) {
-            n.throwException("not an integer");
+            n.throwException(ErrorCode::NotInteger);
         }
     }
 };
@@ -5,6 +5,9 @@
 #include "../SerializerNode.hpp"
 #include "../DeserializerNode.hpp"
 
+#include <iterator>
+#include <memory>
+
 namespace huse {
 
 // a serialization functor for map-like objects
@@ -29,26 +32,70 @@ struct MapLike {
 
     template <typename D, typename Map>
     void operator()(DeserializerNode<D>& n, Map& map) const {
-        using KvPair = std::pair<typename Map::key_type, typename Map::mapped_type>;
+        using Key = typename Map::key_type;
+        using KvPair = std::pair<Key, typename Map::mapped_type>;
 
-        if constexpr (std::is_convertible_v<typename Map::key_type, std::string_view>) {
+        // with the allocator of the map (if the key or the value use it), so that inserting moves
+        auto make = [&]<typename T>() {
+            if constexpr (requires { map.get_allocator(); }) {
+                return std::make_obj_using_allocator<T>(map.get_allocator());
+            }
+            else {
+                return T{};
+            }
+        };
+
+        // values are constructed in place in the map and read directly into it
+        // as with emplace, the values of existing keys are not overwritten
+        auto insert = [&](Key&& key, auto&& readValue) {
+            if constexpr (requires { map.try_emplace(std::move(key)); }) {
+                const auto size = map.size();
+                auto it = [&] {
+                    if constexpr (requires { map.key_comp(); }) {
+                        // keys which come in order (as written from an ordered map) are inserted
+                        // at the end in amortized O(1)
+                        if (map.empty() || map.key_comp()(std::prev(map.end())->first, key)) {
+                            return map.try_emplace(map.end(), std::move(key));
+                        }
+                    }
+                    return map.try_emplace(std::move(key)).first;
+                }();
+                if (map.size() != size) readValue(it->second);
+            }
+            else {
+                auto val = make.template operator()<KvPair>();
+                val.first = std::move(key);
+                readValue(val.second);
+                map.emplace(std::move(val));
+            }
+        };
+
+        auto reserve = [&](int len) {
+            if constexpr (requires { map.reserve(map.size()); }) {
+                map.reserve(map.size() + size_t(len));
+            }
+        };
+
+        if constexpr (std::is_convertible_v<Key, std::string_view>) {
             auto obj = n.obj();
             const int len = obj.size();
+            reserve(len);
             for (int i = 0; i < len; ++i) {
-                KvPair val;
-                obj.keyval(val.first, val.second);
-                map.emplace(std::move(val));
+                auto kv = obj.keyval();
+                auto key = make.template operator()<Key>();
+                impl::assignKey(key, kv.first);
+                insert(std::move(key), [&](auto& val) { kv.second.val(val); });
             }
         }
         else {
             auto ar = n.ar();
             const int len = ar.size();
+            reserve(len);
             for (int i = 0; i < len; ++i) {
-                KvPair val;
                 auto pair = ar.obj();
-                pair.val("key", val.first);
-                pair.val("value", val.second);
-                map.emplace(std::move(val));
+                auto key = make.template operator()<Key>();
+                pair.val("key", key);
+                insert(std::move(key), [&](auto& val) { pair.val("value", val); });
             }
         }
     }
@@ -0,0 +1,41 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "../SerializerNode.hpp"
+#include "../DeserializerNode.hpp"
+
+#include <memory>
+
+namespace huse {
+
+// a serialization functor for set-like objects
+struct SetLike {
+    template <typename S, typename Set>
+    void operator()(SerializerNode<S>& n, const Set& set) const {
+        auto ar = n.ar();
+        for (auto& val : set) {
+            ar.val(val);
+        }
+    }
+
+    template <typename D, typename Set>
+    void operator()(DeserializerNode<D>& n, Set& set) const {
+        using Value = typename Set::value_type;
+
+        auto ar = n.ar();
+        const int len = ar.size();
+        if constexpr (requires { set.reserve(set.size()); }) {
+            set.reserve(set.size() + size_t(len));
+        }
+        for (int i = 0; i < len; ++i) {
+            // with the allocator of the set (if the value uses it), so that inserting moves
+            auto val = std::make_obj_using_allocator<Value>(set.get_allocator());
+            ar.val(val);
+            // the hint makes inserting sorted values into ordered sets amortized O(1)
+            set.emplace_hint(set.end(), std::move(val));
+        }
+    }
+};
+
+}
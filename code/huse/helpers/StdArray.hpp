@@ -0,0 +1,30 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "../SerializerNode.hpp"
+#include "../DeserializerNode.hpp"
+
+#include <array>
+
+namespace huse {
+template <typename S, typename T, size_t N>
+void huseSerialize(SerializerNode<S>& n, const std::array<T, N>& arr) {
+    auto ar = n.ar();
+    for (auto& val : arr) {
+        ar.val(val);
+    }
+}
+
+// the input must have exactly N elements
+template <typename D, typename T, size_t N>
+void huseDeserialize(DeserializerNode<D>& n, std::array<T, N>& arr) {
+    auto ar = n.ar();
+    if (size_t(ar.size()) != N) {
+        ar.throwException(ErrorCode::SizeMismatch);
+    }
+    for (auto& val : arr) {
+        ar.val(val);
+    }
+}
+}
@@ -0,0 +1,18 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "VectorLike.hpp"
+
+#include <deque>
+
+namespace huse {
+template <typename S, typename T, typename A>
+void huseSerialize(SerializerNode<S>& n, const std::deque<T, A>& deq) {
+    VectorLike{}(n, deq);
+}
+template <typename D, typename T, typename A>
+void huseDeserialize(DeserializerNode<D>& n, std::deque<T, A>& deq) {
+    VectorLike{}(n, deq);
+}
+}
@@ -0,0 +1,27 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "../SerializerNode.hpp"
+#include "../DeserializerNode.hpp"
+
+#include <optional>
+
+namespace huse {
+// empty optionals are written as null (so they can be array elements)
+// to omit object keys instead, use obj.val(key, std::nullopt) and obj.optval
+template <typename S, typename T>
+void huseSerialize(SerializerNode<S>& n, const std::optional<T>& opt) {
+    if (opt) n.val(*opt);
+    else n.val(nullptr);
+}
+template <typename D, typename T>
+void huseDeserialize(DeserializerNode<D>& n, std::optional<T>& opt) {
+    if (n.type().isNull()) {
+        opt.reset();
+        return;
+    }
+    if (!opt) opt.emplace();
+    n.val(*opt);
+}
+}
@@ -0,0 +1,26 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "SetLike.hpp"
+
+#include <set>
+
+namespace huse {
+template <typename S, typename T, typename C, typename A>
+void huseSerialize(SerializerNode<S>& n, const std::set<T, C, A>& set) {
+    SetLike{}(n, set);
+}
+template <typename D, typename T, typename C, typename A>
+void huseDeserialize(DeserializerNode<D>& n, std::set<T, C, A>& set) {
+    SetLike{}(n, set);
+}
+template <typename S, typename T, typename C, typename A>
+void huseSerialize(SerializerNode<S>& n, const std::multiset<T, C, A>& set) {
+    SetLike{}(n, set);
+}
+template <typename D, typename T, typename C, typename A>
+void huseDeserialize(DeserializerNode<D>& n, std::multiset<T, C, A>& set) {
+    SetLike{}(n, set);
+}
+}
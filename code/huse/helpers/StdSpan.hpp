@@ -0,0 +1,31 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "../SerializerNode.hpp"
+#include "../DeserializerNode.hpp"
+
+#include <span>
+
+namespace huse {
+template <typename S, typename T, size_t E>
+void huseSerialize(SerializerNode<S>& n, std::span<T, E> span) {
+    auto ar = n.ar();
+    for (auto& val : span) {
+        ar.val(val);
+    }
+}
+
+// reads into the elements of the span, so the input must have exactly as many
+template <typename D, typename T, size_t E>
+    requires (!std::is_const_v<T>)
+void huseDeserialize(DeserializerNode<D>& n, std::span<T, E>& span) {
+    auto ar = n.ar();
+    if (size_t(ar.size()) != span.size()) {
+        ar.throwException(ErrorCode::SizeMismatch);
+    }
+    for (auto& val : span) {
+        ar.val(val);
+    }
+}
+}
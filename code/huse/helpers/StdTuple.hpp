@@ -0,0 +1,46 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "../SerializerNode.hpp"
+#include "../DeserializerNode.hpp"
+
+#include <tuple>
+#include <utility>
+
+// tuples and pairs are written as arrays of their elements
+
+namespace huse {
+namespace impl {
+template <typename S, typename Tuple>
+void serializeTuple(SerializerNode<S>& n, const Tuple& tuple) {
+    auto ar = n.ar();
+    std::apply([&](const auto&... elems) { (ar.val(elems), ...); }, tuple);
+}
+template <typename D, typename Tuple>
+void deserializeTuple(DeserializerNode<D>& n, Tuple& tuple) {
+    auto ar = n.ar();
+    if (size_t(ar.size()) != std::tuple_size_v<Tuple>) {
+        ar.throwException(ErrorCode::SizeMismatch);
+    }
+    std::apply([&](auto&... elems) { (ar.val(elems), ...); }, tuple);
+}
+}
+
+template <typename S, typename... Ts>
+void huseSerialize(SerializerNode<S>& n, const std::tuple<Ts...>& tuple) {
+    impl::serializeTuple(n, tuple);
+}
+template <typename D, typename... Ts>
+void huseDeserialize(DeserializerNode<D>& n, std::tuple<Ts...>& tuple) {
+    impl::deserializeTuple(n, tuple);
+}
+template <typename S, typename A, typename B>
+void huseSerialize(SerializerNode<S>& n, const std::pair<A, B>& pair) {
+    impl::serializeTuple(n, pair);
+}
+template <typename D, typename A, typename B>
+void huseDeserialize(DeserializerNode<D>& n, std::pair<A, B>& pair) {
+    impl::deserializeTuple(n, pair);
+}
+}
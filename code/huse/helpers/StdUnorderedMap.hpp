@@ -0,0 +1,18 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "MapLike.hpp"
+
+#include <unordered_map>
+
+namespace huse {
+template <typename S, typename K, typename V, typename H, typename E, typename A>
+void huseSerialize(SerializerNode<S>& n, const std::unordered_map<K, V, H, E, A>& map) {
+    MapLike{}(n, map);
+}
+template <typename D, typename K, typename V, typename H, typename E, typename A>
+void huseDeserialize(DeserializerNode<D>& n, std::unordered_map<K, V, H, E, A>& map) {
+    MapLike{}(n, map);
+}
+}
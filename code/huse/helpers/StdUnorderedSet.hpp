@@ -0,0 +1,18 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "SetLike.hpp"
+
+#include <unordered_set>
+
+namespace huse {
+template <typename S, typename T, typename H, typename E, typename A>
+void huseSerialize(SerializerNode<S>& n, const std::unordered_set<T, H, E, A>& set) {
+    SetLike{}(n, set);
+}
+template <typename D, typename T, typename H, typename E, typename A>
+void huseDeserialize(DeserializerNode<D>& n, std::unordered_set<T, H, E, A>& set) {
+    SetLike{}(n, set);
+}
+}
@@ -0,0 +1,33 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "../SerializerNode.hpp"
+#include "../DeserializerNode.hpp"
+
+#include <variant>
+#include <utility>
+
+namespace huse {
+// variants are written as {"index": <alternative index>, "value": <value>}
+template <typename S, typename... Ts>
+void huseSerialize(SerializerNode<S>& n, const std::variant<Ts...>& var) {
+    auto obj = n.obj();
+    obj.val("index", var.index());
+    std::visit([&](const auto& val) { obj.val("value", val); }, var);
+}
+template <typename D, typename... Ts>
+void huseDeserialize(DeserializerNode<D>& n, std::variant<Ts...>& var) {
+    auto obj = n.obj();
+    size_t index;
+    obj.val("index", index);
+    if (index >= sizeof...(Ts)) {
+        obj.key("index").throwException(ErrorCode::IndexOutOfBounds);
+    }
+    auto value = obj.key("value");
+    [&]<size_t... I>(std::index_sequence<I...>) {
+        // the alternative is constructed in place and read directly
+        ((I == index ? (value.val(var.template emplace<I>()), true) : false) || ...);
+    }(std::index_sequence_for<Ts...>{});
+}
+}
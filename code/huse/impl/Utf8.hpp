@@ -0,0 +1,89 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace huse::impl {
+
+// strict UTF-8 validation (RFC 3629)
+// overlong forms, surrogates, and code points above U+10FFFF are invalid
+//
+// the checks are the ones of table 3-7 of the Unicode standard: a lead byte
+// determines the number of continuation bytes and the range of the first one
+// ascii is skipped a word at a time, so text which is mostly ascii costs
+// little more than a scan
+
+// state between chunks of text (a sequence can be split between them)
+struct Utf8State {
+    uint8_t remaining = 0; // continuation bytes of the current sequence
+    uint8_t lo = 0x80, hi = 0xBF; // range of the next continuation byte
+
+    bool complete() const { return remaining == 0; }
+
+    // false if c is invalid at this point
+    bool step(uint8_t c) {
+        if (remaining) {
+            if (c < lo || c > hi) return false;
+            lo = 0x80;
+            hi = 0xBF;
+            --remaining;
+            return true;
+        }
+        if (c < 0x80) return true;
+        if (c < 0xC2) return false; // continuation byte or overlong 2-byte form
+        if (c < 0xE0) {
+            remaining = 1;
+        }
+        else if (c < 0xF0) {
+            remaining = 2;
+            if (c == 0xE0) lo = 0xA0; // overlong
+            else if (c == 0xED) hi = 0x9F; // surrogates
+        }
+        else if (c < 0xF5) {
+            remaining = 3;
+            if (c == 0xF0) lo = 0x90; // overlong
+            else if (c == 0xF4) hi = 0x8F; // above U+10FFFF
+        }
+        else {
+            return false;
+        }
+        return true;
+    }
+};
+
+// non-zero if a byte of the word at p is not ascii
+inline uint64_t hasNonAscii8(const char* p) {
+    uint64_t w;
+    memcpy(&w, p, sizeof(w));
+    return w & 0x8080808080808080ull;
+}
+
+// first invalid byte in [p, end) continuing from state, or nullptr if there is none
+// a sequence which is incomplete at end is not invalid: check state.complete()
+inline const char* findInvalidUtf8(Utf8State& state, const char* p, const char* end) {
+    while (p != end) {
+        if (state.complete()) {
+            while (end - p >= 8 && !hasNonAscii8(p)) p += 8;
+            if (p == end) break;
+        }
+        if (!state.step(uint8_t(*p))) return p;
+        ++p;
+    }
+    return nullptr;
+}
+
+// length of the valid sequence at p (which must be before end), or 0 if it's invalid or incomplete
+inline size_t utf8SequenceLength(const char* p, const char* end) {
+    Utf8State state;
+    const char* begin = p;
+    do {
+        if (!state.step(uint8_t(*p))) return 0;
+        ++p;
+    } while (!state.complete() && p != end);
+    return state.complete() ? size_t(p - begin) : 0;
+}
+
+} // namespace huse::impl
@@ -0,0 +1,143 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace huse::impl {
+
+// streaming XXH64 (https://github.com/Cyan4973/xxHash)
+// a fast non-cryptographic hash: the result is the same as the one of the reference
+// implementation, regardless of how the input is split between calls to update
+class Xxh64 {
+public:
+    explicit Xxh64(uint64_t seed = 0) { reset(seed); }
+
+    void reset(uint64_t seed = 0) {
+        m_v[0] = seed + P1 + P2;
+        m_v[1] = seed + P2;
+        m_v[2] = seed;
+        m_v[3] = seed - P1;
+        m_seed = seed;
+        m_total = 0;
+        m_memSize = 0;
+    }
+
+    void update(const void* data, size_t size) {
+        auto p = static_cast<const char*>(data);
+        const auto end = p + size;
+        m_total += size;
+
+        if (m_memSize + size < Stripe) {
+            memcpy(m_mem + m_memSize, p, size);
+            m_memSize += size;
+            return;
+        }
+
+        if (m_memSize) {
+            const size_t fill = Stripe - m_memSize;
+            memcpy(m_mem + m_memSize, p, fill);
+            p += fill;
+            stripe(m_mem);
+            m_memSize = 0;
+        }
+
+        for (; end - p >= ptrdiff_t(Stripe); p += Stripe) {
+            stripe(p);
+        }
+
+        m_memSize = size_t(end - p);
+        memcpy(m_mem, p, m_memSize);
+    }
+
+    uint64_t digest() const {
+        uint64_t h;
+        if (m_total >= Stripe) {
+            h = std::rotl(m_v[0], 1) + std::rotl(m_v[1], 7) + std::rotl(m_v[2], 12) + std::rotl(m_v[3], 18);
+            for (auto v : m_v) {
+                h ^= round(0, v);
+                h = h * P1 + P4;
+            }
+        }
+        else {
+            h = m_seed + P5;
+        }
+        h += m_total;
+
+        auto p = m_mem;
+        const auto end = m_mem + m_memSize;
+        for (; end - p >= 8; p += 8) {
+            h ^= round(0, read64(p));
+            h = std::rotl(h, 27) * P1 + P4;
+        }
+        if (end - p >= 4) {
+            h ^= read32(p) * P1;
+            h = std::rotl(h, 23) * P2 + P3;
+            p += 4;
+        }
+        for (; p != end; ++p) {
+            h ^= uint8_t(*p) * P5;
+            h = std::rotl(h, 11) * P1;
+        }
+
+        h ^= h >> 33;
+        h *= P2;
+        h ^= h >> 29;
+        h *= P3;
+        h ^= h >> 32;
+        return h;
+    }
+
+private:
+    static constexpr uint64_t P1 = 0x9E3779B185EBCA87ull;
+    static constexpr uint64_t P2 = 0xC2B2AE3D27D4EB4Full;
+    static constexpr uint64_t P3 = 0x165667B19E3779F9ull;
+    static constexpr uint64_t P4 = 0x85EBCA77C2B2AE63ull;
+    static constexpr uint64_t P5 = 0x27D4EB2F165667C5ull;
+    static constexpr size_t Stripe = 32;
+
+    // the input is read as little endian
+    static uint64_t read64(const char* p) {
+        uint64_t ret;
+        memcpy(&ret, p, sizeof(ret));
+        if constexpr (std::endian::native == std::endian::big) {
+            uint64_t swapped = 0;
+            for (int i = 0; i < 8; ++i) {
+                swapped = (swapped << 8) | (ret & 0xFF);
+                ret >>= 8;
+            }
+            ret = swapped;
+        }
+        return ret;
+    }
+    static uint64_t read32(const char* p) {
+        uint64_t ret = 0;
+        for (int i = 3; i >= 0; --i) {
+            ret = (ret << 8) | uint8_t(p[i]);
+        }
+        return ret;
+    }
+
+    static uint64_t round(uint64_t acc, uint64_t input) {
+        acc += input * P2;
+        acc = std::rotl(acc, 31);
+        return acc * P1;
+    }
+
+    void stripe(const char* p) {
+        for (int i = 0; i < 4; ++i) {
+            m_v[i] = round(m_v[i], read64(p + i * 8));
+        }
+    }
+
+    uint64_t m_v[4];
+    uint64_t m_seed;
+    uint64_t m_total;
+    char m_mem[Stripe];
+    size_t m_memSize;
+};
+
+} // namespace huse::impl
@@ -0,0 +1,57 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include "AsyncOutput.hpp"
+#include "../impl/Assert.hpp"
+#include <cstring>
+
+namespace huse::json {
+
+AsyncOutput::AsyncOutput(size_t capacity)
+    : m_capacity(capacity)
+    , m_buf(new char[capacity * 2])
+    , m_size(capacity * 2)
+    , m_begin(m_buf.get())
+    , m_stream(this)
+{
+    HUSE_ASSERT_USAGE(capacity > 0, "zero capacity");
+    setp(m_buf.get(), m_buf.get() + m_size);
+}
+
+AsyncOutput::~AsyncOutput() = default;
+
+void AsyncOutput::consume(size_t n) {
+    HUSE_ASSERT_USAGE(n <= pending().size(), "consuming more than is pending");
+    m_begin += n;
+    if (m_begin == pptr()) {
+        // everything is consumed: start over
+        m_begin = m_buf.get();
+        setp(m_buf.get(), m_buf.get() + m_size);
+    }
+}
+
+AsyncOutput::int_type AsyncOutput::overflow(int_type ch) {
+    const size_t pendingSize = pending().size();
+    if (m_begin != m_buf.get()) {
+        // make room by moving the pending output to the start
+        memmove(m_buf.get(), m_begin, pendingSize);
+    }
+    else {
+        // a value which doesn't fit the buffer
+        const size_t size = m_size * 2;
+        std::unique_ptr<char[]> buf(new char[size]);
+        memcpy(buf.get(), m_begin, pendingSize);
+        m_buf = std::move(buf);
+        m_size = size;
+    }
+    // the put area only needs to start at the end of the pending output
+    m_begin = m_buf.get();
+    setp(m_buf.get() + pendingSize, m_buf.get() + m_size);
+
+    if (traits_type::eq_int_type(ch, traits_type::eof())) return traits_type::not_eof(ch);
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+    return ch;
+}
+
+} // namespace huse::json
@@ -0,0 +1,135 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "../API.h"
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string_view>
+#include <utility>
+#include <cstddef>
+
+namespace huse::json {
+
+// output of a serializer with backpressure: json is produced by a coroutine which suspends
+// when the output is full, and is resumed when a consumer (like an event loop writing to a
+// socket or pipe) has drained it
+//
+//      json::SerializeTask produce(json::AsyncOutput& out, const Items& items) {
+//          json::SerializerRoot s(out.stream());
+//          auto ar = s.ar();
+//          for (auto& item : items) {
+//              ar.val(item);
+//              co_await out.drain();
+//          }
+//      }
+//
+//      json::AsyncOutput out(64 * 1024);
+//      auto task = produce(out, items);
+//      while (!task.done()) {
+//          task.resume(); // until the output is full or the json is complete
+//          while (!out.pending().empty()) {
+//              out.consume(send(out.pending())); // wait for the socket to be writable if needed
+//          }
+//      }
+//
+// the producer can only suspend between the values which it writes, so the output is
+// full when the pending output reaches the capacity, but the buffer is twice as big
+// to fit the value which is being written then
+// values bigger than the capacity grow the buffer
+// so peak memory is bounded by the capacity and the largest value written between
+// suspensions, and not by the size of the json
+class HUSE_API AsyncOutput : private std::streambuf {
+public:
+    explicit AsyncOutput(size_t capacity);
+    ~AsyncOutput();
+
+    AsyncOutput(const AsyncOutput&) = delete;
+    AsyncOutput& operator=(const AsyncOutput&) = delete;
+
+    // the stream for the serializer
+    std::ostream& stream() { return m_stream; }
+
+    // the output which is ready to be consumed
+    std::string_view pending() const { return std::string_view(m_begin, size_t(pptr() - m_begin)); }
+
+    // mark the first n bytes of pending() as consumed
+    void consume(size_t n);
+
+    size_t capacity() const { return m_capacity; }
+    bool full() const { return pending().size() >= m_capacity; }
+
+    // size of the buffer (twice the capacity, unless a bigger value grew it)
+    size_t bufferSize() const { return m_size; }
+
+    // awaitable which suspends the producer if the output is full
+    struct DrainAwaitable {
+        const AsyncOutput& output;
+        bool await_ready() const noexcept { return !output.full(); }
+        void await_suspend(std::coroutine_handle<>) const noexcept {}
+        void await_resume() const noexcept {}
+    };
+    DrainAwaitable drain() const { return {*this}; }
+
+private:
+    virtual int_type overflow(int_type ch) override;
+
+    const size_t m_capacity;
+    std::unique_ptr<char[]> m_buf;
+    size_t m_size;
+    char* m_begin; // of the pending output
+    std::ostream m_stream;
+};
+
+// coroutine which produces json (see AsyncOutput)
+// it's started by the first call to resume()
+class SerializeTask {
+public:
+    struct promise_type {
+        std::exception_ptr exception;
+
+        SerializeTask get_return_object() {
+            return SerializeTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { exception = std::current_exception(); }
+    };
+
+    SerializeTask(SerializeTask&& other) noexcept
+        : m_handle(std::exchange(other.m_handle, nullptr))
+    {}
+    SerializeTask& operator=(SerializeTask&& other) noexcept {
+        if (this != &other) {
+            if (m_handle) m_handle.destroy();
+            m_handle = std::exchange(other.m_handle, nullptr);
+        }
+        return *this;
+    }
+
+    ~SerializeTask() {
+        if (m_handle) m_handle.destroy();
+    }
+
+    bool done() const { return !m_handle || m_handle.done(); }
+
+    // run the producer until it suspends or completes
+    // rethrows exceptions of the producer (the task is done after that)
+    void resume() {
+        if (done()) return;
+        m_handle.resume();
+        if (auto ex = std::exchange(m_handle.promise().exception, nullptr)) {
+            std::rethrow_exception(ex);
+        }
+    }
+
+private:
+    explicit SerializeTask(std::coroutine_handle<promise_type> h) : m_handle(h) {}
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+} // namespace huse::json
@@ -0,0 +1,156 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include "CanonicalSerializer.hpp"
+#include "../impl/Assert.hpp"
+#include <algorithm>
+#include <numeric>
+#include <cstring>
+
+namespace huse::json {
+
+namespace impl {
+
+namespace {
+constexpr size_t Buffer_Size = 16 * 1024;
+}
+
+CanonicalStreambuf::CanonicalStreambuf(std::ostream* out)
+    : m_out(out ? out->rdbuf() : nullptr)
+    , m_buf(Buffer_Size)
+{
+    setp(m_buf.data(), m_buf.data() + m_buf.size());
+}
+
+CanonicalStreambuf::~CanonicalStreambuf() {
+    // open objects mean that an exception interrupted the serializer
+    if (m_objects.empty()) flush();
+}
+
+void CanonicalStreambuf::flush() {
+    const size_t size = written();
+    m_hash.update(m_buf.data(), size);
+    if (m_out) m_out->sputn(m_buf.data(), std::streamsize(size));
+    setp(m_buf.data(), m_buf.data() + m_buf.size());
+}
+
+CanonicalStreambuf::int_type CanonicalStreambuf::overflow(int_type ch) {
+    if (m_objects.empty()) {
+        flush();
+    }
+    else {
+        // the members of open objects stay in the buffer until they are sorted
+        const size_t size = written();
+        m_buf.resize(m_buf.size() * 2);
+        setp(m_buf.data() + size, m_buf.data() + m_buf.size());
+    }
+
+    if (traits_type::eq_int_type(ch, traits_type::eof())) return traits_type::not_eof(ch);
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+    return ch;
+}
+
+int CanonicalStreambuf::sync() {
+    if (!m_objects.empty()) return 0;
+    flush();
+    return m_out ? m_out->pubsync() : 0;
+}
+
+void CanonicalStreambuf::openObject() {
+    m_objects.push_back({m_members.size(), m_keys.size()});
+}
+
+void CanonicalStreambuf::member(std::string_view key) {
+    HUSE_ASSERT_INTERNAL(!m_objects.empty());
+    m_members.push_back({m_keys.size(), key.size(), written()});
+    m_keys.append(key);
+}
+
+void CanonicalStreambuf::closeObject() {
+    HUSE_ASSERT_INTERNAL(!m_objects.empty());
+    const auto obj = m_objects.back();
+    m_objects.pop_back();
+
+    const Member* members = m_members.data() + obj.firstMember;
+    const auto numMembers = uint32_t(m_members.size() - obj.firstMember);
+    auto key = [&](uint32_t i) {
+        return std::string_view(m_keys.data() + members[i].key, members[i].keySize);
+    };
+
+    bool sorted = true;
+    for (uint32_t i = 1; i < numMembers; ++i) {
+        if (key(i) < key(i - 1)) {
+            sorted = false;
+            break;
+        }
+    }
+
+    if (!sorted) {
+        m_order.resize(numMembers);
+        std::iota(m_order.begin(), m_order.end(), 0);
+        // stable, so that duplicate keys keep their order
+        auto less = [&](uint32_t a, uint32_t b) { return key(a) < key(b); };
+        if (numMembers <= 16) {
+            // insertion sort is faster for small objects and doesn't allocate
+            for (uint32_t i = 1; i < numMembers; ++i) {
+                const auto m = m_order[i];
+                uint32_t j = i;
+                for (; j > 0 && less(m, m_order[j - 1]); --j) {
+                    m_order[j] = m_order[j - 1];
+                }
+                m_order[j] = m;
+            }
+        }
+        else {
+            std::stable_sort(m_order.begin(), m_order.end(), less);
+        }
+
+        // members are separated by commas which are not part of them
+        const size_t begin = members[0].begin;
+        const size_t end = written();
+        auto memberEnd = [&](uint32_t i) {
+            return i + 1 < numMembers ? members[i + 1].begin - 1 : end;
+        };
+
+        m_sorted.resize(end - begin);
+        char* out = m_sorted.data();
+        for (uint32_t i = 0; i < numMembers; ++i) {
+            if (i) *out++ = ',';
+            const auto m = m_order[i];
+            out = std::copy(m_buf.data() + members[m].begin, m_buf.data() + memberEnd(m), out);
+        }
+        HUSE_ASSERT_INTERNAL(out == m_sorted.data() + m_sorted.size());
+        memcpy(m_buf.data() + begin, m_sorted.data(), m_sorted.size());
+    }
+
+    m_members.resize(obj.firstMember);
+    m_keys.resize(obj.keysSize);
+}
+
+uint64_t CanonicalStreambuf::hash() {
+    HUSE_ASSERT_USAGE(m_objects.empty(), "hash of an incomplete object");
+    flush();
+    return m_hash.digest();
+}
+
+} // namespace impl
+
+CanonicalJsonSerializer::CanonicalJsonSerializer()
+    : CanonicalStream(nullptr)
+    , JsonSerializer(stream, buf)
+{}
+
+CanonicalJsonSerializer::CanonicalJsonSerializer(std::ostream& out)
+    : CanonicalStream(&out)
+    , JsonSerializer(stream, buf)
+{}
+
+// export vtable
+CanonicalJsonSerializer::~CanonicalJsonSerializer() = default;
+
+uint64_t CanonicalJsonSerializer::hash() {
+    return buf.hash();
+}
+
+} // namespace huse::json
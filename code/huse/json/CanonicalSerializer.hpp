@@ -0,0 +1,115 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "../API.h"
+#include "Serializer.hpp"
+#include "../SerializerNode.hpp"
+#include "../impl/Xxh64.hpp"
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+// canonical json and its hash, for etags and dedupe keys:
+//
+//      auto etag = json::canonicalHash([&](auto& n) { n.val(data); });
+//
+// or to write the canonical json and get its hash from the same pass:
+//
+//      json::CanonicalJsonSerializer s(out);
+//      huse::SerializerNode<json::JsonSerializer>(s).val(data);
+//      auto etag = s.hash();
+
+namespace huse::json {
+
+namespace impl {
+// buffers the members of open objects to sort them when they are closed
+// everything else is hashed and written to the output (if any) when the buffer is full
+// so the memory is bounded by the largest object and not by the size of the json
+class CanonicalStreambuf : public std::streambuf {
+public:
+    explicit CanonicalStreambuf(std::ostream* out);
+    ~CanonicalStreambuf();
+
+    // called by the serializer (after the '{' and before the '}' are written)
+    void openObject();
+    void closeObject();
+    // called before the key of a member of the current object is written
+    void member(std::string_view key);
+
+    // hash of the output so far (all objects must be closed)
+    uint64_t hash();
+
+protected:
+    virtual int_type overflow(int_type ch) override;
+    virtual int sync() override;
+
+private:
+    size_t written() const { return size_t(pptr() - m_buf.data()); }
+    void flush();
+
+    struct Member {
+        size_t key; // offset in m_keys
+        size_t keySize;
+        size_t begin; // offset in m_buf
+    };
+    struct Object {
+        size_t firstMember; // index in m_members
+        size_t keysSize; // of m_keys when the object was opened
+    };
+
+    std::streambuf* const m_out;
+    std::vector<char> m_buf;
+    std::vector<Object> m_objects; // open ones
+    std::vector<Member> m_members; // of open objects
+    std::string m_keys; // of open objects (unescaped)
+    std::vector<uint32_t> m_order; // scratch for sorting members
+    std::vector<char> m_sorted; // scratch for sorting members
+    huse::impl::Xxh64 m_hash;
+};
+
+// initialized before the serializer which uses it
+struct CanonicalStream {
+    explicit CanonicalStream(std::ostream* out) : buf(out) {}
+    CanonicalStreambuf buf;
+    std::ostream stream{&buf};
+};
+} // namespace impl
+
+// serializer which writes canonical json: the same values produce the same bytes
+// * object members are sorted by their keys (by UTF-8 bytes, which is by code points)
+// * floating point numbers are written like in ECMAScript (as in RFC 8785), so a number
+//   is written the same way, regardless of the type which holds it (1.0 is 1, -0.0 is 0)
+// * there is no whitespace
+// the output is hashed (with XXH64) while it's written, so the hash comes from the same pass
+// without an output stream only the hash is computed and nothing is written
+//
+// RawJson is written as is and is not canonicalized
+// the output is written to the stream when the buffer is full (outside of objects)
+// and when the serializer is destroyed
+class HUSE_API CanonicalJsonSerializer : private impl::CanonicalStream, public JsonSerializer {
+public:
+    // only compute the hash
+    CanonicalJsonSerializer();
+    explicit CanonicalJsonSerializer(std::ostream& out);
+    ~CanonicalJsonSerializer();
+
+    // XXH64 of the output so far (all objects must be closed)
+    uint64_t hash();
+};
+
+// hash of the canonical json which f writes to the node which it gets (a SerializerNode<JsonSerializer>)
+template <typename F>
+uint64_t canonicalHash(F&& f) {
+    CanonicalJsonSerializer s;
+    {
+        SerializerNode<JsonSerializer> node(s);
+        f(node);
+    }
+    return s.hash();
+}
+
+} // namespace huse::json
@@ -0,0 +1,252 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include "Deflate.hpp"
+#include "../Exception.hpp"
+#include "../impl/Assert.hpp"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <exception>
+
+namespace huse::json {
+
+namespace {
+constexpr size_t Buffer_Size = 64 * 1024;
+
+int windowBits(DeflateFormat format) {
+    switch (format) {
+    case DeflateFormat::Raw: return -MAX_WBITS;
+    case DeflateFormat::Zlib: return MAX_WBITS;
+    case DeflateFormat::Gzip: return MAX_WBITS + 16;
+    }
+    return MAX_WBITS;
+}
+
+// zlib's messages are static
+[[noreturn]] void throwDeflateError(const z_stream& z) {
+    throw SerializerException(ErrorCode::Compression, z.msg);
+}
+
+[[noreturn]] void throwInflateError(const char* msg) {
+    throw DeserializerException(ErrorCode::Compression, msg);
+}
+
+Bytef* bytes(const char* p) {
+    return reinterpret_cast<Bytef*>(const_cast<char*>(p));
+}
+} // namespace
+
+DeflateOutput::DeflateOutput(std::ostream& out, int level, DeflateFormat format)
+    : m_target(*out.rdbuf())
+    , m_z(std::make_unique<z_stream>())
+    , m_in(new char[Buffer_Size])
+    , m_out(new char[Buffer_Size])
+    , m_stream(this)
+{
+    if (deflateInit2(m_z.get(), level, Z_DEFLATED, windowBits(format), 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        throwDeflateError(*m_z);
+    }
+    setp(m_in.get(), m_in.get() + Buffer_Size);
+    // rethrow the errors of the streambuf instead of only setting badbit
+    m_stream.exceptions(std::ios_base::badbit);
+}
+
+DeflateOutput::~DeflateOutput() {
+    if (!m_finished && !std::uncaught_exceptions()) {
+        try {
+            finish();
+        }
+        catch (...) {
+            // nothing smart to do
+        }
+    }
+    deflateEnd(m_z.get());
+}
+
+void DeflateOutput::compress(const char* data, size_t size, int flush) {
+    auto& z = *m_z;
+    z.next_in = bytes(data);
+    m_inSize += size;
+
+    // avail_in is 32-bit
+    do {
+        const size_t chunk = std::min<size_t>(size, UINT_MAX);
+        z.avail_in = uInt(chunk);
+        size -= chunk;
+        const int chunkFlush = size ? Z_NO_FLUSH : flush;
+
+        do {
+            z.next_out = bytes(m_out.get());
+            z.avail_out = uInt(Buffer_Size);
+            const int ret = deflate(&z, chunkFlush);
+            if (ret == Z_STREAM_ERROR) throwDeflateError(z);
+            const size_t have = Buffer_Size - z.avail_out;
+            if (size_t(m_target.sputn(m_out.get(), std::streamsize(have))) != have) {
+                throw SerializerException(ErrorCode::Compression, "can't write compressed output");
+            }
+            m_outSize += have;
+        } while (z.avail_out == 0);
+    } while (size);
+}
+
+void DeflateOutput::compressPending(int flush) {
+    const size_t size = size_t(pptr() - pbase());
+    setp(m_in.get(), m_in.get() + Buffer_Size);
+    compress(m_in.get(), size, flush);
+}
+
+DeflateOutput::int_type DeflateOutput::overflow(int_type ch) {
+    HUSE_ASSERT_USAGE(!m_finished, "writing to a finished compressed stream");
+    compressPending(Z_NO_FLUSH);
+    if (traits_type::eq_int_type(ch, traits_type::eof())) return traits_type::not_eof(ch);
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+    return ch;
+}
+
+std::streamsize DeflateOutput::xsputn(const char_type* s, std::streamsize n) {
+    const auto size = size_t(n);
+    if (size < size_t(epptr() - pptr())) {
+        memcpy(pptr(), s, size);
+        pbump(int(size));
+        return n;
+    }
+
+    HUSE_ASSERT_USAGE(!m_finished, "writing to a finished compressed stream");
+    compressPending(Z_NO_FLUSH);
+    if (size < Buffer_Size) {
+        memcpy(pptr(), s, size);
+        pbump(int(size));
+    }
+    else {
+        // big writes are compressed directly, without copying them to the buffer
+        compress(s, size, Z_NO_FLUSH);
+    }
+    return n;
+}
+
+int DeflateOutput::sync() {
+    if (m_finished) return 0;
+    compressPending(Z_SYNC_FLUSH);
+    return m_target.pubsync();
+}
+
+void DeflateOutput::finish() {
+    if (m_finished) return;
+    compressPending(Z_FINISH);
+    m_finished = true;
+    setp(nullptr, nullptr);
+}
+
+InflateInput::InflateInput(std::istream& in, DeflateFormat format)
+    : m_source(*in.rdbuf())
+    , m_z(std::make_unique<z_stream>())
+    , m_in(new char[Buffer_Size])
+    , m_stream(this)
+{
+    if (inflateInit2(m_z.get(), windowBits(format)) != Z_OK) {
+        throwInflateError(m_z->msg);
+    }
+    m_stream.exceptions(std::ios_base::badbit);
+}
+
+InflateInput::~InflateInput() {
+    inflateEnd(m_z.get());
+}
+
+size_t InflateInput::decompress(char* buf, size_t size) {
+    auto& z = *m_z;
+    size_t ret = 0;
+
+    // avail_out is 32-bit
+    while (size && !m_done) {
+        const size_t chunk = std::min<size_t>(size, UINT_MAX);
+        z.next_out = bytes(buf);
+        z.avail_out = uInt(chunk);
+
+        while (z.avail_out && !m_done) {
+            if (z.avail_in == 0) {
+                const auto n = m_source.sgetn(m_in.get(), std::streamsize(Buffer_Size));
+                if (n <= 0) throwInflateError("unexpected end of compressed input");
+                z.next_in = bytes(m_in.get());
+                z.avail_in = uInt(n);
+                m_inSize += size_t(n);
+            }
+
+            const int err = inflate(&z, Z_NO_FLUSH);
+            if (err == Z_STREAM_END) {
+                m_done = true;
+                returnUnused();
+            }
+            else if (err != Z_OK) throwInflateError(z.msg);
+        }
+
+        const size_t have = chunk - z.avail_out;
+        buf += have;
+        size -= have;
+        ret += have;
+    }
+
+    m_outSize += ret;
+    return ret;
+}
+
+void InflateInput::returnUnused() {
+    auto& z = *m_z;
+    if (!z.avail_in) return;
+    // the input after the compressed stream was read ahead
+    const auto back = std::streamoff(z.avail_in);
+    if (m_source.pubseekoff(-back, std::ios_base::cur, std::ios_base::in) != std::streampos(-1)) {
+        m_inSize -= z.avail_in;
+    }
+    z.avail_in = 0;
+}
+
+size_t InflateInput::read(char* buf, size_t size) {
+    // what's buffered by stream() comes first
+    const size_t buffered = std::min(size, size_t(egptr() - gptr()));
+    if (buffered) {
+        memcpy(buf, gptr(), buffered);
+        gbump(int(buffered));
+    }
+    return buffered + decompress(buf + buffered, size - buffered);
+}
+
+InflateInput::int_type InflateInput::underflow() {
+    if (!m_out) m_out.reset(new char[Buffer_Size]);
+    const size_t size = decompress(m_out.get(), Buffer_Size);
+    if (!size) return traits_type::eof();
+    setg(m_out.get(), m_out.get(), m_out.get() + size);
+    return traits_type::to_int_type(*gptr());
+}
+
+sajson::mutable_string_view inflateAll(InflateInput& in, size_t sizeHint) {
+    sajson::mutable_string_view ret(sizeHint ? sizeHint : Buffer_Size);
+    size_t size = 0;
+    for (;;) {
+        size += in.read(ret.get_data() + size, ret.length() - size);
+        if (size < ret.length() || in.done()) break;
+
+        // the buffer is full, but the end of the stream might not have been seen yet
+        char next;
+        if (!in.read(&next, 1)) break;
+
+        sajson::mutable_string_view bigger(ret.length() * 2);
+        memcpy(bigger.get_data(), ret.get_data(), size);
+        bigger.get_data()[size++] = next;
+        ret = std::move(bigger);
+    }
+    ret.truncate(size);
+    return ret;
+}
+
+Parser parseCompressed(std::istream& in, DeflateFormat format, const ParseOptions& opts, size_t sizeHint) {
+    InflateInput input(in, format);
+    return Parser(inflateAll(input, sizeHint), opts);
+}
+
+} // namespace huse::json
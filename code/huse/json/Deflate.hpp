@@ -0,0 +1,140 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "../API.h"
+#include "Parser.hpp"
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <cstddef>
+
+// deflate-compressed json (requires zlib, available if HUSE_HAS_ZLIB is defined)
+//
+// the serializer writes to a compressing stream, so the json is compressed as it's written:
+//
+//      json::DeflateOutput out(file);
+//      {
+//          json::SerializerRoot s(out.stream());
+//          s.val(data);
+//      }
+//      out.finish();
+//
+// and compressed json is decompressed directly into the buffer which is parsed in situ:
+//
+//      json::DeserializerRoot d(json::parseCompressed(file));
+//
+// neither the compressed data, nor the json (when writing) is kept in memory whole
+
+struct z_stream_s;
+
+namespace huse::json {
+
+enum class DeflateFormat {
+    Raw, // deflate data only (RFC 1951)
+    Zlib, // RFC 1950
+    Gzip, // RFC 1952
+};
+
+// compresses what's written to stream() and writes it to the output stream
+// zlib errors throw SerializerException(ErrorCode::Compression)
+class HUSE_API DeflateOutput : private std::streambuf {
+public:
+    // level is a zlib compression level (0-9, or -1 for the default)
+    explicit DeflateOutput(std::ostream& out, int level = -1, DeflateFormat format = DeflateFormat::Zlib);
+
+    // finishes the compressed stream if finish() wasn't called (unless there is an
+    // uncaught exception), ignoring errors
+    ~DeflateOutput();
+
+    DeflateOutput(const DeflateOutput&) = delete;
+    DeflateOutput& operator=(const DeflateOutput&) = delete;
+
+    // the stream for the serializer
+    // flushing it also flushes the compressed data (which costs a bit of the ratio)
+    // errors are rethrown by the stream (badbit is in its exception mask)
+    std::ostream& stream() { return m_stream; }
+
+    // compress what's left and write the end of the compressed stream
+    // nothing can be written after that
+    void finish();
+
+    // number of bytes written to stream() and of compressed bytes written to the output
+    size_t inSize() const { return m_inSize + size_t(pptr() - pbase()); }
+    size_t outSize() const { return m_outSize; }
+
+private:
+    virtual int_type overflow(int_type ch) override;
+    virtual std::streamsize xsputn(const char_type* s, std::streamsize n) override;
+    virtual int sync() override;
+
+    void compress(const char* data, size_t size, int flush);
+    void compressPending(int flush);
+
+    std::streambuf& m_target;
+    std::unique_ptr<z_stream_s> m_z;
+    std::unique_ptr<char[]> m_in;
+    std::unique_ptr<char[]> m_out;
+    size_t m_inSize = 0;
+    size_t m_outSize = 0;
+    bool m_finished = false;
+    std::ostream m_stream;
+};
+
+// decompresses the input stream
+// reading stops at the end of the compressed stream and the input may continue after it
+// the input is read ahead in chunks, so if it can't seek back, what follows the compressed
+// stream in the chunk where it ends is consumed
+// invalid or truncated input throws DeserializerException(ErrorCode::Compression)
+class HUSE_API InflateInput : private std::streambuf {
+public:
+    explicit InflateInput(std::istream& in, DeflateFormat format = DeflateFormat::Zlib);
+    ~InflateInput();
+
+    InflateInput(const InflateInput&) = delete;
+    InflateInput& operator=(const InflateInput&) = delete;
+
+    // the decompressed data as a stream
+    // errors are rethrown by the stream (badbit is in its exception mask)
+    std::istream& stream() { return m_stream; }
+
+    // decompress up to size bytes directly to buf
+    // returns the number of bytes, which is less than size only at the end
+    size_t read(char* buf, size_t size);
+
+    // whether the end of the compressed stream was reached
+    bool done() const { return m_done && gptr() == egptr(); }
+
+    // number of compressed bytes read from the input (only the ones of the compressed stream
+    // if the input can seek) and of decompressed bytes
+    size_t inSize() const { return m_inSize; }
+    size_t outSize() const { return m_outSize; }
+
+private:
+    virtual int_type underflow() override;
+
+    size_t decompress(char* buf, size_t size);
+    // seek the input back to the end of the compressed stream
+    void returnUnused();
+
+    std::streambuf& m_source;
+    std::unique_ptr<z_stream_s> m_z;
+    std::unique_ptr<char[]> m_in;
+    std::unique_ptr<char[]> m_out; // for stream()
+    size_t m_inSize = 0;
+    size_t m_outSize = 0;
+    bool m_done = false;
+    std::istream m_stream;
+};
+
+// decompress all of in into a buffer which can be parsed in situ
+// with the decompressed size as sizeHint (if it's known) it's decompressed without
+// reallocations, otherwise the buffer grows as needed
+HUSE_API sajson::mutable_string_view inflateAll(InflateInput& in, size_t sizeHint = 0);
+
+// parse the compressed json in the input stream
+// (throws DeserializerException like Parser, or with ErrorCode::Compression)
+HUSE_API Parser parseCompressed(std::istream& in, DeflateFormat format = DeflateFormat::Zlib, const ParseOptions& opts = {}, size_t sizeHint = 0);
+
+} // namespace huse::json
@@ -2,7 +2,61 @@
 
 namespace huse::json {
 
+JsonDeserializer::JsonDeserializer(std::shared_ptr<const Parser> doc)
+    : m_sharedParser(std::move(doc))
+    , m_parser(m_sharedParser.get())
+{}
+
 // export vtable
 JsonDeserializer::~JsonDeserializer() = default;
 
+ImValue JsonDeserializer::parseLazyValue(const ImValue& v) {
+    if (!m_ownParser) {
+        // shared documents are immutable
+        auto ret = m_parser->parsedLazyValue(v);
+        if (ret.is_lazy()) throw DeserializerException(ErrorCode::SharedLazy);
+        return ret;
+    }
+    return m_ownParser->parseLazyValue(v);
+}
+
+ErrorCode JsonDeserializer::readValue(const ImValue& v, RawJson& raw) const {
+    if (v.is_lazy()) {
+        raw.str = m_parser->lazySource(v);
+        return ErrorCode::None;
+    }
+    if (v.is_raw_number()) {
+        raw.str = v.get_number_source();
+        return ErrorCode::None;
+    }
+    if (v.is_raw_string() && !v.is_unescaped_raw_string()) {
+        // the quotes are right around the source
+        auto src = v.get_raw_string_source();
+        raw.str = std::string_view(src.data() - 1, src.size() + 2);
+        return ErrorCode::None;
+    }
+    auto t = v.get_type();
+    if ((t == sajson::TYPE_ARRAY || t == sajson::TYPE_OBJECT) && v.get_length() == 0) {
+        raw.str = t == sajson::TYPE_ARRAY ? "[]" : "{}";
+        return ErrorCode::None;
+    }
+    return ErrorCode::NoSource;
+}
+
+ErrorCode JsonDeserializer::readValue(const ImValue& v, std::string_view& val) const {
+    if (!v.is_raw_string()) return v.readValue(val);
+    if (!m_stringParser) {
+        // shared documents are immutable, so only the strings which were unescaped can be read
+        if (!v.is_unescaped_raw_string()) return ErrorCode::SharedLazy;
+        return v.readValue(val);
+    }
+    try {
+        val = m_stringParser->unescapeString(v);
+    }
+    catch (const DeserializerException& ex) {
+        return ex.code();
+    }
+    return ErrorCode::None;
+}
+
 } // namespace huse::json
\ No newline at end of file
@@ -4,20 +4,73 @@
 #pragma once
 #include "../API.h"
 #include "Parser.hpp"
+#include "RawJson.hpp"
 #include "../Deserializer.hpp"
+#include <concepts>
+#include <optional>
+#include <memory>
+#include <utility>
 
 namespace huse::json {
 
-class HUSE_API JsonDeserializer : virtual public Deserializer, private Parser {
+class HUSE_API JsonDeserializer : virtual public Deserializer {
 public:
-    using Parser::Parser;
+    // parse and own the document
+    template <typename... Args>
+        requires std::constructible_from<Parser, Args...>
+    explicit JsonDeserializer(Args&&... args)
+        : m_ownParser(std::in_place, std::forward<Args>(args)...)
+        , m_parser(&*m_ownParser)
+        , m_stringParser(&*m_ownParser)
+    {
+#if HUSE_INSTRUMENTATION
+        _stats().parseNs += impl::nsSince(m_constructionStart);
+        _stats().bytesRead += m_parser->document._internal_get_input().length();
+#endif
+    }
+
+    // read a shared document without parsing or copying it
+    // any number of deserializers (on any threads) can read the same document at the same time
+    // values read from it (like std::string_view) are valid for as long as sharedDocument() is alive
+    // lazy values which haven't been parsed before the document was shared are not supported
+    explicit JsonDeserializer(std::shared_ptr<const Parser> doc);
+
     ~JsonDeserializer();
 
-    const Parser& jsonParser() const { return *this; }
+    const Parser& jsonParser() const { return *m_parser; }
+
+    // null if the document isn't shared
+    const std::shared_ptr<const Parser>& sharedDocument() const { return m_sharedParser; }
 
     virtual ImValue getRootValue() const override {
-        return rootValue();
+        return m_parser->rootValue();
+    }
+
+    virtual ImValue parseLazyValue(const ImValue& v) override;
+
+    virtual ImValue parsedLazyValue(const ImValue& v) const override {
+        return m_parser->parsedLazyValue(v);
     }
+
+    // exact source text of an object or array which was skipped by a lazy
+    // parse (see ParseOptions::lazy), or of a number which was not converted
+    // (see ParseOptions::lazyNumbers), or of a string which was not unescaped
+    // (see ParseOptions::lazyStrings) including its quotes
+    // the source of empty objects and arrays is always available as {} and []
+    // other values produce ErrorCode::NoSource
+    ErrorCode readValue(const ImValue& v, RawJson& raw) const;
+
+    // strings which were not unescaped (see ParseOptions::lazyStrings) are unescaped on
+    // first read and stored in the parser
+    // with a shared document only the ones unescaped before it was shared can be read as
+    // views (others produce ErrorCode::SharedLazy), but they can always be read as strings
+    ErrorCode readValue(const ImValue& v, std::string_view& val) const;
+
+private:
+    std::optional<Parser> m_ownParser;
+    std::shared_ptr<const Parser> m_sharedParser;
+    const Parser* m_parser;
+    Parser* m_stringParser = nullptr; // the own parser, in which strings are unescaped when read
 };
 
 } // namespace huse::json
\ No newline at end of file
@@ -4,9 +4,43 @@
 #pragma once
 #include "Deserializer.hpp"
 #include "../DeserializerRoot.hpp"
+#include <itlib/expected.hpp>
 
 namespace huse::json {
 
 using DeserializerRoot = huse::DeserializerRoot<JsonDeserializer>;
 
+using DeserializeResult = itlib::expected<void, DeserializerException>;
+
+namespace impl {
+template <typename T>
+DeserializeResult tryDeserialize(sajson::document&& doc, T& out) {
+    // parse errors (the most common ones for untrusted input) are returned without throwing
+    if (!doc.is_valid()) {
+        return itlib::unexpected(Parser::parseError(doc));
+    }
+    try {
+        DeserializerRoot d(std::move(doc));
+        d.val(out);
+    }
+    catch (DeserializerException& ex) {
+        return itlib::unexpected(std::move(ex));
+    }
+    return {};
+}
+} // namespace impl
+
+// deserialize a json string into out without propagating DeserializerException
+// on error, out may be partially filled
+template <typename T>
+DeserializeResult tryDeserialize(std::string_view json, T& out, const ParseOptions& opts = {}) {
+    return impl::tryDeserialize(Parser::parseDocument(json, opts), out);
+}
+
+// in-situ version (the string will be modified)
+template <typename T>
+DeserializeResult tryDeserialize(char* mutableJson, size_t len, T& out, const ParseOptions& opts = {}) {
+    return impl::tryDeserialize(Parser::parseDocument(mutableJson, len, opts), out);
+}
+
 } // namespace huse::json
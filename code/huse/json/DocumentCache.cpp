@@ -0,0 +1,247 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include "DocumentCache.hpp"
+#include "../Exception.hpp"
+#include <ostream>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+
+#if defined(_WIN32)
+#   define WIN32_LEAN_AND_MEAN
+#   define NOMINMAX
+#   include <Windows.h>
+#else
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#endif
+
+namespace huse::json {
+
+namespace {
+
+using sajson::ast_word;
+
+constexpr char Magic[8] = {'h', 'u', 's', 'e', 'd', 'o', 'c', 0};
+constexpr uint32_t Version = 2; // 2: raw numbers which are integers have their own tag
+constexpr uint32_t Byte_Order_Mark = 0x01020304;
+
+// the AST follows the header and the text follows the AST
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t wordSize;
+    uint32_t rootTag;
+    uint64_t rootOffset; // in words from the start of the AST
+    uint64_t astWords;
+    uint64_t textLength;
+};
+
+// padded so that the AST is aligned
+constexpr size_t Header_Size = 64;
+static_assert(sizeof(Header) <= Header_Size);
+
+// the extent of the AST
+struct AstRange {
+    const ast_word* begin = nullptr;
+    const ast_word* end = nullptr;
+};
+
+AstRange astRange(const sajson::value& root) {
+    AstRange ret;
+    ret.begin = ret.end = root._internal_get_payload();
+
+    std::vector<sajson::value> stack = {root};
+    while (!stack.empty()) {
+        auto v = stack.back();
+        stack.pop_back();
+
+        auto payload = v._internal_get_payload();
+        size_t words = 0;
+        switch (v.get_type()) {
+        case sajson::TYPE_INTEGER: words = v.is_raw_number() ? 2 : sajson::integer_storage::word_length; break;
+        case sajson::TYPE_DOUBLE: words = v.is_raw_number() ? 2 : sajson::double_storage::word_length; break;
+        case sajson::TYPE_STRING:
+            if (v.is_raw_string()) {
+                // the unescaped strings are stored in the parser, like lazy documents
+                throw DeserializerException(ErrorCode::BadCache, "documents with raw strings can't be cached");
+            }
+            words = 2;
+            break;
+        case sajson::TYPE_ARRAY:
+        case sajson::TYPE_OBJECT:
+            if (v.is_lazy()) {
+                throw DeserializerException(ErrorCode::BadCache, "documents with lazy values can't be cached");
+            }
+            if (v.get_type() == sajson::TYPE_ARRAY) {
+                words = 1 + v.get_length();
+                for (size_t i = 0; i < v.get_length(); ++i) {
+                    stack.push_back(v.get_array_element(i));
+                }
+            }
+            else {
+                words = 1 + 3 * v.get_length();
+                for (size_t i = 0; i < v.get_length(); ++i) {
+                    stack.push_back(v.get_object_value(i));
+                }
+            }
+            break;
+        default:
+            continue; // literals have no payload
+        }
+
+        if (payload < ret.begin) ret.begin = payload;
+        if (payload + words > ret.end) ret.end = payload + words;
+    }
+
+    return ret;
+}
+
+[[noreturn]] void throwBadCache() {
+    throw DeserializerException(ErrorCode::BadCache);
+}
+
+[[noreturn]] void throwCacheIo() {
+    throw DeserializerException(ErrorCode::CacheIo);
+}
+
+} // namespace
+
+void saveDocumentCache(const Parser& parser, std::ostream& out) {
+    auto& doc = parser.document;
+    auto& input = doc._internal_get_input();
+    auto range = astRange(doc.get_root());
+    const size_t astWords = size_t(range.end - range.begin);
+
+    Header h = {};
+    memcpy(h.magic, Magic, sizeof(Magic));
+    h.version = Version;
+    h.byteOrder = Byte_Order_Mark;
+    h.wordSize = sizeof(ast_word);
+    h.rootTag = uint32_t(doc._internal_get_root_tag());
+    h.rootOffset = uint64_t(doc._internal_get_root() - range.begin);
+    h.astWords = astWords;
+    h.textLength = input.length();
+
+    char header[Header_Size] = {};
+    memcpy(header, &h, sizeof(h));
+    out.write(header, Header_Size);
+
+    out.write(reinterpret_cast<const char*>(range.begin), std::streamsize(astWords * sizeof(ast_word)));
+
+    out.write(input.get_data(), std::streamsize(input.length()));
+
+    if (!out) throwCacheIo();
+}
+
+sajson::document loadDocumentCache(const void* data, size_t size) {
+    if (reinterpret_cast<uintptr_t>(data) % alignof(ast_word)) throwBadCache();
+    if (size < Header_Size) throwBadCache();
+
+    // the document needs a mutable text for in-situ parsing, but as it has been parsed
+    // and has no lazy values, neither the text nor the AST will be written to
+    auto bytes = const_cast<char*>(static_cast<const char*>(data));
+    Header h;
+    memcpy(&h, bytes, sizeof(h));
+
+    if (memcmp(h.magic, Magic, sizeof(Magic)) != 0) throwBadCache();
+    if (h.version != Version) throwBadCache();
+    if (h.byteOrder != Byte_Order_Mark) throwBadCache();
+    if (h.wordSize != sizeof(ast_word)) throwBadCache();
+
+    auto rootTag = sajson::internal::tag(h.rootTag);
+    if (rootTag != sajson::internal::tag::array && rootTag != sajson::internal::tag::object) throwBadCache();
+
+    // checked this way to avoid overflows
+    const size_t available = size - Header_Size;
+    if (h.astWords == 0 || h.astWords > available / sizeof(ast_word)) throwBadCache();
+    const size_t astBytes = size_t(h.astWords) * sizeof(ast_word);
+    if (h.textLength > available - astBytes) throwBadCache();
+    if (h.rootOffset >= h.astWords) throwBadCache();
+
+    auto ast = reinterpret_cast<ast_word*>(bytes + Header_Size);
+    auto text = bytes + Header_Size + astBytes;
+
+    return sajson::document::_internal_make_view(
+        sajson::mutable_string_view(size_t(h.textLength), text),
+        rootTag,
+        ast + h.rootOffset
+    );
+}
+
+#if defined(_WIN32)
+
+MappedDocumentCache::MappedDocumentCache(const char* path) {
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) throwCacheIo();
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        throwCacheIo();
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping) throwCacheIo();
+
+    m_data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping); // the view keeps the mapping alive
+    if (!m_data) throwCacheIo();
+    m_size = size_t(fileSize.QuadPart);
+
+    try {
+        loadDocumentCache(m_data, m_size);
+    }
+    catch (...) {
+        UnmapViewOfFile(m_data);
+        throw;
+    }
+}
+
+MappedDocumentCache::~MappedDocumentCache() {
+    UnmapViewOfFile(m_data);
+}
+
+#else
+
+MappedDocumentCache::MappedDocumentCache(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) throwCacheIo();
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        throwCacheIo();
+    }
+    m_size = size_t(st.st_size);
+
+    void* p = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps the file alive
+    if (p == MAP_FAILED) throwCacheIo();
+    m_data = p;
+
+    try {
+        loadDocumentCache(m_data, m_size);
+    }
+    catch (...) {
+        munmap(const_cast<void*>(m_data), m_size);
+        throw;
+    }
+}
+
+MappedDocumentCache::~MappedDocumentCache() {
+    munmap(const_cast<void*>(m_data), m_size);
+}
+
+#endif
+
+sajson::document MappedDocumentCache::document() const {
+    return loadDocumentCache(m_data, m_size);
+}
+
+} // namespace huse::json
@@ -0,0 +1,57 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "../API.h"
+#include "Parser.hpp"
+#include <iosfwd>
+#include <cstddef>
+
+// document caches store a parsed document (the AST and the, possibly modified, input text)
+// so that it can be loaded without parsing and without copying
+//
+// the format is native: the header records the version, the AST word size, and the
+// byte order, and loading a cache produced by an incompatible build fails
+//
+// caches are trusted: the header and the sizes are checked, but the AST itself isn't
+
+namespace huse::json {
+
+// write the document of parser to out (which should be opened in binary mode)
+// documents with lazy values (see ParseOptions::lazy) can't be cached, as their
+// state is stored in the AST (and loading a cache doesn't parse anyway)
+// neither can documents with strings which were not unescaped (see ParseOptions::lazyStrings)
+// throws DeserializerException(ErrorCode::BadCache) for such documents
+// and DeserializerException(ErrorCode::CacheIo) if writing fails
+HUSE_API void saveDocumentCache(const Parser& parser, std::ostream& out);
+
+// document which refers to the cache in data (which is not modified)
+// data must be aligned for sajson::ast_word and must outlive the document
+// throws DeserializerException(ErrorCode::BadCache) if data is not a compatible cache
+HUSE_API sajson::document loadDocumentCache(const void* data, size_t size);
+
+// read-only memory-mapped document cache file
+// any number of documents can use the same cache
+class HUSE_API MappedDocumentCache {
+public:
+    // throws DeserializerException(ErrorCode::CacheIo) if the file can't be mapped
+    // and DeserializerException(ErrorCode::BadCache) if it's not a compatible cache
+    explicit MappedDocumentCache(const char* path);
+    ~MappedDocumentCache();
+
+    MappedDocumentCache(const MappedDocumentCache&) = delete;
+    MappedDocumentCache& operator=(const MappedDocumentCache&) = delete;
+
+    // a new view of the mapped document
+    // it must not outlive the cache
+    // usage: json::DeserializerRoot d(cache.document());
+    sajson::document document() const;
+
+    size_t size() const { return m_size; }
+
+private:
+    const void* m_data = nullptr;
+    size_t m_size = 0;
+};
+
+} // namespace huse::json
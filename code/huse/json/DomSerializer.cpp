@@ -0,0 +1,248 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include "DomSerializer.hpp"
+#include "Limits.hpp"
+
+#include "../Exception.hpp"
+#include "../impl/Assert.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <type_traits>
+
+namespace huse::json {
+
+struct DomSerializer::StringStream {
+    std::ostringstream stream;
+};
+
+DomSerializer::DomSerializer() = default;
+DomSerializer::~DomSerializer() = default;
+
+void DomSerializer::writeWords(const ast_word* words, size_t n) {
+    // reversed, so that they are in order when the whole AST is reversed
+    for (size_t i = n; i-- > 0; ) {
+        m_ast.push_back(words[i]);
+    }
+}
+
+void DomSerializer::addElement(tag t, size_t astPos) {
+    if (m_open.empty()) {
+        if (m_hasRoot || (t != tag::object && t != tag::array)) {
+            throwException("root must be a single object or array");
+        }
+        m_hasRoot = true;
+        m_root = {0, 0, t, astPos};
+        return;
+    }
+
+    Element e = {0, 0, t, astPos};
+    if (m_open.back().object) {
+        HUSE_ASSERT_INTERNAL(m_hasPendingKey);
+        e.keyStart = m_pendingKeyStart;
+        e.keyEnd = m_pendingKeyEnd;
+        m_hasPendingKey = false;
+    }
+    m_elements.push_back(e);
+}
+
+size_t DomSerializer::addText(std::string_view str) {
+    const size_t start = m_text.size();
+    m_text.append(str);
+    m_text.push_back(0); // strings are null-terminated like the ones of in-situ parsing
+    return start;
+}
+
+void DomSerializer::writeValue(bool val) {
+    addElement(val ? tag::true_ : tag::false_, 0);
+}
+
+template <typename T>
+void DomSerializer::writeInteger(T val) {
+    // same limits as json text
+    if constexpr (sizeof(T) > 4) {
+        if constexpr (std::is_signed_v<T>) {
+            if (val < Min_Int64 || val > Max_Int64) throwException(ErrorCode::IntegerTooBig);
+        }
+        else {
+            if (val > Max_Uint64) throwException(ErrorCode::IntegerTooBig);
+        }
+    }
+
+    // and same representation as the parser
+    bool fitsInt;
+    if constexpr (std::is_signed_v<T>) {
+        fitsInt = val >= std::numeric_limits<int>::min() && val <= std::numeric_limits<int>::max();
+    }
+    else {
+        fitsInt = val <= T(std::numeric_limits<int>::max());
+    }
+
+    if (!fitsInt) {
+        writeDouble(double(val));
+        return;
+    }
+
+    ast_word w = 0;
+    sajson::integer_storage::store(&w, int(val));
+    writeWords(&w, 1);
+    addElement(tag::integer, m_ast.size());
+}
+
+void DomSerializer::writeValue(short val) { writeInteger(val); }
+void DomSerializer::writeValue(unsigned short val) { writeInteger(val); }
+void DomSerializer::writeValue(int val) { writeInteger(val); }
+void DomSerializer::writeValue(unsigned int val) { writeInteger(val); }
+void DomSerializer::writeValue(long val) { writeInteger(val); }
+void DomSerializer::writeValue(unsigned long val) { writeInteger(val); }
+void DomSerializer::writeValue(long long val) { writeInteger(val); }
+void DomSerializer::writeValue(unsigned long long val) { writeInteger(val); }
+
+void DomSerializer::writeDouble(double val) {
+    if (!std::isfinite(val)) throwException(ErrorCode::NonFiniteFloat);
+    ast_word words[sajson::double_storage::word_length];
+    sajson::double_storage::store(words, val);
+    writeWords(words, sajson::double_storage::word_length);
+    addElement(tag::double_, m_ast.size());
+}
+
+void DomSerializer::writeValue(float val) { writeDouble(val); }
+void DomSerializer::writeValue(double val) { writeDouble(val); }
+
+void DomSerializer::writeValue(std::string_view val) {
+    const size_t start = addText(val);
+    const ast_word words[2] = {ast_word(start), ast_word(start + val.size())};
+    writeWords(words, 2);
+    addElement(tag::string, m_ast.size());
+}
+
+void DomSerializer::writeValue(std::nullptr_t) {
+    addElement(tag::null, 0);
+}
+
+void DomSerializer::writeValue(std::nullopt_t) {
+    m_hasPendingKey = false;
+}
+
+std::ostream& DomSerializer::openStringStream() {
+    if (!m_stringStream) {
+        m_stringStream = std::make_unique<StringStream>();
+    }
+    m_stringStream->stream.str({});
+    return m_stringStream->stream;
+}
+
+void DomSerializer::closeStringStream() {
+    HUSE_ASSERT_INTERNAL(m_stringStream);
+    writeValue(m_stringStream->stream.view());
+}
+
+void DomSerializer::pushKey(std::string_view key) {
+    HUSE_ASSERT_INTERNAL(!m_hasPendingKey);
+    m_pendingKeyStart = addText(key);
+    m_pendingKeyEnd = m_pendingKeyStart + key.size();
+    m_hasPendingKey = true;
+}
+
+void DomSerializer::open(bool object) {
+    if (m_open.empty() && m_hasRoot) {
+        throwException("root must be a single object or array");
+    }
+    // the key belongs to the structure, and not to its first element
+    Structure s = {object, m_elements.size()};
+    if (m_hasPendingKey) {
+        m_elements.push_back({m_pendingKeyStart, m_pendingKeyEnd, tag::null, 0});
+        m_hasPendingKey = false;
+        ++s.firstElement;
+    }
+    m_open.push_back(s);
+}
+
+void DomSerializer::close([[maybe_unused]] bool object) {
+    HUSE_ASSERT_INTERNAL(!m_open.empty());
+    const auto s = m_open.back();
+    HUSE_ASSERT_INTERNAL(s.object == object);
+    m_open.pop_back();
+
+    const auto begin = m_elements.begin() + ptrdiff_t(s.firstElement);
+    const auto end = m_elements.end();
+    const size_t length = size_t(end - begin);
+
+    if (s.object && sajson::internal::should_binary_search(length)) {
+        // sorted like sajson does for large objects
+        std::sort(begin, end, [&](const Element& a, const Element& b) {
+            const size_t alen = a.keyEnd - a.keyStart;
+            const size_t blen = b.keyEnd - b.keyStart;
+            if (alen != blen) return alen < blen;
+            return memcmp(m_text.data() + a.keyStart, m_text.data() + b.keyStart, alen) < 0;
+        });
+    }
+
+    // payload: length, then the elements (with their keys for objects)
+    m_payload.clear();
+    m_payload.push_back(ast_word(length));
+    const size_t payloadPos = m_ast.size() + 1 + length * (s.object ? 3 : 1);
+    for (auto i = begin; i != end; ++i) {
+        if (s.object) {
+            m_payload.push_back(ast_word(i->keyStart));
+            m_payload.push_back(ast_word(i->keyEnd));
+        }
+        // children are after their parent, literals have no payload
+        const bool literal = i->t == tag::null || i->t == tag::false_ || i->t == tag::true_;
+        m_payload.push_back(sajson::internal::make_element(i->t, literal ? 0 : payloadPos - i->astPos));
+    }
+    writeWords(m_payload.data(), m_payload.size());
+    HUSE_ASSERT_INTERNAL(m_ast.size() == payloadPos);
+
+    m_elements.erase(begin, end);
+
+    // restore the key of the structure
+    if (!m_open.empty() && m_open.back().object) {
+        auto& key = m_elements.back();
+        m_pendingKeyStart = key.keyStart;
+        m_pendingKeyEnd = key.keyEnd;
+        m_hasPendingKey = true;
+        m_elements.pop_back();
+    }
+
+    addElement(s.object ? tag::object : tag::array, payloadPos);
+}
+
+void DomSerializer::openObject() { open(true); }
+void DomSerializer::closeObject() { close(true); }
+void DomSerializer::openArray() { open(false); }
+void DomSerializer::closeArray() { close(false); }
+
+sajson::document DomSerializer::releaseDocument() {
+    if (!m_hasRoot || !m_open.empty()) {
+        throwException("no complete root object or array");
+    }
+
+    // same limits as the ones of the parser
+    const size_t size = m_ast.size();
+    if (size >= sajson::internal::VALUE_MASK || m_text.size() > size_t(ast_word(-1))) {
+        throwException("document is too big");
+    }
+
+    auto ast = new ast_word[size];
+    std::reverse_copy(m_ast.begin(), m_ast.end(), ast);
+
+    auto doc = sajson::document::_internal_make_document(
+        sajson::mutable_string_view(sajson::string(m_text.data(), m_text.size())),
+        sajson::internal::ownership(ast),
+        m_root.t,
+        ast + (size - m_root.astPos)
+    );
+
+    m_ast.clear();
+    m_text.clear();
+    m_hasRoot = false;
+
+    return doc;
+}
+
+} // namespace huse::json
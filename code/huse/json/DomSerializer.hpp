@@ -0,0 +1,106 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "../API.h"
+#include "../Serializer.hpp"
+#include "_sajson/sajson.hpp"
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+namespace huse::json {
+
+// serializer which builds a parsed document (the same AST which Parser produces) instead of text
+// this skips both formatting and parsing when handing off data in the same process:
+//
+//      json::DomSerializerRoot s;
+//      s.val(data);
+//      json::DeserializerRoot d(s.releaseDocument());
+//
+// values are stored as if they went through json text (same limits, integers which don't
+// fit in 32 bits become doubles), except that floats are not rounded to their shortest
+// decimal representation
+class HUSE_API DomSerializer : virtual public Serializer {
+public:
+    DomSerializer();
+    ~DomSerializer();
+
+    virtual void writeValue(bool val) final override;
+    virtual void writeValue(short val) final override;
+    virtual void writeValue(unsigned short val) final override;
+    virtual void writeValue(int val) final override;
+    virtual void writeValue(unsigned int val) final override;
+    virtual void writeValue(long val) final override;
+    virtual void writeValue(unsigned long val) final override;
+    virtual void writeValue(long long val) final override;
+    virtual void writeValue(unsigned long long val) final override;
+    virtual void writeValue(float val) final override;
+    virtual void writeValue(double val) final override;
+    virtual void writeValue(std::string_view val) final override;
+    virtual void writeValue(std::nullptr_t) final override;
+    virtual void writeValue(std::nullopt_t) final override;
+    using Serializer::writeValue;
+
+    virtual std::ostream& openStringStream() final override;
+    virtual void closeStringStream() final override;
+
+    virtual void pushKey(std::string_view key) final override;
+
+    virtual void openObject() final override;
+    virtual void closeObject() final override;
+    virtual void openArray() final override;
+    virtual void closeArray() final override;
+
+    // the built document
+    // the root value must be a closed object or array
+    // the serializer is empty afterwards, and can be used to build a new document
+    sajson::document releaseDocument();
+
+private:
+    using ast_word = sajson::ast_word;
+    using tag = sajson::internal::tag;
+
+    // a value in an open object or array
+    struct Element {
+        size_t keyStart, keyEnd; // in the text (only for object elements)
+        tag t;
+        size_t astPos; // distance of the payload from the end of the AST
+    };
+
+    // open object or array
+    struct Structure {
+        bool object;
+        size_t firstElement; // index in m_elements
+    };
+
+    // the AST is built backwards (children before their parents, as sajson does),
+    // so the words are stored in reverse order
+    void addElement(tag t, size_t astPos);
+    void writeWords(const ast_word* words, size_t n);
+    template <typename T> void writeInteger(T val);
+    void writeDouble(double val);
+    size_t addText(std::string_view str);
+    void open(bool object);
+    void close(bool object);
+
+    std::vector<ast_word> m_ast;
+    std::string m_text;
+
+    std::vector<Element> m_elements;
+    std::vector<Structure> m_open;
+    std::vector<ast_word> m_payload; // scratch buffer for closing structures
+
+    bool m_hasPendingKey = false;
+    size_t m_pendingKeyStart = 0, m_pendingKeyEnd = 0;
+
+    // closed root
+    bool m_hasRoot = false;
+    Element m_root = {};
+
+    struct StringStream;
+    std::unique_ptr<StringStream> m_stringStream;
+};
+
+} // namespace huse::json
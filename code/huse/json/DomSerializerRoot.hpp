@@ -0,0 +1,12 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "DomSerializer.hpp"
+#include "../SerializerRoot.hpp"
+
+namespace huse::json {
+
+using DomSerializerRoot = huse::SerializerRoot<DomSerializer>;
+
+} // namespace huse::json
@@ -0,0 +1,53 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include "FragmentCache.hpp"
+
+namespace huse::json {
+
+FragmentCache::FragmentCache() = default;
+FragmentCache::~FragmentCache() = default;
+
+const std::string* FragmentCache::find(const void* key, uint64_t version, Mode mode, bool strictUtf8) {
+    auto& f = m_fragments[key];
+    if (f.version != version) {
+        m_bytes -= f.bytes();
+        f = {};
+        f.version = version;
+        return nullptr;
+    }
+    auto& json = f.json[mode];
+    if (json.empty()) return nullptr; // not rendered in this mode (json is never empty)
+    if (strictUtf8 && !f.strictUtf8[mode]) return nullptr; // rendered again with validation
+    return &json;
+}
+
+const std::string& FragmentCache::store(const void* key, Mode mode, bool strictUtf8, std::string json) {
+    auto& f = m_fragments[key];
+    // the output with strict UTF-8 is the same, so such fragments are also used without it
+    f.strictUtf8[mode] = strictUtf8;
+    auto& ret = f.json[mode];
+    m_bytes += json.size() - ret.size();
+    ret = std::move(json);
+    return ret;
+}
+
+void FragmentCache::splice(SerializerNode<JsonSerializer>& n, std::string_view json) {
+    auto& s = n._s();
+    if (s.pretty()) s.writePrettyRawJson(json);
+    else s.writeValue(RawJson{json});
+}
+
+void FragmentCache::invalidate(const void* key) {
+    auto f = m_fragments.find(key);
+    if (f == m_fragments.end()) return;
+    m_bytes -= f->second.bytes();
+    m_fragments.erase(f);
+}
+
+void FragmentCache::clear() {
+    m_fragments.clear();
+    m_bytes = 0;
+}
+
+} // namespace huse::json
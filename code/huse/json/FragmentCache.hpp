@@ -0,0 +1,136 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "../API.h"
+#include "Serializer.hpp"
+#include "CanonicalSerializer.hpp"
+#include "../SerializerNode.hpp"
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <cstdint>
+
+namespace huse::json {
+
+// cache of serialized values (fragments), keyed by object identity and version
+// cached fragments are spliced in as RawJson instead of serializing the values again
+//
+//      json::FragmentCache cache;
+//      ...
+//      obj.val("profile", cache.memoized(user.profile, user.profileVersion));
+//
+// the version must change when the object does (a fragment with another version is replaced)
+// fragments are rendered for the mode of the serializer: compact, pretty (indented for the
+// depth at which they are written), or canonical
+// with strict UTF-8 (see JsonSerializer::setStrictUtf8) only fragments which were rendered
+// with it are written, so invalid strings throw like when they're written directly
+//
+// the cache is not thread safe
+// fragments are written as RawJson, so with a SegmentedOutput large ones are referenced
+// and must not be invalidated while the segments are used
+class HUSE_API FragmentCache {
+public:
+    FragmentCache();
+    ~FragmentCache();
+
+    FragmentCache(const FragmentCache&) = delete;
+    FragmentCache& operator=(const FragmentCache&) = delete;
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0; // values which were serialized (and cached)
+        uint64_t bytesSaved = 0; // size of the fragments written from the cache
+
+        double hitRate() const {
+            const auto total = hits + misses;
+            return total ? double(hits) / double(total) : 0;
+        }
+    };
+
+    const Stats& stats() const { return m_stats; }
+    void resetStats() { m_stats = {}; }
+
+    // write value to n, from the fragment of key and version if it's cached
+    template <typename T>
+    void write(SerializerNode<JsonSerializer>& n, const void* key, uint64_t version, const T& value);
+
+    // value which is written through the cache with its address as the key
+    template <typename T>
+    struct Memoized {
+        FragmentCache& cache;
+        const T& value;
+        uint64_t version;
+
+        void huseSerialize(SerializerNode<JsonSerializer>& n) const {
+            cache.write(n, &value, version, value);
+        }
+    };
+    template <typename T>
+    Memoized<T> memoized(const T& value, uint64_t version) {
+        return {*this, value, version};
+    }
+
+    void invalidate(const void* key);
+    void clear();
+
+    // number of cached fragments and their total size
+    size_t size() const { return m_fragments.size(); }
+    size_t bytes() const { return m_bytes; }
+
+private:
+    enum Mode { Compact, Pretty, Canonical, Num_Modes };
+    static Mode mode(const JsonSerializer& s) {
+        if (s.canonical()) return Canonical;
+        return s.pretty() ? Pretty : Compact;
+    }
+
+    struct Fragment {
+        uint64_t version = 0;
+        std::string json[Num_Modes]; // rendered on demand
+        bool strictUtf8[Num_Modes] = {}; // whether json was rendered with strict UTF-8
+        size_t bytes() const { return json[Compact].size() + json[Pretty].size() + json[Canonical].size(); }
+    };
+
+    // fragment of key and version for the mode, or null if it's not cached (or not rendered
+    // with strict UTF-8 if it's required), in which case the one for key is reset to version
+    const std::string* find(const void* key, uint64_t version, Mode mode, bool strictUtf8);
+    const std::string& store(const void* key, Mode mode, bool strictUtf8, std::string json);
+    void splice(SerializerNode<JsonSerializer>& n, std::string_view json);
+
+    std::unordered_map<const void*, Fragment> m_fragments;
+    size_t m_bytes = 0;
+    Stats m_stats;
+};
+
+template <typename T>
+void FragmentCache::write(SerializerNode<JsonSerializer>& n, const void* key, uint64_t version, const T& value) {
+    const auto m = mode(n._s());
+    const bool strict = n._s().strictUtf8();
+    if (auto json = find(key, version, m, strict)) {
+        ++m_stats.hits;
+        m_stats.bytesSaved += json->size();
+        splice(n, *json);
+        return;
+    }
+    ++m_stats.misses;
+    std::ostringstream out;
+    auto render = [&](JsonSerializer& s) {
+        s.setStrictUtf8(strict);
+        SerializerNode<JsonSerializer> vn(s);
+        vn.val(value);
+    };
+    if (m == Canonical) {
+        // written to out when it's destroyed
+        CanonicalJsonSerializer s(out);
+        render(s);
+    }
+    else {
+        JsonSerializer s(out, m == Pretty);
+        render(s);
+    }
+    splice(n, store(key, m, strict, std::move(out).str()));
+}
+
+} // namespace huse::json
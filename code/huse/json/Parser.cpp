@@ -2,30 +2,63 @@
 // SPDX-License-Identifier: MIT
 //
 #include "Parser.hpp"
+#include "Projection.hpp"
 
 namespace huse::json {
 
+namespace {
+sajson::parse_options sajsonOptions(const ParseOptions& opts, sajson::source_map* spans) {
+    return {
+        .lazy = opts.lazy,
+        .spans = spans,
+        .proj = opts.projection ? &opts.projection->tree() : nullptr,
+        .lazy_numbers = opts.lazyNumbers,
+        .lazy_strings = opts.lazyStrings,
+        .strict_utf8 = opts.strictUtf8,
+    };
+}
+} // namespace
+
 Parser::Parser(sajson::document&& doc)
     : document(std::move(doc))
 {
     if (!document.is_valid()) {
-        throw DeserializerException(document.get_error_message_as_cstring());
+        throw parseError(document);
     }
 }
 
-Parser::Parser(std::string_view str)
-    : Parser(sajson::parse(
-          sajson::single_allocation(),
-          sajson::string(str.data(), str.size()))
-    )
-{}
+Parser::Parser(std::string_view str, const ParseOptions& opts)
+    : document(parseDocument(str, opts, opts.sourceSpans ? &sourceMap : nullptr))
+    , m_lazyNumbers(opts.lazyNumbers)
+    , m_lazyStrings(opts.lazyStrings)
+    , m_strictUtf8(opts.strictUtf8)
+{
+    if (!document.is_valid()) {
+        throw parseError(document);
+    }
+}
 
-Parser::Parser(char* str, size_t len)
-    : Parser(sajson::parse(
-          sajson::single_allocation(),
-          sajson::mutable_string_view(len == size_t(-1) ? strlen(str) : len, str))
-    )
-{}
+Parser::Parser(char* str, size_t len, const ParseOptions& opts)
+    : document(parseDocument(str, len, opts, opts.sourceSpans ? &sourceMap : nullptr))
+    , m_lazyNumbers(opts.lazyNumbers)
+    , m_lazyStrings(opts.lazyStrings)
+    , m_strictUtf8(opts.strictUtf8)
+{
+    if (!document.is_valid()) {
+        throw parseError(document);
+    }
+}
+
+Parser::Parser(sajson::mutable_string_view input, const ParseOptions& opts)
+    : document(parseDocument(input, opts, opts.sourceSpans ? &sourceMap : nullptr))
+    , m_lazyNumbers(opts.lazyNumbers)
+    , m_lazyStrings(opts.lazyStrings)
+    , m_strictUtf8(opts.strictUtf8)
+{
+    if (!document.is_valid()) {
+        throw parseError(document);
+    }
+}
 
 Parser::~Parser() = default;
 
@@ -33,4 +66,136 @@ ImValue Parser::rootValue() const {
     return document.get_root();
 }
 
+sajson::document Parser::parseDocument(std::string_view str, const ParseOptions& opts, sajson::source_map* spans) {
+    return sajson::parse(
+        sajson::single_allocation(),
+        sajson::string(str.data(), str.size()),
+        sajsonOptions(opts, spans)
+    );
+}
+
+sajson::document Parser::parseDocument(char* str, size_t len, const ParseOptions& opts, sajson::source_map* spans) {
+    return sajson::parse(
+        sajson::single_allocation(),
+        sajson::mutable_string_view(len == size_t(-1) ? strlen(str) : len, str),
+        sajsonOptions(opts, spans)
+    );
+}
+
+sajson::document Parser::parseDocument(const sajson::mutable_string_view& input, const ParseOptions& opts, sajson::source_map* spans) {
+    return sajson::parse(
+        sajson::single_allocation(),
+        input,
+        sajsonOptions(opts, spans)
+    );
+}
+
+DeserializerException Parser::parseError(const sajson::document& doc) {
+    // the static error text doesn't allocate, unlike the formatted message
+    DeserializerException ret(ErrorCode::Parse, doc._internal_get_error_text());
+    ret.setInputOffset(doc.get_error_offset());
+    return ret;
+}
+
+ImValue Parser::parseLazyValue(const ImValue& v) {
+    if (!v.is_lazy()) return v;
+
+    // the payload is start, end, and index+1 of the parsed document (0 if not parsed)
+    // it's part of the AST which we own, so it's safe to write to it
+    auto payload = const_cast<sajson::ast_word*>(v._internal_get_payload());
+    if (payload[2]) return lazyDocuments[payload[2] - 1].get_root();
+
+    sajson::parse_options opts{
+        .lazy = true,
+        .lazy_numbers = m_lazyNumbers,
+        .lazy_strings = m_lazyStrings,
+        .strict_utf8 = m_strictUtf8,
+    };
+    auto text = const_cast<char*>(v._internal_get_text()) + payload[0];
+    const size_t length = payload[1] - payload[0];
+    const size_t offset = inputOffset(v._internal_get_text()) + payload[0];
+    const bool inRoot = v._internal_get_text() == document._internal_get_input().get_data();
+
+    sajson::mutable_string_view input;
+    size_t ends;
+    if (inRoot) {
+        // copy, so the source in the root input remains intact
+        input = sajson::mutable_string_view(sajson::string(text, length));
+        ends = m_structureEnds.size();
+        opts.record_ends = &m_structureEnds.emplace_back();
+    }
+    else {
+        // in place in the copy of a value of the root (which we own)
+        input = sajson::mutable_string_view(length, text);
+        ends = m_lazyInputs.at(v._internal_get_text()).ends;
+        opts.known_ends = &m_structureEnds[ends];
+    }
+
+    auto doc = sajson::parse(sajson::single_allocation(), input, opts);
+    if (!doc.is_valid()) {
+        if (inRoot) {
+            m_structureEnds.pop_back();
+        }
+        else {
+            // a failed parse may have left the source half parsed, so it's restored
+            // for the next attempt (which will fail in the same way)
+            memcpy(text, document._internal_get_input().get_data() + offset, length);
+        }
+        auto ex = parseError(doc);
+        ex.setInputOffset(offset + ex.inputOffset());
+        throw ex;
+    }
+
+    m_lazyInputs.emplace(doc._internal_get_input().get_data(), LazyInput{offset, ends});
+    lazyDocuments.push_back(std::move(doc));
+    payload[2] = sajson::ast_word(lazyDocuments.size());
+    return lazyDocuments.back().get_root();
+}
+
+size_t Parser::inputOffset(const char* text) const {
+    if (text == document._internal_get_input().get_data()) return 0;
+    return m_lazyInputs.at(text).offset;
+}
+
+std::string_view Parser::lazySource(const ImValue& v) const {
+    auto payload = v._internal_get_payload();
+    auto begin = document._internal_get_input().get_data() + inputOffset(v._internal_get_text()) + payload[0];
+    return std::string_view(begin, payload[1] - payload[0]);
+}
+
+ImValue Parser::parsedLazyValue(const ImValue& v) const {
+    if (!v.is_lazy()) return v;
+    auto payload = v._internal_get_payload();
+    if (payload[2]) return lazyDocuments[payload[2] - 1].get_root();
+    return v;
+}
+
+std::string_view Parser::unescapeString(const ImValue& v) {
+    // the payload is start, end, and the unescaped length+1 (0 if not unescaped)
+    // as with lazy values it's part of the AST which we own, and so is the input
+    auto payload = const_cast<sajson::ast_word*>(v._internal_get_payload());
+    if (!payload[2]) {
+        // the unescaped string is never longer than the source, so it's unescaped in place
+        // the closing quote is included, as unescaping stops at it
+        auto src = const_cast<char*>(v._internal_get_text()) + payload[0];
+        const size_t length = sajson::unescape_raw_string(src, payload[1] - payload[0] + 1);
+        payload[2] = length == size_t(-1) ? ImValue::invalid_unescaped : sajson::ast_word(length + 1);
+    }
+
+    auto str = v._internal_get_unescaped_string();
+    if (!str) {
+        DeserializerException ex(ErrorCode::Parse);
+        ex.setInputOffset(inputOffset(v._internal_get_text()) + payload[0]);
+        throw ex;
+    }
+    return *str;
+}
+
+namespace sajson {
+size_t unescape_raw_string(char* buf, size_t length) {
+    parser<single_allocation::allocator> p(mutable_string_view(length, buf), single_allocation::allocator(nullptr));
+    return p.unescape_string_contents();
+}
+} // namespace sajson
+
 } // namespace huse::json
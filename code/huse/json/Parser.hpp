@@ -5,14 +5,59 @@
 #include "../API.h"
 #include "_sajson/sajson.hpp"
 #include <string_view>
+#include <optional>
+#include <string>
+#include <vector>
+#include <unordered_map>
 #include <cstddef>
 
 namespace huse::json {
 
+class Projection;
+
+struct ParseOptions {
+    // only parse the root object or array
+    // nested non-empty objects and arrays are only bracket-matched and are
+    // parsed (in the same lazy manner) on first access
+    // errors in them are reported only when (and if) they are accessed
+    bool lazy = false;
+
+    // record the source spans of the values in Parser::sourceMap (see Patch.hpp)
+    // the spans of values in lazy structures are not recorded
+    bool sourceSpans = false;
+
+    // only parse the values on the paths of the projection (see Projection.hpp)
+    // it must outlive the parse (but not the parser)
+    // with lazy, only the values at the ends of the paths can be lazy
+    const Projection* projection = nullptr;
+
+    // don't convert numbers while parsing, but when (and if) they are read
+    // they are converted directly to the type which is read, so 64-bit integers are exact
+    // invalid numbers which are valid JSON (like 1e999) are reported only when read
+    bool lazyNumbers = false;
+
+    // don't unescape strings while parsing, but when (and if) they are read
+    // strings with escapes are only bracket-matched (and their UTF-8 is validated), so
+    // forwarding them as RawJson costs nothing
+    // invalid escapes are reported only when read
+    // reading them as std::string_view is only possible through a deserializer, which
+    // unescapes them in place (after which they can't be read as RawJson)
+    bool lazyStrings = false;
+
+    // validate strings (and keys) as strict UTF-8: without it overlong forms, surrogates,
+    // and code points above U+10FFFF are accepted
+    // invalid ones are reported as ErrorCode::Parse with the offset of the invalid byte
+    // values skipped by a projection aren't validated
+    bool strictUtf8 = false;
+};
+
 struct HUSE_API Parser {
     explicit Parser(sajson::document&& doc);
-    explicit Parser(std::string_view str);
-    explicit Parser(char* mutableString, size_t len = size_t(-1));
+    explicit Parser(std::string_view str, const ParseOptions& opts = {});
+    explicit Parser(char* mutableString, size_t len = size_t(-1), const ParseOptions& opts = {});
+
+    // in-situ parse which shares the ownership of the buffer of input (if it owns one)
+    explicit Parser(sajson::mutable_string_view input, const ParseOptions& opts = {});
 
     ~Parser();
 
@@ -26,7 +71,66 @@ struct HUSE_API Parser {
 
     ImValue rootValue() const;
 
+    // parse without throwing
+    // the returned document is invalid if there was an error
+    // the source spans are recorded in spans if it's not null (opts.sourceSpans is ignored)
+    static sajson::document parseDocument(std::string_view str, const ParseOptions& opts = {}, sajson::source_map* spans = nullptr);
+    static sajson::document parseDocument(char* mutableString, size_t len = size_t(-1), const ParseOptions& opts = {}, sajson::source_map* spans = nullptr);
+    static sajson::document parseDocument(const sajson::mutable_string_view& input, const ParseOptions& opts = {}, sajson::source_map* spans = nullptr);
+
+    // exception describing the error of an invalid document
+    static DeserializerException parseError(const sajson::document& doc);
+
+    // value of a lazy value (see ParseOptions::lazy) parsing it if needed
+    // returns v itself if it's not lazy
+    // values of the root are parsed from a copy of their source, and the ones nested deeper
+    // are parsed in place in that copy, skipping the structures in them by the ends recorded
+    // when it was parsed, so each byte of the input is copied and scanned at most once
+    ImValue parseLazyValue(const ImValue& v);
+
+    // source text of a lazy value
+    // unlike ImValue::get_lazy_source, it remains intact after the value is parsed, as it's
+    // in the root input
+    std::string_view lazySource(const ImValue& v) const;
+
+    // value of a lazy value if it has already been parsed, or v itself otherwise
+    ImValue parsedLazyValue(const ImValue& v) const;
+
+    // unescaped string of a raw string (see ParseOptions::lazyStrings), unescaping it if needed
+    // it's unescaped in place in the input, so its source is not available after that
+    // throws DeserializerException(ErrorCode::Parse) if the string is invalid
+    // v must be a raw string
+    std::string_view unescapeString(const ImValue& v);
+
+    // source spans of the values (empty unless ParseOptions::sourceSpans was set)
+    // declared before the document, as it's filled while parsing it
+    sajson::source_map sourceMap;
+
     sajson::document document;
+
+    // documents of the parsed lazy values
+    std::vector<sajson::document> lazyDocuments;
+
+private:
+    // offset in the root input of text (of the root or of a lazy document)
+    size_t inputOffset(const char* text) const;
+
+    struct LazyInput {
+        size_t offset; // in the root input (used to report errors)
+        size_t ends; // index in m_structureEnds
+    };
+
+    // text of each lazy document to its input
+    std::unordered_map<const char*, LazyInput> m_lazyInputs;
+
+    // ends of the structures in each copied source (see parseLazyValue)
+    std::vector<sajson::structure_ends> m_structureEnds;
+
+    // for the lazy documents
+    bool m_lazyNumbers = false;
+    bool m_lazyStrings = false;
+    bool m_strictUtf8 = false;
+
 };
 
 } // namespace huse::json
@@ -0,0 +1,140 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include "Patch.hpp"
+#include "Parser.hpp"
+#include "Serializer.hpp"
+
+#include "../Exception.hpp"
+
+#include <algorithm>
+#include <ostream>
+
+namespace huse::json {
+
+namespace {
+
+// a range of the source replaced with text
+struct Splice {
+    size_t begin, end;
+    const std::string* text;
+
+    // for added keys
+    const std::string* key = nullptr;
+    bool comma = false;
+    size_t order; // in the patch
+};
+
+} // namespace
+
+void Patch::set(std::string_view pointer, RawJson json) {
+    setRendered(pointer, std::string(json.str));
+}
+
+void Patch::setRendered(std::string_view pointer, std::string json) {
+    m_edits.push_back({Pointer(pointer), std::move(json)});
+}
+
+void Patch::apply(const Parser& parser, std::string_view source, std::ostream& out) const {
+    auto& map = parser.sourceMap;
+    if (map.empty() || source.size() != parser.document._internal_get_input().length()) {
+        throw DeserializerException(ErrorCode::NoSource);
+    }
+
+    std::vector<Splice> splices;
+    splices.reserve(m_edits.size());
+
+    for (size_t ei = 0; ei < m_edits.size(); ++ei) {
+        auto& edit = m_edits[ei];
+        std::vector<PathSegment> path;
+        auto fail = [&](ErrorCode code) {
+            DeserializerException ex(code);
+            ex.setPathSegments(std::move(path));
+            throw ex;
+        };
+
+        ImValue v = parser.rootValue();
+        sajson::source_span span = map.get_root_span();
+        Splice splice = {};
+        splice.text = &edit.json;
+        splice.order = ei;
+
+        bool added = false;
+        auto& segments = edit.pointer.segments();
+        for (size_t i = 0; i < segments.size(); ++i) {
+            auto& seg = segments[i];
+            const bool last = i == segments.size() - 1;
+
+            if (v.is_lazy()) fail(ErrorCode::NoSource);
+
+            size_t index;
+            if (v.get_type() == sajson::TYPE_OBJECT) {
+                path.push_back({seg.key, -1});
+                index = v.find_object_key(seg.key);
+                if (index == v.get_length()) {
+                    if (!last) fail(ErrorCode::KeyNotFound);
+                    // add the key before the closing brace
+                    splice.key = &seg.key;
+                    splice.comma = v.get_length() != 0;
+                    splice.begin = splice.end = span.end - 1;
+                    added = true;
+                    break;
+                }
+            }
+            else if (v.get_type() == sajson::TYPE_ARRAY) {
+                if (seg.index < 0 || size_t(seg.index) >= v.get_length()) {
+                    path.push_back({seg.key, -1});
+                    fail(ErrorCode::IndexOutOfBounds);
+                }
+                index = size_t(seg.index);
+                path.push_back({{}, seg.index});
+            }
+            else {
+                path.push_back({seg.key, -1});
+                fail(ErrorCode::NotObject);
+            }
+
+            span = map.get_element_span(v, index);
+            v = v.get_type() == sajson::TYPE_OBJECT ? v.get_object_value(index) : v.get_array_element(index);
+        }
+
+        if (!added) {
+            splice.begin = span.begin;
+            splice.end = span.end;
+        }
+        splices.push_back(splice);
+    }
+
+    // stable for keys added to the same object
+    std::stable_sort(splices.begin(), splices.end(), [](const Splice& a, const Splice& b) {
+        if (a.begin != b.begin) return a.begin < b.begin;
+        return a.end < b.end;
+    });
+
+    for (size_t i = 1; i < splices.size(); ++i) {
+        auto& prev = splices[i - 1];
+        auto& cur = splices[i];
+        const bool sameAdded = prev.key && cur.key && prev.begin == cur.begin;
+        if (cur.begin < prev.end || (cur.begin == prev.begin && !sameAdded) || (sameAdded && *prev.key == *cur.key)) {
+            throw DeserializerException("overlapping patch edits");
+        }
+        if (sameAdded) cur.comma = true; // after the one added before it
+    }
+
+    auto& buf = *out.rdbuf();
+    size_t pos = 0;
+    for (auto& s : splices) {
+        buf.sputn(source.data() + pos, std::streamsize(s.begin - pos));
+        if (s.key) {
+            if (s.comma) buf.sputc(',');
+            JsonSerializer ks(out);
+            ks.writeValue(std::string_view(*s.key));
+            buf.sputc(':');
+        }
+        buf.sputn(s.text->data(), std::streamsize(s.text->size()));
+        pos = s.end;
+    }
+    buf.sputn(source.data() + pos, std::streamsize(source.size() - pos));
+}
+
+} // namespace huse::json
@@ -0,0 +1,75 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "../API.h"
+#include "RawJson.hpp"
+#include "SerializerRoot.hpp"
+#include "Pointer.hpp"
+#include <iosfwd>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace huse::json {
+
+struct Parser;
+
+// edits of a parsed document which are applied without re-serializing it
+// the untouched parts of the document are copied from its source text as whole
+// ranges and only the new values are rendered:
+//
+//      json::Parser p(text, {.sourceSpans = true});
+//      json::Patch patch;
+//      patch.set("/items/3/name", "new name");
+//      patch.set("/count", json::RawJson{"42"});
+//      patch.apply(p, text, out);
+//
+// apart from copying the document, the cost is proportional to the size of the edits
+// and the depth of their paths (the values are found through the source spans of the
+// parser), and not to the size of the document
+class HUSE_API Patch {
+public:
+    // set the value at pointer (a JSON pointer, RFC 6901) to json, which is not validated
+    // the parent of the value must exist
+    // if it's an object which doesn't have the key, the key is added at its end
+    // throws DeserializerException if pointer is not a valid JSON pointer
+    void set(std::string_view pointer, RawJson json);
+
+    // set the value at pointer to value, rendered with JsonSerializer
+    template <typename T>
+    void set(std::string_view pointer, const T& value) {
+        std::ostringstream out;
+        {
+            SerializerRoot s(out);
+            s.val(value);
+        }
+        setRendered(pointer, std::move(out).str());
+    }
+
+    // write the patched document to out
+    // parser must have been constructed from source with ParseOptions::sourceSpans
+    // throws DeserializerException with the path of the edit if it can't be applied:
+    //  * ErrorCode::NoSource if the source spans are not available (including for values
+    //    in lazy structures) or the source is not the one of the parser
+    //  * ErrorCode::KeyNotFound, ErrorCode::IndexOutOfBounds, ErrorCode::NotObject
+    //    if the parent of the value doesn't exist
+    //  * ErrorCode::Custom if edits overlap
+    void apply(const Parser& parser, std::string_view source, std::ostream& out) const;
+
+    size_t size() const { return m_edits.size(); }
+    bool empty() const { return m_edits.empty(); }
+    void clear() { m_edits.clear(); }
+
+private:
+    void setRendered(std::string_view pointer, std::string json);
+
+    struct Edit {
+        Pointer pointer;
+        std::string json;
+    };
+    std::vector<Edit> m_edits;
+};
+
+} // namespace huse::json
@@ -0,0 +1,127 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include "Pointer.hpp"
+#include <charconv>
+#include <limits>
+
+namespace huse::json {
+
+namespace {
+[[noreturn]] void throwInvalid() {
+    throw DeserializerException("invalid json pointer");
+}
+
+int arrayIndex(std::string_view key) {
+    // no leading zeroes or signs
+    if (key.empty() || (key.size() > 1 && key[0] == '0')) return -1;
+    int ret;
+    auto res = std::from_chars(key.data(), key.data() + key.size(), ret);
+    if (res.ec != std::errc() || res.ptr != key.data() + key.size() || ret < 0) return -1;
+    return ret;
+}
+} // namespace
+
+Pointer::Pointer(std::string_view str) {
+    if (str.empty()) return; // root
+    if (str.front() != '/') throwInvalid();
+
+    str.remove_prefix(1);
+    for (;;) {
+        auto end = str.find('/');
+        auto raw = str.substr(0, end);
+        auto& seg = m_segments.emplace_back();
+        for (size_t i = 0; i < raw.size(); ++i) {
+            if (raw[i] != '~') {
+                seg.key += raw[i];
+                continue;
+            }
+            ++i;
+            if (i == raw.size() || (raw[i] != '0' && raw[i] != '1')) throwInvalid();
+            seg.key += raw[i] == '0' ? '~' : '/';
+        }
+        seg.index = arrayIndex(seg.key);
+        if (end == std::string_view::npos) return;
+        str.remove_prefix(end + 1);
+    }
+}
+
+int Pointer::step(const ImValue& v, const Segment& seg, int hint) noexcept {
+    if (v.is_lazy()) return -1;
+    const auto t = v.get_type();
+    if (t != sajson::TYPE_ARRAY && t != sajson::TYPE_OBJECT) return -1;
+
+    const int length = int(v.get_length());
+    if (t == sajson::TYPE_ARRAY) {
+        return seg.index < length ? seg.index : -1;
+    }
+
+    // cursor
+    if (hint < length && v.get_object_key(size_t(hint)) == seg.key) return hint;
+
+    // linear or binary search
+    const int index = int(v.find_object_key(seg.key));
+    return index < length ? index : -1;
+}
+
+std::optional<ImValue> Pointer::find(const ImValue& root) const noexcept {
+    ImValue v = root;
+    for (auto& seg : m_segments) {
+        const int index = step(v, seg);
+        if (index < 0) return std::nullopt;
+        v = v.get_type() == sajson::TYPE_ARRAY ? v.get_array_element(size_t(index)) : v.get_object_value(size_t(index));
+    }
+    return v;
+}
+
+PointerBatch::PointerBatch(std::span<const Pointer> pointers) {
+    for (auto& p : pointers) {
+        add(p);
+    }
+}
+
+size_t PointerBatch::add(const Pointer& pointer) {
+    uint32_t cur = 0;
+    for (auto& seg : pointer.segments()) {
+        uint32_t next = 0;
+        for (auto c : m_nodes[cur].children) {
+            if (m_nodes[c].segment.key == seg.key) {
+                next = c;
+                break;
+            }
+        }
+        if (!next) {
+            next = uint32_t(m_nodes.size());
+            m_nodes[cur].children.push_back(next);
+            m_nodes.push_back({seg, {}, {}}); // invalidates references to nodes
+        }
+        cur = next;
+    }
+    m_nodes[cur].pointers.push_back(uint32_t(m_size));
+    return m_size++;
+}
+
+void PointerBatch::find(const ImValue& root, std::span<std::optional<ImValue>> results) const noexcept {
+    for (auto& r : results) {
+        r.reset();
+    }
+    findIn(root, m_nodes.front(), results);
+}
+
+void PointerBatch::findIn(const ImValue& v, const TrieNode& tn, std::span<std::optional<ImValue>> results) const noexcept {
+    for (auto i : tn.pointers) {
+        results[i] = v;
+    }
+
+    const bool array = v.get_type() == sajson::TYPE_ARRAY;
+    int hint = 0;
+    for (auto c : tn.children) {
+        auto& child = m_nodes[c];
+        const int index = Pointer::step(v, child.segment, hint);
+        if (index < 0) continue;
+        hint = index + 1;
+        findIn(array ? v.get_array_element(size_t(index)) : v.get_object_value(size_t(index)), child, results);
+    }
+}
+
+} // namespace huse::json
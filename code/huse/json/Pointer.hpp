@@ -0,0 +1,169 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "../API.h"
+#include "../ImValue.hpp"
+#include "../DeserializerNode.hpp"
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace huse::json {
+
+// compiled JSON pointer (RFC 6901): parsed once and evaluated any number of times
+//
+//      static const json::Pointer p("/a/b/3/c");
+//      int c;
+//      p.at(root).val(c);
+//
+class HUSE_API Pointer {
+public:
+    struct Segment {
+        std::string key; // unescaped
+        int index = -1; // the key as an array index or -1 if it's not a valid one
+    };
+
+    // the root
+    Pointer() = default;
+
+    // throws DeserializerException if str is not a valid JSON pointer
+    explicit Pointer(std::string_view str);
+
+    const std::vector<Segment>& segments() const noexcept { return m_segments; }
+
+    // the value in root
+    // doesn't allocate and doesn't parse lazy values (values in them are not found)
+    std::optional<ImValue> find(const ImValue& root) const noexcept;
+
+    // node of the value in node (parsing lazy values if needed)
+    template <typename Deserializer>
+    std::optional<DeserializerNode<Deserializer>> find(const DeserializerNode<Deserializer>& node) const;
+
+    // same as find, but throws DeserializerException with the path of the missing value's parent
+    template <typename Deserializer>
+    DeserializerNode<Deserializer> at(const DeserializerNode<Deserializer>& node) const;
+
+    // index of the value of seg in the object or array v or -1 if there's no such value
+    // for objects the key at hint is checked first
+    static int step(const ImValue& v, const Segment& seg, int hint = 0) noexcept;
+
+private:
+    template <typename Deserializer>
+    static std::optional<DeserializerNode<Deserializer>> stepNode(const DeserializerNode<Deserializer>& node, const Segment& seg, bool required);
+
+    std::vector<Segment> m_segments;
+};
+
+// many pointers evaluated in a single traversal
+// common prefixes are walked once, and the keys of an object are looked up in the
+// order in which the pointers are added, each lookup starting from the key after the
+// previous one (so pointers in document order have no key searches)
+class HUSE_API PointerBatch {
+public:
+    PointerBatch() = default;
+    explicit PointerBatch(std::span<const Pointer> pointers);
+
+    // returns the index of the pointer in the results
+    size_t add(const Pointer& pointer);
+
+    size_t size() const noexcept { return m_size; }
+
+    // results[i] is set to the value of the i-th pointer or to nullopt if it's not found
+    // results must have size() elements
+    // doesn't allocate and doesn't parse lazy values (values in them are not found)
+    void find(const ImValue& root, std::span<std::optional<ImValue>> results) const noexcept;
+
+    // nodes of the values of the pointers in node (nullopt if not found)
+    template <typename Deserializer>
+    std::vector<std::optional<DeserializerNode<Deserializer>>> find(const DeserializerNode<Deserializer>& node) const;
+
+private:
+    // prefix tree of the pointers
+    struct TrieNode {
+        Pointer::Segment segment; // from the parent
+        std::vector<uint32_t> children; // in order of addition
+        std::vector<uint32_t> pointers; // which end here
+    };
+    std::vector<TrieNode> m_nodes = {TrieNode{}}; // the first one is the root
+    size_t m_size = 0;
+
+    void findIn(const ImValue& v, const TrieNode& tn, std::span<std::optional<ImValue>> results) const noexcept;
+
+    template <typename Deserializer>
+    void findIn(const DeserializerNode<Deserializer>& node, const TrieNode& tn, std::vector<std::optional<DeserializerNode<Deserializer>>>& results) const;
+};
+
+template <typename Deserializer>
+std::optional<DeserializerNode<Deserializer>> Pointer::stepNode(const DeserializerNode<Deserializer>& node, const Segment& seg, bool required) {
+    if (node.type().isArray()) {
+        DeserializerArray<Deserializer> ar(node);
+        if (seg.index < 0 || seg.index >= ar.size()) {
+            if (required) ar.throwException(ErrorCode::IndexOutOfBounds);
+            return std::nullopt;
+        }
+        return ar.index(seg.index);
+    }
+    if (!required && !node.type().isObject()) return std::nullopt;
+    DeserializerObject<Deserializer> obj(node); // throws if not an object
+    if (required) return obj.key(seg.key);
+    return obj.optkey(seg.key);
+}
+
+template <typename Deserializer>
+std::optional<DeserializerNode<Deserializer>> Pointer::find(const DeserializerNode<Deserializer>& node) const {
+    std::optional<DeserializerNode<Deserializer>> ret = node;
+    for (auto& seg : m_segments) {
+        ret = stepNode(*ret, seg, false);
+        if (!ret) break;
+    }
+    return ret;
+}
+
+template <typename Deserializer>
+DeserializerNode<Deserializer> Pointer::at(const DeserializerNode<Deserializer>& node) const {
+    DeserializerNode<Deserializer> ret = node;
+    for (auto& seg : m_segments) {
+        ret = *stepNode(ret, seg, true);
+    }
+    return ret;
+}
+
+template <typename Deserializer>
+std::vector<std::optional<DeserializerNode<Deserializer>>> PointerBatch::find(const DeserializerNode<Deserializer>& node) const {
+    std::vector<std::optional<DeserializerNode<Deserializer>>> ret(m_size);
+    findIn(node, m_nodes.front(), ret);
+    return ret;
+}
+
+template <typename Deserializer>
+void PointerBatch::findIn(const DeserializerNode<Deserializer>& node, const TrieNode& tn, std::vector<std::optional<DeserializerNode<Deserializer>>>& results) const {
+    for (auto i : tn.pointers) {
+        results[i] = node;
+    }
+    if (tn.children.empty()) return;
+
+    if (node.type().isArray()) {
+        DeserializerArray<Deserializer> ar(node);
+        for (auto c : tn.children) {
+            auto& child = m_nodes[c];
+            if (child.segment.index < 0 || child.segment.index >= ar.size()) continue;
+            findIn(ar.index(child.segment.index), child, results);
+        }
+    }
+    else if (node.type().isObject()) {
+        // a single object so that its key cursor is used
+        DeserializerObject<Deserializer> obj(node);
+        for (auto c : tn.children) {
+            auto& child = m_nodes[c];
+            if (auto n = obj.optkey(child.segment.key)) {
+                findIn(*n, child, results);
+            }
+        }
+    }
+}
+
+} // namespace huse::json
@@ -0,0 +1,27 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include "Projection.hpp"
+#include "Pointer.hpp"
+
+namespace huse::json {
+
+Projection::Projection(std::initializer_list<std::string_view> pointers) {
+    for (auto p : pointers) {
+        add(p);
+    }
+}
+
+void Projection::add(std::string_view pointer) {
+    add(Pointer(pointer));
+}
+
+void Projection::add(const Pointer& pointer) {
+    uint32_t node = 0;
+    for (auto& seg : pointer.segments()) {
+        node = m_tree.add_child(node, seg.key, seg.index < 0 ? size_t(-1) : size_t(seg.index), seg.key == "*");
+    }
+    m_tree.set_complete(node);
+}
+
+} // namespace huse::json
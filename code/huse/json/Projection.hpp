@@ -0,0 +1,45 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "../API.h"
+#include "_sajson/sajson.hpp"
+#include <initializer_list>
+#include <string_view>
+
+namespace huse::json {
+
+class Pointer;
+
+// paths of the values to parse (see ParseOptions::projection)
+// compiled once and used for any number of parses:
+//
+//      static const json::Projection proj = {"/id", "/items/*/price"};
+//      json::DeserializerRoot d(text, {.projection = &proj});
+//
+// only the values on the paths are parsed, and everything else is skipped by
+// bracket and string matching (and so it's not validated either)
+// object members which are not on a path are left out, so accessing them reports
+// ErrorCode::KeyNotFound, and array elements which are not on a path are null
+// (so that the indices of the others are preserved)
+// the value at the end of a path is parsed whole
+class HUSE_API Projection {
+public:
+    Projection() = default;
+
+    // throws DeserializerException if a pointer is invalid
+    Projection(std::initializer_list<std::string_view> pointers);
+
+    // add a JSON pointer (RFC 6901) in which "*" segments match any key or index
+    // (which is not matched by a sibling segment)
+    // throws DeserializerException if pointer is invalid
+    void add(std::string_view pointer);
+    void add(const Pointer& pointer);
+
+    const sajson::projection& tree() const { return m_tree; }
+
+private:
+    sajson::projection m_tree;
+};
+
+} // namespace huse::json
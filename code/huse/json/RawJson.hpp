@@ -0,0 +1,15 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include <string_view>
+
+namespace huse::json {
+
+// json text which is written as is by serializers
+// and can be read as the source text of a value by deserializers
+struct RawJson {
+    std::string_view str;
+};
+
+} // namespace huse::json
@@ -0,0 +1,34 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include "Sax.hpp"
+#include "impl/Scanner.hpp"
+
+namespace huse::json {
+
+SaxHandler::~SaxHandler() = default;
+
+namespace {
+struct HandlerEvents {
+    static constexpr bool Decode_Values = true;
+    SaxHandler& h;
+    void openObject() { h.openObject(); }
+    void closeObject() { h.closeObject(); }
+    void openArray() { h.openArray(); }
+    void closeArray() { h.closeArray(); }
+    void key(std::string_view k) { h.key(k); }
+    void stringValue(std::string_view s) { h.stringValue(s); }
+    void integerValue(int64_t i) { h.integerValue(i); }
+    void floatValue(double d) { h.floatValue(d); }
+    void boolValue(bool b) { h.boolValue(b); }
+    void nullValue() { h.nullValue(); }
+};
+} // namespace
+
+ValidationResult parseSax(std::string_view str, SaxHandler& handler) {
+    HandlerEvents events = {handler};
+    impl::Scanner<HandlerEvents> scanner(str, events);
+    return scanner.run();
+}
+
+} // namespace huse::json
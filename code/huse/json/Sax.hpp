@@ -0,0 +1,43 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "../API.h"
+#include "Validator.hpp"
+#include <string_view>
+#include <cstdint>
+
+namespace huse::json {
+
+// receives the tokens of a document as it's scanned by parseSax
+// the default implementations ignore them
+// string views are only valid during the call
+class HUSE_API SaxHandler {
+public:
+    virtual ~SaxHandler();
+
+    virtual void openObject() {}
+    virtual void closeObject() {}
+    virtual void openArray() {}
+    virtual void closeArray() {}
+
+    virtual void key(std::string_view) {}
+
+    virtual void stringValue(std::string_view) {}
+    // integers which don't fit in 64 bits are reported as floats
+    virtual void integerValue(int64_t) {}
+    virtual void floatValue(double) {}
+    virtual void boolValue(bool) {}
+    virtual void nullValue() {}
+};
+
+// push (SAX-style) parsing: report the tokens of str to handler without producing an AST
+// the input is not modified and the memory used is proportional to the nesting depth
+// and to the longest string with escapes only
+// the same documents as Parser are accepted, with the same error codes and offsets
+// the tokens before an error are reported, so handlers which care about invalid input
+// should check the result before committing to what they've gathered
+// exceptions from the handler are propagated
+HUSE_API ValidationResult parseSax(std::string_view str, SaxHandler& handler);
+
+} // namespace huse::json
@@ -0,0 +1,71 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include "SegmentedOutput.hpp"
+
+namespace huse::json {
+
+SegmentedOutput::SegmentedOutput(size_t minReferenceSize)
+    : m_minReferenceSize(minReferenceSize)
+    , m_stream(this)
+{}
+
+SegmentedOutput::~SegmentedOutput() = default;
+
+void SegmentedOutput::endTextSegment() {
+    if (pptr() == m_textBegin) return;
+    const size_t size = size_t(pptr() - m_textBegin);
+    m_segments.push_back({m_textBegin, size});
+    m_segmentsSize += size;
+    m_textBegin = pptr();
+}
+
+SegmentedOutput::int_type SegmentedOutput::overflow(int_type ch) {
+    endTextSegment();
+    if (m_usedChunks == m_chunks.size()) {
+        m_chunks.push_back(std::make_unique<char[]>(Chunk_Size));
+    }
+    char* chunk = m_chunks[m_usedChunks++].get();
+    setp(chunk, chunk + Chunk_Size);
+    m_textBegin = chunk;
+
+    if (traits_type::eq_int_type(ch, traits_type::eof())) return traits_type::not_eof(ch);
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+    return ch;
+}
+
+void SegmentedOutput::reference(std::string_view str) {
+    if (str.empty()) return;
+    endTextSegment();
+    m_segments.push_back({str.data(), str.size()});
+    m_segmentsSize += str.size();
+}
+
+const std::vector<SegmentedOutput::Segment>& SegmentedOutput::segments() {
+    endTextSegment();
+    return m_segments;
+}
+
+size_t SegmentedOutput::size() const {
+    return m_segmentsSize + size_t(pptr() - m_textBegin);
+}
+
+std::string SegmentedOutput::str() {
+    std::string ret;
+    ret.reserve(size());
+    for (auto& seg : segments()) {
+        ret.append(seg.data, seg.size);
+    }
+    return ret;
+}
+
+void SegmentedOutput::clear() {
+    m_segments.clear();
+    m_segmentsSize = 0;
+    m_usedChunks = 0;
+    setp(nullptr, nullptr);
+    m_textBegin = nullptr;
+}
+
+} // namespace huse::json
@@ -0,0 +1,84 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "../API.h"
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+
+namespace huse::json {
+
+// output of a JsonSerializer as a list of segments for scatter/gather i/o (writev, sendmsg):
+// the text written by the serializer, which is stored in chunks owned by the output, and
+// references to large strings of the caller, which are not copied
+//
+//      json::SegmentedOutput out;
+//      {
+//          json::SerializerRoot s(out);
+//          s.val(data);
+//      }
+//      for (auto& seg : out.segments()) ... // iovec{seg.data, seg.size}
+//
+// string values (and RawJson) of at least minReferenceSize bytes which need no escaping are
+// referenced, so the strings must be alive and unchanged for as long as the segments are used
+class HUSE_API SegmentedOutput : private std::streambuf {
+public:
+    static constexpr size_t Default_Min_Reference_Size = 4096;
+
+    explicit SegmentedOutput(size_t minReferenceSize = Default_Min_Reference_Size);
+    ~SegmentedOutput();
+
+    SegmentedOutput(const SegmentedOutput&) = delete;
+    SegmentedOutput& operator=(const SegmentedOutput&) = delete;
+
+    struct Segment {
+        const char* data;
+        size_t size;
+    };
+
+    // the stream to which the text is written
+    std::ostream& stream() { return m_stream; }
+
+    size_t minReferenceSize() const { return m_minReferenceSize; }
+
+    // add a segment which refers to str instead of copying it
+    void reference(std::string_view str);
+
+    // the segments of the output so far, in order
+    // it can be called before the output is complete (to flush a part of it), and the
+    // returned segments remain valid (and the same) as more is written
+    const std::vector<Segment>& segments();
+
+    // total size of the output so far
+    size_t size() const;
+
+    // a copy of the whole output
+    std::string str();
+
+    // discard the output (the chunks are kept to be reused)
+    void clear();
+
+private:
+    virtual int_type overflow(int_type ch) override;
+
+    // add the text written since the last segment as a segment
+    void endTextSegment();
+
+    static constexpr size_t Chunk_Size = 16 * 1024;
+    std::vector<std::unique_ptr<char[]>> m_chunks;
+    size_t m_usedChunks = 0;
+
+    std::vector<Segment> m_segments;
+    size_t m_segmentsSize = 0; // total size of m_segments
+    char* m_textBegin = nullptr; // start of the text which is not in a segment yet
+
+    const size_t m_minReferenceSize;
+    std::ostream m_stream;
+};
+
+} // namespace huse::json
@@ -2,14 +2,18 @@
 // SPDX-License-Identifier: MIT
 //
 #include "Serializer.hpp"
-#include "Serializer.hpp"
+#include "SegmentedOutput.hpp"
+#include "CanonicalSerializer.hpp"
 #include "Limits.hpp"
 
 #include "../Exception.hpp"
 #include "../impl/Assert.hpp"
 #include "../impl/Charconv.hpp"
+#include "../impl/Utf8.hpp"
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <exception>
 #include <ostream>
 #include <type_traits>
@@ -36,7 +40,107 @@ std::optional<std::string_view> escapeUtf8Byte(char c)
     return belowSpace[u];
 }
 
-void writeEscapedUTF8StringToStreambuf(std::streambuf& buf, std::string_view str)
+// non-zero if a byte of the word at p needs escaping
+// with validation bytes which are not ascii are also reported, as they start a sequence to validate
+inline uint64_t specialBytes8(const char* p, bool validate) {
+    constexpr uint64_t ones = 0x0101010101010101ull;
+    constexpr uint64_t highs = 0x8080808080808080ull;
+    uint64_t w;
+    memcpy(&w, p, sizeof(w));
+    auto hasByte = [&](unsigned char b) {
+        const uint64_t x = w ^ (ones * b);
+        return (x - ones) & ~x & highs;
+    };
+    const uint64_t control = (w - ones * ' ') & ~w & highs;
+    return control | hasByte('"') | hasByte('\\') | (validate ? w & highs : 0);
+}
+
+bool needsEscaping(std::string_view str) {
+    auto p = str.data();
+    const auto end = p + str.size();
+    for (; end - p >= 8; p += 8) {
+        if (specialBytes8(p, false)) break;
+    }
+    for (; p != end; ++p) {
+        if (escapeUtf8Byte(*p)) return true;
+    }
+    return false;
+}
+
+// of pretty output (per depth)
+constexpr std::string_view Indent = "  ";
+
+// finite val as ECMAScript's Number::toString (RFC 8785 section 3.2.2.3) writes it
+// buf must be at least 32 bytes
+template <typename T>
+std::string_view canonicalNumber(char* buf, T val) {
+    if (val == 0) return "0"; // and -0
+
+    // shortest digits which round trip: [-]d[.ddd]e(+|-)xx
+    char sci[32];
+    auto result = HUSE_CHARCONV_NAMESPACE::to_chars(sci, sci + sizeof(sci), val, HUSE_CHARCONV_NAMESPACE::chars_format::scientific);
+    const char* p = sci;
+
+    char* out = buf;
+    if (*p == '-') *out++ = *p++;
+
+    char digits[24];
+    int k = 0; // number of digits
+    for (; *p != 'e'; ++p) {
+        if (*p != '.') digits[k++] = *p;
+    }
+    ++p; // e
+    const bool negativeExp = *p++ == '-';
+    int exp = 0;
+    for (; p != result.ptr; ++p) {
+        exp = exp * 10 + (*p - '0');
+    }
+    if (negativeExp) exp = -exp;
+
+    const int n = exp + 1; // position of the decimal point relative to the digits
+    if (k <= n && n <= 21) {
+        // integer
+        out = std::copy(digits, digits + k, out);
+        out = std::fill_n(out, n - k, '0');
+    }
+    else if (0 < n && n <= 21) {
+        out = std::copy(digits, digits + n, out);
+        *out++ = '.';
+        out = std::copy(digits + n, digits + k, out);
+    }
+    else if (-6 < n && n <= 0) {
+        *out++ = '0';
+        *out++ = '.';
+        out = std::fill_n(out, -n, '0');
+        out = std::copy(digits, digits + k, out);
+    }
+    else {
+        *out++ = digits[0];
+        if (k > 1) {
+            *out++ = '.';
+            out = std::copy(digits + 1, digits + k, out);
+        }
+        *out++ = 'e';
+        *out++ = n - 1 < 0 ? '-' : '+';
+        int e = n - 1 < 0 ? 1 - n : n - 1;
+        char expDigits[4];
+        int numExpDigits = 0;
+        do {
+            expDigits[numExpDigits++] = char('0' + e % 10);
+            e /= 10;
+        } while (e);
+        while (numExpDigits) *out++ = expDigits[--numExpDigits];
+    }
+    return std::string_view(buf, size_t(out - buf));
+}
+
+[[noreturn]] void throwInvalidUtf8() {
+    throw SerializerException(ErrorCode::InvalidUtf8);
+}
+
+// returns the number of bytes written
+// validates the string if utf8 is not null (a sequence can continue in the next call)
+size_t writeEscapedUTF8StringToStreambuf(std::streambuf& buf, std::string_view str, huse::impl::Utf8State* utf8 = nullptr)
 {
     // we could use this simple code here
     // but it writes bytes one by one
@@ -51,45 +155,70 @@ void writeEscapedUTF8StringToStreambuf(std::streambuf& buf, std::string_view str
     // to optimize, we'll use the following which writes in chunks
     // if there is nothing to be escaped in a string,
     //  it will print the whole string at the end as a single operation
+    // chunks without escapes (and without sequences to validate) are skipped a word at a time
 
     auto begin = str.data();
     const auto end = str.data() + str.size();
+    size_t escapeOverhead = 0;
 
     auto p = begin;
     while (p != end) {
+        if (end - p >= 8 && (!utf8 || utf8->complete()) && !specialBytes8(p, utf8)) {
+            p += 8;
+            continue;
+        }
+        if (utf8 && !utf8->step(uint8_t(*p))) throwInvalidUtf8();
         auto esc = escapeUtf8Byte(*p);
         if (!esc) ++p;
         else
         {
             if (p != begin) buf.sputn(begin, p - begin);
             buf.sputn(esc->data(), esc->length());
+            escapeOverhead += esc->length() - 1;
             begin = ++p;
         }
     }
     if (p != begin) buf.sputn(begin, p - begin);
+    return str.size() + escapeOverhead;
 }
 
-void writeQuotedEscapedUTF8StringToStream(std::ostream& sout, std::string_view str) {
+// returns the number of bytes written
+size_t writeQuotedEscapedUTF8StringToStream(std::ostream& sout, std::string_view str, bool strictUtf8) {
     auto& out = *sout.rdbuf();
     out.sputc('"');
-    writeEscapedUTF8StringToStreambuf(out, str);
+    size_t written;
+    if (strictUtf8) {
+        huse::impl::Utf8State utf8;
+        written = writeEscapedUTF8StringToStreambuf(out, str, &utf8);
+        if (!utf8.complete()) throwInvalidUtf8();
+    }
+    else {
+        written = writeEscapedUTF8StringToStreambuf(out, str);
+    }
     out.sputc('"');
+    return written + 2;
 }
 
 struct JsonRedirectStreambuf : public std::streambuf
 {
-    JsonRedirectStreambuf(std::streambuf& redirectTarget) : m_redirectTarget(redirectTarget) {}
+    JsonRedirectStreambuf(std::streambuf& redirectTarget, bool strictUtf8)
+        : m_redirectTarget(redirectTarget)
+        , m_strictUtf8(strictUtf8)
+    {}
 
     int_type overflow(int_type ch) override
     {
+        if (m_strictUtf8 && !m_utf8.step(uint8_t(ch))) throwInvalidUtf8();
         auto esc = escapeUtf8Byte(char(ch));
         if (esc)
         {
             m_redirectTarget.sputn(esc->data(), esc->length());
+            countWritten(esc->length());
         }
         else
         {
             m_redirectTarget.sputc(char(ch));
+            countWritten(1);
         }
 
         return ch;
@@ -97,13 +226,19 @@ struct JsonRedirectStreambuf : public std::streambuf
 
     std::streamsize xsputn(const char_type* s, std::streamsize num) override
     {
-        writeEscapedUTF8StringToStreambuf(m_redirectTarget, std::string_view(s, num));
+        countWritten(writeEscapedUTF8StringToStreambuf(m_redirectTarget, std::string_view(s, num), m_strictUtf8 ? &m_utf8 : nullptr));
         return num;
     }
 
+    void countWritten([[maybe_unused]] size_t n) {
+#if HUSE_INSTRUMENTATION
+        m_written += n;
+#endif
+    }
+
     [[noreturn]] void throwSeekException()
     {
-        throw SerializerException("Seek is not supported by JSON string streams");
+        throw SerializerException(ErrorCode::SeekNotSupported);
     }
 
     [[noreturn]] pos_type seekpos(pos_type, std::ios_base::openmode) override
@@ -117,6 +252,11 @@ struct JsonRedirectStreambuf : public std::streambuf
     }
 
     std::streambuf& m_redirectTarget;
+    const bool m_strictUtf8;
+    huse::impl::Utf8State m_utf8; // sequences can be split between writes
+#if HUSE_INSTRUMENTATION
+    size_t m_written = 0;
+#endif
 };
 
 } // namespace
@@ -126,15 +266,83 @@ JsonSerializer::JsonSerializer(std::ostream& out, bool pretty)
     , m_pretty(pretty)
 {}
 
+JsonSerializer::JsonSerializer(SegmentedOutput& out, bool pretty)
+    : m_out(out.stream())
+    , m_segmented(&out)
+    , m_pretty(pretty)
+{}
+
+JsonSerializer::JsonSerializer(std::ostream& out, impl::CanonicalStreambuf& canonical)
+    : m_out(out)
+    , m_canonical(&canonical)
+    , m_pretty(false)
+{}
+
 JsonSerializer::~JsonSerializer() {
     if (std::uncaught_exceptions()) return; // nothing smart to do
     HUSE_ASSERT_INTERNAL(m_depth == 0);
 }
 
 
+void JsonSerializer::countWritten([[maybe_unused]] size_t n) {
+#if HUSE_INSTRUMENTATION
+    _stats().bytesWritten += n;
+#endif
+}
+
+// reference str (as a json string if quoted) in the segmented output if it's worth it
+// returns false if it's not referenced and has to be written
+bool JsonSerializer::writeReference(std::string_view str, bool quoted) {
+    if (!m_segmented || str.size() < m_segmented->minReferenceSize()) return false;
+
+    if (quoted) {
+        // only reading the string is still much cheaper than copying it
+        if (m_strictUtf8) {
+            huse::impl::Utf8State utf8;
+            if (huse::impl::findInvalidUtf8(utf8, str.data(), str.data() + str.size()) || !utf8.complete()) {
+                throwInvalidUtf8();
+            }
+        }
+        if (needsEscaping(str)) return false;
+    }
+
+    prepareWriteVal();
+    auto& out = *m_out.rdbuf();
+    if (quoted) out.sputc('"');
+    m_segmented->reference(str);
+    if (quoted) out.sputc('"');
+    countWritten(str.size() + (quoted ? 2 : 0));
+    return true;
+}
+
 void JsonSerializer::writeRawJson(std::string_view json) {
     prepareWriteVal();
     m_out.rdbuf()->sputn(json.data(), json.size());
+    countWritten(json.size());
+}
+
+void JsonSerializer::writePrettyRawJson(std::string_view json) {
+    if (!m_pretty || m_depth == 0) {
+        writeRawJson(json);
+        return;
+    }
+
+    prepareWriteVal();
+    auto& out = *m_out.rdbuf();
+    const size_t size = json.size();
+    size_t lines = 0;
+    for (;;) {
+        auto nl = json.find('\n');
+        if (nl == std::string_view::npos) break;
+        out.sputn(json.data(), std::streamsize(nl + 1));
+        for (uint32_t i = 0; i < m_depth; ++i) {
+            out.sputn(Indent.data(), Indent.size());
+        }
+        json.remove_prefix(nl + 1);
+        ++lines;
+    }
+    out.sputn(json.data(), std::streamsize(json.size()));
+    countWritten(size + lines * m_depth * Indent.size());
 }
 
 void JsonSerializer::writeValue(bool val) {
@@ -156,6 +364,7 @@ void JsonSerializer::writeSmallInteger(T n) {
     if constexpr (std::is_signed_v<T>) {
         if (n < 0) {
             out.sputc('-');
+            countWritten(1);
             uvalue = 0 - uvalue;
         }
     }
@@ -170,6 +379,7 @@ void JsonSerializer::writeSmallInteger(T n) {
     } while (uvalue != 0);
 
     out.sputn(p, end - p);
+    countWritten(size_t(end - p));
 }
 
 void JsonSerializer::writeValue(short val) { writeSmallInteger(val); }
@@ -179,8 +389,6 @@ void JsonSerializer::writeValue(unsigned int val) { writeSmallInteger(val); }
 
 template <typename T>
 void JsonSerializer::writePotentiallyBigIntegerValue(T val) {
-    static constexpr std::string_view IntegerTooBig = "Integer value is bigger than maximum allowed for JSON";
-
     if constexpr (sizeof(T) <= 4) {
         // gcc and clang have long equal intptr_t, msvc has long at 4 bytes
         writeSmallInteger(val);
@@ -190,7 +398,7 @@ void JsonSerializer::writePotentiallyBigIntegerValue(T val) {
             writeSmallInteger(val);
         }
         else {
-            throwException(std::string(IntegerTooBig));
+            throwException(ErrorCode::IntegerTooBig);
         }
     }
     else {
@@ -198,7 +406,7 @@ void JsonSerializer::writePotentiallyBigIntegerValue(T val) {
             writeSmallInteger(val);
         }
         else {
-            throwException(std::string(IntegerTooBig));
+            throwException(ErrorCode::IntegerTooBig);
         }
     }
 }
@@ -212,12 +420,17 @@ void JsonSerializer::writeValue(unsigned long long val) { writePotentiallyBigInt
 template <typename T>
 void JsonSerializer::writeFloatValue(T val) {
     if (std::isfinite(val)) {
+        if (m_canonical) {
+            char out[32];
+            writeRawJson(canonicalNumber(out, val));
+            return;
+        }
         char out[25]; // max length of double
         auto result = HUSE_CHARCONV_NAMESPACE::to_chars(out, out + sizeof(out), val);
         writeRawJson(std::string_view(out, result.ptr - out));
     }
     else {
-        throwException("Floating point value is not finite. Not supported by JSON");
+        throwException(ErrorCode::NonFiniteFloat);
     }
 }
 
@@ -225,8 +438,9 @@ void JsonSerializer::writeValue(float val) { writeFloatValue(val); }
 void JsonSerializer::writeValue(double val) { writeFloatValue( val); }
 
 void JsonSerializer::writeValue(std::string_view val) {
+    if (writeReference(val, true)) return;
     prepareWriteVal();
-    writeQuotedEscapedUTF8StringToStream(m_out, val);
+    countWritten(writeQuotedEscapedUTF8StringToStream(m_out, val, m_strictUtf8));
 }
 
 void JsonSerializer::writeValue(std::nullopt_t) {
@@ -244,10 +458,10 @@ void JsonSerializer::newLine() {
 
     auto& out = *m_out.rdbuf();
     out.sputc('\n');
-    static constexpr std::string_view indent = "  ";
     for (uint32_t i = 0; i < m_depth; ++i) {
-        out.sputn(indent.data(), indent.size());
+        out.sputn(Indent.data(), Indent.size());
     }
+    countWritten(1 + m_depth * Indent.size());
 }
 
 void JsonSerializer::prepareWriteVal() {
@@ -255,12 +469,14 @@ void JsonSerializer::prepareWriteVal() {
 
     if (m_hasValue) {
         out.sputc(',');
+        countWritten(1);
     }
 
     newLine();
 
     if (m_pendingKey) {
-        writeQuotedEscapedUTF8StringToStream(m_out, *m_pendingKey);
+        if (m_canonical) m_canonical->member(*m_pendingKey);
+        countWritten(writeQuotedEscapedUTF8StringToStream(m_out, *m_pendingKey, m_strictUtf8) + 1);
         out.sputc(':');
         m_pendingKey.reset();
     }
@@ -271,6 +487,7 @@ void JsonSerializer::prepareWriteVal() {
 void JsonSerializer::open(char o) {
     prepareWriteVal();
     m_out.rdbuf()->sputc(o);
+    countWritten(1);
     m_hasValue = false;
     ++m_depth;
 }
@@ -280,20 +497,32 @@ void JsonSerializer::close(char c) {
     --m_depth;
     if (m_hasValue) newLine();
     m_out.rdbuf()->sputc(c);
+    countWritten(1);
     m_hasValue = true;
 }
 
-void JsonSerializer::openObject() { open('{'); }
-void JsonSerializer::closeObject() { close('}'); }
+void JsonSerializer::openObject() {
+    open('{');
+    if (m_canonical) m_canonical->openObject();
+}
+
+void JsonSerializer::closeObject() {
+    if (m_canonical) m_canonical->closeObject();
+    close('}');
+}
+
 void JsonSerializer::openArray() { open('['); }
 void JsonSerializer::closeArray() { close(']'); }
 
 
 struct JsonSerializer::JsonOStream {
-    JsonOStream(std::ostream& rt)
-        : streambuf(*rt.rdbuf())
+    JsonOStream(std::ostream& rt, bool strictUtf8)
+        : streambuf(*rt.rdbuf(), strictUtf8)
         , stream(&streambuf)
-    {}
+    {
+        // streams catch the exceptions of their buffers unless asked not to
+        if (strictUtf8) stream.exceptions(std::ios_base::badbit);
+    }
 
     JsonRedirectStreambuf streambuf;
     std::ostream stream;
@@ -302,19 +531,24 @@ struct JsonSerializer::JsonOStream {
 std::ostream& JsonSerializer::openStringStream() {
     prepareWriteVal();
     m_out.rdbuf()->sputc('"');
+    countWritten(1);
 
     if (!m_stringStream) {
         m_stringStream = std::make_unique<std::optional<JsonOStream>>();
     }
     HUSE_ASSERT_INTERNAL(!*m_stringStream);
-    m_stringStream->emplace(m_out);
+    m_stringStream->emplace(m_out, m_strictUtf8);
     return (*m_stringStream)->stream;
 }
 
 void JsonSerializer::closeStringStream() {
     assert(!!m_stringStream && !!*m_stringStream);
+#if HUSE_INSTRUMENTATION
+    countWritten((*m_stringStream)->streambuf.m_written);
+#endif
     m_stringStream->reset();
     m_out.rdbuf()->sputc('"');
+    countWritten(1);
 }
 
 }
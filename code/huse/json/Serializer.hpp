@@ -4,14 +4,22 @@
 #pragma once
 #include "../API.h"
 #include "../Serializer.hpp"
+#include "RawJson.hpp"
 #include <iosfwd>
 #include <memory>
 
 namespace huse::json {
 
+class SegmentedOutput;
+namespace impl { class CanonicalStreambuf; }
+
 class HUSE_API JsonSerializer : virtual public Serializer {
 public:
     JsonSerializer(std::ostream& out, bool pretty = false);
+
+    // large strings which need no escaping are referenced by the output instead of copied
+    // see SegmentedOutput.hpp
+    JsonSerializer(SegmentedOutput& out, bool pretty = false);
     ~JsonSerializer();
 
     virtual void writeValue(bool val) final override;
@@ -41,28 +49,55 @@ public:
     virtual void closeArray() final override;
 
     // special writers
-    struct RawJson {
-        std::string_view str;
-    };
-    void writeValue(RawJson json) { writeRawJson(json.str); }
+    using RawJson = json::RawJson;
+    void writeValue(RawJson json) {
+        if (!writeReference(json.str, false)) writeRawJson(json.str);
+    }
+
+    // json written by a pretty serializer (at the root), indented for the current depth
+    // if this serializer is pretty (as the new lines of pretty json are all indentation)
+    void writePrettyRawJson(std::string_view json);
+
+    bool pretty() const { return m_pretty; }
+
+    // whether this is a CanonicalJsonSerializer
+    bool canonical() const { return m_canonical; }
 
     std::ostream& out() { return m_out; }
 
+    // validate strings (and keys) as strict UTF-8 (RFC 3629) while writing them
+    // invalid ones throw SerializerException(ErrorCode::InvalidUtf8)
+    // (the output is incomplete then)
+    // string streams throw it on write, but as they are closed by destructors, a sequence
+    // which is incomplete when the stream is closed is not reported
+    void setStrictUtf8(bool strict) { m_strictUtf8 = strict; }
+    bool strictUtf8() const { return m_strictUtf8; }
+
+protected:
+    // canonical output (see CanonicalSerializer.hpp)
+    // out must write to canonical
+    JsonSerializer(std::ostream& out, impl::CanonicalStreambuf& canonical);
+
 private:
     void newLine();
     void prepareWriteVal();
     void open(char o);
     void close(char c);
 
+    void countWritten(size_t n);
     void writeRawJson(std::string_view json);
+    bool writeReference(std::string_view str, bool quoted);
     template <typename T> void writeSmallInteger(T n);
     template <typename T> void writePotentiallyBigIntegerValue(T val);
     template <typename T> void writeFloatValue(T val);
 
     std::ostream& m_out;
+    SegmentedOutput* const m_segmented = nullptr;
+    impl::CanonicalStreambuf* const m_canonical = nullptr;
     std::optional<std::string_view> m_pendingKey;
     bool m_hasValue = false; // used to check whether a coma is needed
     const bool m_pretty;
+    bool m_strictUtf8 = false;
     uint32_t m_depth = 0; // used to indent if pretty
 
     struct JsonOStream;
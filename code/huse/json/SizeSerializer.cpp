@@ -0,0 +1,15 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include "SizeSerializer.hpp"
+
+namespace huse::json {
+
+JsonSizeSerializer::JsonSizeSerializer(bool pretty)
+    : JsonSerializer(stream, pretty)
+{}
+
+// export vtable
+JsonSizeSerializer::~JsonSizeSerializer() = default;
+
+} // namespace huse::json
@@ -0,0 +1,113 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "../API.h"
+#include "Serializer.hpp"
+#include "../SerializerNode.hpp"
+#include "../impl/Assert.hpp"
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <cstddef>
+
+// exact length of json output, to preallocate buffers:
+//
+//      auto size = json::serializedSize([&](auto& n) { n.val(data); });
+//
+// or to measure and then write into a buffer of the exact size:
+//
+//      std::string str = json::serializeExact([&](auto& n) { n.val(data); });
+
+namespace huse::json {
+
+namespace impl {
+// discards the output and only counts it
+// single characters go to a scratch buffer (which is counted when full), so that
+// writing them doesn't involve virtual calls
+class CountingStreambuf : public std::streambuf {
+public:
+    CountingStreambuf() {
+        setp(m_scratch, m_scratch + sizeof(m_scratch));
+    }
+
+    size_t count() const { return m_count + size_t(pptr() - pbase()); }
+
+protected:
+    virtual int_type overflow(int_type ch) override {
+        m_count += size_t(pptr() - pbase());
+        setp(m_scratch, m_scratch + sizeof(m_scratch));
+        if (traits_type::eq_int_type(ch, traits_type::eof())) return traits_type::not_eof(ch);
+        ++m_count;
+        return ch;
+    }
+
+    virtual std::streamsize xsputn(const char_type*, std::streamsize n) override {
+        m_count += size_t(n);
+        return n;
+    }
+
+private:
+    size_t m_count = 0;
+    char m_scratch[64];
+};
+
+// writes to a buffer which must be big enough
+class FixedBufferStreambuf : public std::streambuf {
+public:
+    FixedBufferStreambuf(char* buf, size_t size) {
+        setp(buf, buf + size);
+    }
+
+    size_t written() const { return size_t(pptr() - pbase()); }
+};
+
+// initialized before the serializer which uses it
+struct CountingStream {
+    CountingStreambuf buf;
+    std::ostream stream{&buf};
+};
+} // namespace impl
+
+// serializer which computes the exact length of the output of a JsonSerializer with
+// the same options, including escapes and pretty whitespace, without writing anything
+// as it is a JsonSerializer, it can measure all types which can be serialized as json
+// like JsonSerializer, it allocates only when string streams are opened
+class HUSE_API JsonSizeSerializer : private impl::CountingStream, public JsonSerializer {
+public:
+    explicit JsonSizeSerializer(bool pretty = false);
+    ~JsonSizeSerializer();
+
+    // length of the output so far
+    size_t size() const { return buf.count(); }
+};
+
+// length of the json which f writes to the node which it gets (a SerializerNode<JsonSerializer>)
+template <typename F>
+size_t serializedSize(F&& f, bool pretty = false) {
+    JsonSizeSerializer s(pretty);
+    {
+        SerializerNode<JsonSerializer> node(s);
+        f(node);
+    }
+    return s.size();
+}
+
+// json which f writes to the node which it gets (a SerializerNode<JsonSerializer>)
+// it's measured first and then written to a string of the exact size, so nothing is reallocated
+// f is called twice and must write the same thing both times
+template <typename F>
+std::string serializeExact(F&& f, bool pretty = false) {
+    std::string ret(serializedSize(f, pretty), '\0');
+    impl::FixedBufferStreambuf buf(ret.data(), ret.size());
+    std::ostream out(&buf);
+    {
+        JsonSerializer s(out, pretty);
+        SerializerNode<JsonSerializer> node(s);
+        f(node);
+    }
+    HUSE_ASSERT_USAGE(buf.written() == ret.size(), "the two passes wrote different json");
+    return ret;
+}
+
+} // namespace huse::json
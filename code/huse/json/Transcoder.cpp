@@ -0,0 +1,97 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include "Transcoder.hpp"
+#include "Serializer.hpp"
+#include "impl/Scanner.hpp"
+
+#include "../Exception.hpp"
+
+#include <string>
+
+namespace huse::json {
+
+namespace {
+
+template <bool RawStrings, bool RawNumbers>
+struct TranscodeEvents {
+    static constexpr bool Decode_Values = true;
+
+    Serializer& s;
+    JsonSerializer* json; // only used for raw values
+
+    impl::StructureStack open;
+
+    // the serializer may keep the view of the key until the value is written
+    // and the view of the scanner may not live as long
+    std::string keyBuf;
+
+    void openObject() { s.openObject(); open.push(true); }
+    void closeObject() { s.closeObject(); open.pop(); }
+    void openArray() { s.openArray(); open.push(false); }
+    void closeArray() { s.closeArray(); open.pop(); }
+
+    void key(std::string_view k) {
+        keyBuf.assign(k);
+        s.pushKey(keyBuf);
+    }
+
+    void stringValue(std::string_view str) { s.writeValue(str); }
+    void integerValue(int64_t i) { s.writeValue((long long)i); }
+    void floatValue(double d) { s.writeValue(d); }
+    void boolValue(bool b) { s.writeValue(b); }
+    void nullValue() { s.writeValue(nullptr); }
+
+    void rawStringValue(std::string_view str) requires RawStrings { json->writeValue(RawJson{str}); }
+    void rawNumberValue(std::string_view str) requires RawNumbers { json->writeValue(RawJson{str}); }
+
+    void closeAll() {
+        s.writeValue(std::nullopt); // pending key (if any)
+        while (!open.empty()) {
+            if (open.topIsObject()) s.closeObject();
+            else s.closeArray();
+            open.pop();
+        }
+    }
+};
+
+template <bool RawStrings, bool RawNumbers>
+void run(std::string_view str, Serializer& s, JsonSerializer* json) {
+    using Events = TranscodeEvents<RawStrings, RawNumbers>;
+    Events events = {s, json, {}, {}};
+    impl::Scanner<Events> scanner(str, events);
+    ValidationResult res;
+    try {
+        res = scanner.run();
+    }
+    catch (...) {
+        // thrown by the serializer
+        events.closeAll();
+        throw;
+    }
+    if (res) return;
+
+    events.closeAll();
+    DeserializerException ex(ErrorCode::Parse, res.message());
+    ex.setInputOffset(res.offset);
+    throw ex;
+}
+
+} // namespace
+
+void transcode(std::string_view str, Serializer& s) {
+    auto json = dynamic_cast<JsonSerializer*>(&s);
+    if (!json || json->canonical()) {
+        // canonical output needs the decoded values too
+        run<false, false>(str, s, nullptr);
+    }
+    else if (json->strictUtf8()) {
+        // strings are decoded, so that they are validated like the ones written as values
+        run<false, true>(str, s, json);
+    }
+    else {
+        run<true, true>(str, s, json);
+    }
+}
+
+} // namespace huse::json
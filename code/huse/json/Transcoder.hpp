@@ -0,0 +1,29 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "../API.h"
+#include <string_view>
+
+namespace huse {
+class Serializer;
+}
+
+namespace huse::json {
+
+// write the json document in str to s token by token, without building an AST or
+// materializing values (re-format json, or convert it to another backend)
+//
+// when s is a JsonSerializer (whose formatting is used), string and number values are
+// copied byte for byte from str instead of being decoded and encoded again
+// thus they are written exactly as they are in the input, and numbers which don't fit
+// the limits of serializers (see Limits.hpp) are allowed
+// (strings are decoded if the serializer validates strict UTF-8, so they are validated,
+// and all values are decoded for a CanonicalJsonSerializer, so they are canonicalized)
+//
+// throws DeserializerException(ErrorCode::Parse) with the input offset if str is invalid
+// the open structures are closed in this case (and if s throws), so s remains usable,
+// but its output is only a prefix of the document
+HUSE_API void transcode(std::string_view str, Serializer& s);
+
+} // namespace huse::json
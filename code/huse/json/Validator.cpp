@@ -0,0 +1,32 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include "Validator.hpp"
+#include "impl/Scanner.hpp"
+#include <new>
+
+namespace huse::json {
+
+namespace {
+// validation doesn't need the values
+struct NoEvents {
+    static constexpr bool Decode_Values = false;
+    void openObject() {}
+    void closeObject() {}
+    void openArray() {}
+    void closeArray() {}
+};
+} // namespace
+
+ValidationResult validate(std::string_view str) noexcept {
+    try {
+        NoEvents events;
+        impl::Scanner<NoEvents> scanner(str, events);
+        return scanner.run();
+    }
+    catch (std::bad_alloc&) {
+        return {sajson::ERROR_OUT_OF_MEMORY, 0};
+    }
+}
+
+} // namespace huse::json
@@ -0,0 +1,26 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "../API.h"
+#include "_sajson/sajson.hpp"
+#include <string_view>
+#include <cstddef>
+
+namespace huse::json {
+
+struct ValidationResult {
+    sajson::error code = sajson::ERROR_NO_ERROR;
+    size_t offset = 0; // byte offset of the error in the input
+
+    explicit operator bool() const noexcept { return code == sajson::ERROR_NO_ERROR; }
+    const char* message() const noexcept { return sajson::internal::get_error_text(code); }
+};
+
+// check whether str is a json document which Parser would accept
+// the input is not modified, no AST is produced, and the memory used is
+// proportional to the nesting depth only
+// on error the code and offset are the same as the ones Parser would report
+HUSE_API ValidationResult validate(std::string_view str) noexcept;
+
+} // namespace huse::json
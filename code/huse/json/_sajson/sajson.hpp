@@ -24,6 +24,7 @@
 
 #pragma once
 #include "../../ImValue.hpp"
+#include "../../impl/Utf8.hpp"
 
 #include <algorithm>
 #include <assert.h>
@@ -35,6 +36,7 @@
 #include <cstdint>
 #include <cstring>
 #include <charconv>
+#include <vector>
 
 #ifndef SAJSON_NO_STD_STRING
 #include <string> // for convenient access to error messages and string values.
@@ -72,10 +74,10 @@ namespace huse::json::sajson {
 
 namespace internal {
 
-constexpr inline size_t make_element(tag t, size_t value) {
+constexpr inline ast_word make_element(tag t, size_t value) {
     // assert((value & ~VALUE_MASK) == 0);
     // value &= VALUE_MASK;
-    return static_cast<size_t>(t) | (value << TAG_BITS);
+    return static_cast<ast_word>(static_cast<size_t>(t) | (value << TAG_BITS));
 }
 
 // This template utilizes the One Definition Rule to create global arrays in a
@@ -119,6 +121,53 @@ constexpr inline bool is_whitespace(char c) {
     return (globals::parse_flags[static_cast<unsigned char>(c)] & 2) != 0;
 }
 
+// match the grammar of a number at p, moving p to where the match stops (huse addition)
+// integer is set if there's no fraction and no exponent
+// used for both converted and lazy numbers (and by the validator), so they accept the same input
+template <typename Char>
+bool match_number(Char*& p, const char* end, bool& integer) {
+    // false if there are no digits
+    auto digits = [end](Char*& q) {
+        Char* const first = q;
+        while (q != end && static_cast<unsigned char>(*q - '0') < 10) {
+            ++q;
+        }
+        return q != first;
+    };
+
+    if (*p == '-') {
+        ++p;
+    }
+    if (p != end && *p == '0') {
+        // no leading zeros
+        ++p;
+        if (p != end && static_cast<unsigned char>(*p - '0') < 10) {
+            return false;
+        }
+    } else if (!digits(p)) {
+        return false;
+    }
+    integer = true;
+    if (p != end && *p == '.') {
+        ++p;
+        integer = false;
+        if (!digits(p)) {
+            return false;
+        }
+    }
+    if (p != end && (*p | 0x20) == 'e') {
+        ++p;
+        integer = false;
+        if (p != end && (*p == '+' || *p == '-')) {
+            ++p;
+        }
+        if (!digits(p)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 class allocated_buffer {
 public:
     allocated_buffer()
@@ -233,6 +282,15 @@ public:
         memcpy(data, s.data(), length_);
     }
 
+    /// Allocates an uninitialized buffer of the given length, to be filled
+    /// through get_data() before parsing (huse addition).  Throws
+    /// std::bad_alloc if allocation fails.
+    explicit mutable_string_view(size_t length)
+        : length_(length)
+        , buffer(length) {
+        data = buffer.get_data();
+    }
+
     /// Copies a mutable_string_view.  If any backing memory has been
     /// allocated, its refcount is incremented - both views can safely
     /// use the memory.
@@ -274,6 +332,13 @@ public:
 
     char* get_data() const { return data; }
 
+    /// Shortens the view to the given length, which must not be bigger than
+    /// the current one (huse addition).  The memory is not reallocated.
+    void truncate(size_t length) {
+        assert(length <= length_);
+        length_ = length;
+    }
+
 private:
     size_t length_;
     char* data;
@@ -306,6 +371,7 @@ enum error {
     ERROR_UNKNOWN_ESCAPE,
     ERROR_INVALID_UTF8,
     ERROR_UNINITIALIZED,
+    ERROR_DOCUMENT_TOO_LARGE, // huse addition
 };
 
 namespace internal {
@@ -315,7 +381,7 @@ public:
     ownership(const ownership&) = delete;
     void operator=(const ownership&) = delete;
 
-    explicit ownership(size_t* p_)
+    explicit ownership(ast_word* p_)
         : p(p_) {}
 
     ownership(ownership&& p_)
@@ -328,7 +394,7 @@ public:
     bool is_valid() const { return !!p; }
 
 private:
-    size_t* p;
+    ast_word* p;
 };
 
 inline const char* get_error_text(error error_code) {
@@ -381,12 +447,72 @@ inline const char* get_error_text(error error_code) {
         return "invalid UTF-8";
     case ERROR_UNINITIALIZED:
         return "uninitialized document";
+    case ERROR_DOCUMENT_TOO_LARGE:
+        return "document too large";
     }
 
     SAJSON_UNREACHABLE();
 }
 } // namespace internal
 
+class source_map;
+class projection;
+class structure_ends;
+
+/// Options of a parse (huse addition, see \ref parse).
+struct parse_options {
+    /// Only parse the root structure.  Nested non-empty arrays and objects
+    /// are only bracket-matched and are represented by values for which
+    /// value::is_lazy() is true.
+    bool lazy = false;
+
+    /// If not null, the source spans of the values are recorded in it.  It
+    /// must outlive the parse and must be empty.
+    source_map* spans = nullptr;
+
+    /// If not null, only the values on its paths are parsed (see
+    /// \ref projection).  With lazy, only the structures which are parsed
+    /// whole can be lazy.
+    const projection* proj = nullptr;
+
+    /// Numbers are only validated, and are represented by values for which
+    /// value::is_raw_number() is true.
+    bool lazy_numbers = false;
+
+    /// Strings which contain escapes are only bracket-matched (and their
+    /// escapes are not validated), and are represented by values for which
+    /// value::is_raw_string() is true.
+    bool lazy_strings = false;
+
+    /// Strings are validated as strict UTF-8 (RFC 3629), rejecting overlong
+    /// forms, surrogates, and code points above U+10FFFF, which are otherwise
+    /// accepted.  Values which are skipped by the parse are validated only if
+    /// they are parsed later.
+    bool strict_utf8 = false;
+
+    /// If not null, the ends of the structures which are bracket-matched
+    /// (and of the ones nested in them) are recorded in it.  It must outlive
+    /// the parse and must be empty.
+    structure_ends* record_ends = nullptr;
+
+    /// If not null, the structures which are bracket-matched are skipped to
+    /// their ends in it, if they're there, instead of being scanned.  It must
+    /// be recorded by a parse of the same memory, as they're looked up by
+    /// address (see \ref structure_ends).
+    const structure_ends* known_ends = nullptr;
+};
+
+namespace internal {
+// the number of AST words which is enough for an input (huse addition)
+// a word per byte of input is enough, except with raw numbers which take two
+// words, even if they are a single digit (with a separator)
+// when it reaches VALUE_MASK, the offsets in the AST may not fit in the bits
+// of the words which are not used for tags and they're checked while parsing
+inline size_t ast_size(size_t input_length, const parse_options& options) {
+    return options.lazy_numbers ? input_length + input_length / 2 + 1 : input_length;
+}
+} // namespace internal
+
 /**
  * Represents the result of a JSON parse: either is_valid() and the document
  * contains a root value or parse error information is available.
@@ -399,7 +525,7 @@ inline const char* get_error_text(error error_code) {
 class document {
 public:
     document()
-        : document{ mutable_string_view{}, 0, 0, ERROR_UNINITIALIZED, 0 } {}
+        : document{ mutable_string_view{}, 0, 0, 0, ERROR_UNINITIALIZED, 0 } {}
 
     document(document&& rhs)
         : input(rhs.input)
@@ -408,6 +534,7 @@ public:
         , root(rhs.root)
         , error_line(rhs.error_line)
         , error_column(rhs.error_column)
+        , error_offset(rhs.error_offset)
         , error_code(rhs.error_code)
         , error_arg(rhs.error_arg) {
         // Yikes... but strcpy is okay here because formatted_error is
@@ -437,6 +564,10 @@ public:
     /// failed.
     size_t get_error_column() const { return error_column; }
 
+    /// If not is_valid(), returns the zero-based byte offset in the input
+    /// where the parse failed.
+    size_t get_error_offset() const { return error_offset; }
+
 #ifndef SAJSON_NO_STD_STRING
     /// If not is_valid(), returns a std::string indicating why the parse
     /// failed.
@@ -470,12 +601,33 @@ public:
 
     // WARNING: Internal function exposed only for high-performance language
     // bindings.
-    const size_t* _internal_get_root() const { return root; }
+    const ast_word* _internal_get_root() const { return root; }
 
     // WARNING: Internal function exposed only for high-performance language
     // bindings.
     const mutable_string_view& _internal_get_input() const { return input; }
 
+    // WARNING: Internal function which is subject to change
+    // A valid document which doesn't own its AST (for example a memory-mapped
+    // one). The AST and the input must outlive it.
+    static document _internal_make_view(
+        const mutable_string_view& input_,
+        internal::tag root_tag_,
+        const ast_word* root_) {
+        return document(input_, internal::ownership(nullptr), root_tag_, root_);
+    }
+
+    // WARNING: Internal function which is subject to change
+    // A valid document from an AST which wasn't produced by the parser.
+    // The AST must have been allocated with new[].
+    static document _internal_make_document(
+        const mutable_string_view& input_,
+        internal::ownership&& structure_,
+        internal::tag root_tag_,
+        const ast_word* root_) {
+        return document(input_, std::move(structure_), root_tag_, root_);
+    }
+
     /// \endcond
 
 private:
@@ -488,13 +640,14 @@ private:
         const mutable_string_view& input_,
         internal::ownership&& structure_,
         tag root_tag_,
-        const size_t* root_)
+        const ast_word* root_)
         : input(input_)
         , structure(std::move(structure_))
         , root_tag(root_tag_)
         , root(root_)
         , error_line(0)
         , error_column(0)
+        , error_offset(0)
         , error_code(ERROR_NO_ERROR)
         , error_arg(0) {
         formatted_error_message[0] = 0;
@@ -504,6 +657,7 @@ private:
         const mutable_string_view& input_,
         size_t error_line_,
         size_t error_column_,
+        size_t error_offset_,
         const error error_code_,
         int error_arg_)
         : input(input_)
@@ -512,6 +666,7 @@ private:
         , root(0)
         , error_line(error_line_)
         , error_column(error_column_)
+        , error_offset(error_offset_)
         , error_code(error_code_)
         , error_arg(error_arg_) {
         formatted_error_message[ERROR_BUFFER_LENGTH - 1] = 0;
@@ -538,9 +693,10 @@ private:
     mutable_string_view input;
     internal::ownership structure;
     const tag root_tag;
-    const size_t* const root;
+    const ast_word* const root;
     const size_t error_line;
     const size_t error_column;
+    const size_t error_offset;
     const error error_code;
     const int error_arg;
 
@@ -549,7 +705,7 @@ private:
 
     template <typename AllocationStrategy, typename StringType>
     friend document
-    parse(const AllocationStrategy& strategy, const StringType& string);
+    parse(const AllocationStrategy& strategy, const StringType& string, const parse_options& options);
     template <typename Allocator>
     friend class parser;
 };
@@ -567,13 +723,13 @@ public:
             : stack_bottom(other.stack_bottom)
             , stack_top(other.stack_top) {}
 
-        bool push(size_t element) {
+        bool push(ast_word element) {
             *stack_top++ = element;
             return true;
         }
 
-        size_t* reserve(size_t amount, bool* success) {
-            size_t* rv = stack_top;
+        ast_word* reserve(size_t amount, bool* success) {
+            ast_word* rv = stack_top;
             stack_top += amount;
             *success = true;
             return rv;
@@ -590,9 +746,9 @@ public:
 
         size_t get_size() { return stack_top - stack_bottom; }
 
-        size_t* get_top() { return stack_top; }
+        ast_word* get_top() { return stack_top; }
 
-        size_t* get_pointer_from_offset(size_t offset) {
+        ast_word* get_pointer_from_offset(size_t offset) {
             return stack_bottom + offset;
         }
 
@@ -601,12 +757,12 @@ public:
         stack_head(const stack_head&) = delete;
         void operator=(const stack_head&) = delete;
 
-        explicit stack_head(size_t* base)
+        explicit stack_head(ast_word* base)
             : stack_bottom(base)
             , stack_top(base) {}
 
-        size_t* const stack_bottom;
-        size_t* stack_top;
+        ast_word* const stack_bottom;
+        ast_word* stack_top;
 
         friend class single_allocation;
     };
@@ -618,7 +774,7 @@ public:
         void operator=(const allocator&) = delete;
 
         explicit allocator(
-            size_t* buffer, size_t input_size, bool should_deallocate_)
+            ast_word* buffer, size_t input_size, bool should_deallocate_)
             : structure(buffer)
             , structure_end(buffer ? buffer + input_size : 0)
             , write_cursor(structure_end)
@@ -654,15 +810,15 @@ public:
 
         size_t get_write_offset() { return structure_end - write_cursor; }
 
-        size_t* get_write_pointer_of(size_t v) { return structure_end - v; }
+        ast_word* get_write_pointer_of(size_t v) { return structure_end - v; }
 
-        size_t* reserve(size_t size, bool* success) {
+        ast_word* reserve(size_t size, bool* success) {
             *success = true;
             write_cursor -= size;
             return write_cursor;
         }
 
-        size_t* get_ast_root() { return write_cursor; }
+        ast_word* get_ast_root() { return write_cursor; }
 
         internal::ownership transfer_ownership() {
             auto p = structure;
@@ -677,9 +833,9 @@ public:
         }
 
     private:
-        size_t* structure;
-        size_t* structure_end;
-        size_t* write_cursor;
+        ast_word* structure;
+        ast_word* structure_end;
+        ast_word* write_cursor;
         bool should_deallocate;
     };
 
@@ -696,15 +852,15 @@ public:
     /// memory error if the buffer is not guaranteed to be big enough for
     /// the document.  The caller must guarantee the memory is valid for
     /// the duration of the parse and the AST traversal.
-    single_allocation(size_t* existing_buffer_, size_t size_in_words)
+    single_allocation(ast_word* existing_buffer_, size_t size_in_words)
         : has_existing_buffer(true)
         , existing_buffer(existing_buffer_)
         , existing_buffer_size(size_in_words) {}
 
-    /// Convenience wrapper for single_allocation(size_t*, size_t) that
+    /// Convenience wrapper for single_allocation(ast_word*, size_t) that
     /// automatically infers the length of a given array.
     template <size_t N>
-    explicit single_allocation(size_t (&existing_buffer_)[N])
+    explicit single_allocation(ast_word (&existing_buffer_)[N])
         : single_allocation(existing_buffer_, N) {}
 
     /// \cond INTERNAL
@@ -720,8 +876,8 @@ public:
             return allocator(
                 existing_buffer, input_document_size_in_bytes, false);
         } else {
-            size_t* buffer
-                = new (std::nothrow) size_t[input_document_size_in_bytes];
+            ast_word* buffer
+                = new (std::nothrow) ast_word[input_document_size_in_bytes];
             if (!buffer) {
                 *succeeded = false;
                 return allocator(nullptr);
@@ -735,7 +891,7 @@ public:
 
 private:
     bool has_existing_buffer;
-    size_t* existing_buffer;
+    ast_word* existing_buffer;
     size_t existing_buffer_size;
 };
 
@@ -759,7 +915,7 @@ public:
 
         ~stack_head() { delete[] stack_bottom; }
 
-        bool push(size_t element) {
+        bool push(ast_word element) {
             if (can_grow(1)) {
                 *stack_top++ = element;
                 return true;
@@ -768,9 +924,9 @@ public:
             }
         }
 
-        size_t* reserve(size_t amount, bool* success) {
+        ast_word* reserve(size_t amount, bool* success) {
             if (can_grow(amount)) {
-                size_t* rv = stack_top;
+                ast_word* rv = stack_top;
                 stack_top += amount;
                 *success = true;
                 return rv;
@@ -784,9 +940,9 @@ public:
 
         size_t get_size() { return stack_top - stack_bottom; }
 
-        size_t* get_top() { return stack_top; }
+        ast_word* get_top() { return stack_top; }
 
-        size_t* get_pointer_from_offset(size_t offset) {
+        ast_word* get_pointer_from_offset(size_t offset) {
             return stack_bottom + offset;
         }
 
@@ -796,7 +952,7 @@ public:
 
         explicit stack_head(size_t initial_capacity, bool* success) {
             assert(initial_capacity);
-            stack_bottom = new (std::nothrow) size_t[initial_capacity];
+            stack_bottom = new (std::nothrow) ast_word[initial_capacity];
             stack_top = stack_bottom;
             if (stack_bottom) {
                 stack_limit = stack_bottom + initial_capacity;
@@ -818,7 +974,7 @@ public:
             while (new_capacity < amount + current_size) {
                 new_capacity *= 2;
             }
-            size_t* new_stack = new (std::nothrow) size_t[new_capacity];
+            ast_word* new_stack = new (std::nothrow) ast_word[new_capacity];
             if (!new_stack) {
                 stack_top = 0;
                 stack_bottom = 0;
@@ -826,7 +982,7 @@ public:
                 return false;
             }
 
-            memcpy(new_stack, stack_bottom, current_size * sizeof(size_t));
+            memcpy(new_stack, stack_bottom, current_size * sizeof(ast_word));
             delete[] stack_bottom;
             stack_top = new_stack + current_size;
             stack_bottom = new_stack;
@@ -834,9 +990,9 @@ public:
             return true;
         }
 
-        size_t* stack_top; // stack grows up: stack_top >= stack_bottom
-        size_t* stack_bottom;
-        size_t* stack_limit;
+        ast_word* stack_top; // stack grows up: stack_top >= stack_bottom
+        ast_word* stack_bottom;
+        ast_word* stack_limit;
 
         friend class dynamic_allocation;
     };
@@ -848,7 +1004,7 @@ public:
         void operator=(const allocator&) = delete;
 
         explicit allocator(
-            size_t* buffer_,
+            ast_word* buffer_,
             size_t current_capacity,
             size_t initial_stack_capacity_)
             : ast_buffer_bottom(buffer_)
@@ -880,9 +1036,9 @@ public:
 
         size_t get_write_offset() { return ast_buffer_top - ast_write_head; }
 
-        size_t* get_write_pointer_of(size_t v) { return ast_buffer_top - v; }
+        ast_word* get_write_pointer_of(size_t v) { return ast_buffer_top - v; }
 
-        size_t* reserve(size_t size, bool* success) {
+        ast_word* reserve(size_t size, bool* success) {
             if (can_grow(size)) {
                 ast_write_head -= size;
                 *success = true;
@@ -893,7 +1049,7 @@ public:
             }
         }
 
-        size_t* get_ast_root() { return ast_write_head; }
+        ast_word* get_ast_root() { return ast_write_head; }
 
         internal::ownership transfer_ownership() {
             auto p = ast_buffer_bottom;
@@ -918,8 +1074,8 @@ public:
                 new_capacity *= 2;
             }
 
-            size_t* old_buffer = ast_buffer_bottom;
-            size_t* new_buffer = new (std::nothrow) size_t[new_capacity];
+            ast_word* old_buffer = ast_buffer_bottom;
+            ast_word* new_buffer = new (std::nothrow) ast_word[new_capacity];
             if (!new_buffer) {
                 ast_buffer_bottom = 0;
                 ast_buffer_top = 0;
@@ -927,21 +1083,21 @@ public:
                 return false;
             }
 
-            size_t* old_write_head = ast_write_head;
+            ast_word* old_write_head = ast_write_head;
             ast_buffer_bottom = new_buffer;
             ast_buffer_top = new_buffer + new_capacity;
             ast_write_head = ast_buffer_top - current_size;
             memcpy(
-                ast_write_head, old_write_head, current_size * sizeof(size_t));
+                ast_write_head, old_write_head, current_size * sizeof(ast_word));
             delete[] old_buffer;
 
             return true;
         }
 
-        size_t*
+        ast_word*
             ast_buffer_bottom; // base address of the ast buffer - it grows down
-        size_t* ast_buffer_top;
-        size_t* ast_write_head;
+        ast_word* ast_buffer_top;
+        ast_word* ast_write_head;
         size_t initial_stack_capacity;
     };
 
@@ -964,7 +1120,7 @@ public:
             capacity = 1024;
         }
 
-        size_t* buffer = new (std::nothrow) size_t[capacity];
+        ast_word* buffer = new (std::nothrow) ast_word[capacity];
         if (!buffer) {
             *succeeded = false;
             return allocator(nullptr);
@@ -1003,7 +1159,7 @@ public:
             other.source_allocator = 0;
         }
 
-        bool push(size_t element) {
+        bool push(ast_word element) {
             if (SAJSON_LIKELY(source_allocator->can_grow(1))) {
                 *(source_allocator->stack_top)++ = element;
                 return true;
@@ -1012,9 +1168,9 @@ public:
             }
         }
 
-        size_t* reserve(size_t amount, bool* success) {
+        ast_word* reserve(size_t amount, bool* success) {
             if (SAJSON_LIKELY(source_allocator->can_grow(amount))) {
-                size_t* rv = source_allocator->stack_top;
+                ast_word* rv = source_allocator->stack_top;
                 source_allocator->stack_top += amount;
                 *success = true;
                 return rv;
@@ -1032,9 +1188,9 @@ public:
             return source_allocator->stack_top - source_allocator->structure;
         }
 
-        size_t* get_top() { return source_allocator->stack_top; }
+        ast_word* get_top() { return source_allocator->stack_top; }
 
-        size_t* get_pointer_from_offset(size_t offset) {
+        ast_word* get_pointer_from_offset(size_t offset) {
             return source_allocator->structure + offset;
         }
 
@@ -1056,7 +1212,7 @@ public:
         allocator(const allocator&) = delete;
         void operator=(const allocator&) = delete;
 
-        explicit allocator(size_t* existing_buffer, size_t existing_buffer_size)
+        explicit allocator(ast_word* existing_buffer, size_t existing_buffer_size)
             : structure(existing_buffer)
             , structure_end(existing_buffer + existing_buffer_size)
             , write_cursor(structure_end)
@@ -1080,9 +1236,9 @@ public:
 
         size_t get_write_offset() { return structure_end - write_cursor; }
 
-        size_t* get_write_pointer_of(size_t v) { return structure_end - v; }
+        ast_word* get_write_pointer_of(size_t v) { return structure_end - v; }
 
-        size_t* reserve(size_t size, bool* success) {
+        ast_word* reserve(size_t size, bool* success) {
             if (can_grow(size)) {
                 write_cursor -= size;
                 *success = true;
@@ -1093,7 +1249,7 @@ public:
             }
         }
 
-        size_t* get_ast_root() { return write_cursor; }
+        ast_word* get_ast_root() { return write_cursor; }
 
         internal::ownership transfer_ownership() {
             structure = 0;
@@ -1109,10 +1265,10 @@ public:
             return static_cast<size_t>(write_cursor - stack_top) >= amount;
         }
 
-        size_t* structure;
-        size_t* structure_end;
-        size_t* write_cursor;
-        size_t* stack_top;
+        ast_word* structure;
+        ast_word* structure_end;
+        ast_word* write_cursor;
+        ast_word* stack_top;
 
         friend class bounded_allocation;
     };
@@ -1122,14 +1278,14 @@ public:
     /// Uses an existing buffer to hold the parsed AST, if it fits.  The
     /// specified buffer must not be deallocated until after the document
     /// is parsed and the AST traversed.
-    bounded_allocation(size_t* existing_buffer_, size_t size_in_words)
+    bounded_allocation(ast_word* existing_buffer_, size_t size_in_words)
         : existing_buffer(existing_buffer_)
         , existing_buffer_size(size_in_words) {}
 
-    /// Convenience wrapper for bounded_allocation(size_t*, size) that
+    /// Convenience wrapper for bounded_allocation(ast_word*, size) that
     /// automatically infers the size of the given array.
     template <size_t N>
-    explicit bounded_allocation(size_t (&existing_buffer_)[N])
+    explicit bounded_allocation(ast_word (&existing_buffer_)[N])
         : bounded_allocation(existing_buffer_, N) {}
 
     /// \cond INTERNAL
@@ -1143,35 +1299,232 @@ public:
     /// \endcond
 
 private:
-    size_t* existing_buffer;
+    ast_word* existing_buffer;
     size_t existing_buffer_size;
 };
 
+/// Byte offsets in the input of a value (huse addition).
+struct source_span {
+    size_t begin; ///< first byte of the value
+    size_t end; ///< one past the last byte of the value
+};
+
+/**
+ * Source spans of the values of a document (huse addition), recorded by
+ * parse() when a source_map is provided.
+ *
+ * The spans are stored separately, sorted by the position of the element
+ * words in the AST, so the AST layout is not affected, and looking a span up
+ * is O(lg N).  The spans of values in lazy structures are not recorded.
+ */
+class source_map {
+public:
+    bool empty() const { return root == nullptr; }
+
+    /// The span of the root value.
+    source_span get_root_span() const { return root_span; }
+
+    /// The span of the element at index (the value, and not the key, for
+    /// objects) of parent, which must be a non-lazy array or object of the
+    /// mapped document.
+    source_span get_element_span(const value& parent, size_t index) const {
+        assert(!empty());
+        const ast_word* payload = parent._internal_get_payload();
+        const ast_word* element = parent.get_type() == TYPE_OBJECT
+            ? payload + 3 + 3 * index // length, then key start, key end, value
+            : payload + 1 + index;
+        const size_t key = root_end_offset - size_t(element - root);
+        auto r = std::lower_bound(
+            records.begin(), records.end(), key,
+            [](const record& rec, size_t k) { return rec.element < k; });
+        assert(r != records.end() && r->element == key);
+        return r->span;
+    }
+
+private:
+    template <typename Allocator>
+    friend class parser;
+
+    struct record {
+        size_t element; ///< distance of the element word from the end of the AST
+        source_span span;
+    };
+    std::vector<record> records;
+
+    const ast_word* root = nullptr;
+    size_t root_end_offset = 0; ///< distance of the root from the end of the AST
+    source_span root_span = {0, 0};
+};
+
+/**
+ * Ends of the structures which were bracket-matched by a parse (huse
+ * addition), recorded by parse() when parse_options::record_ends is set.
+ *
+ * A lazy structure can then be parsed in place, and the structures nested in
+ * it are skipped without being scanned again, so parsing lazy values level
+ * by level scans the input once.  The ends are looked up by the address of
+ * the opening bracket in O(lg N).
+ */
+class structure_ends {
+public:
+    /// One past the closing bracket of the structure whose opening bracket is
+    /// at p, or null if it wasn't recorded.
+    char* find(const char* p) const {
+        auto e = std::lower_bound(
+            ends.begin(), ends.end(), p,
+            [](const entry& en, const char* k) { return en.begin < k; });
+        if (e == ends.end() || e->begin != p) {
+            return nullptr;
+        }
+        return e->end;
+    }
+
+private:
+    template <typename Allocator>
+    friend class parser;
+
+    // structures open in the order of the input, so the entries are sorted
+    struct entry {
+        const char* begin;
+        char* end;
+    };
+    std::vector<entry> ends;
+    std::vector<size_t> open; ///< entries of the open structures while recording
+};
+
+/**
+ * Paths of the values to parse (huse addition): a prefix tree given to
+ * parse().  Values which are not on a path are skipped without being
+ * parsed: object members are left out, and array elements become null (so
+ * that the indices of the other elements are preserved).  A value at the end
+ * of a path is parsed whole.  Wildcard nodes match any key or index, but only
+ * if no other node matches it.
+ */
+class projection {
+public:
+    static constexpr uint32_t none = uint32_t(-1); ///< not on a path
+    static constexpr uint32_t whole = uint32_t(-2); ///< parsed whole
+
+    /// The root node.
+    uint32_t get_root() const { return nodes[0].complete ? whole : 0; }
+
+    /// Add a child of parent for key (an index if it's an array index), or
+    /// for any key or index if any is true, and return it.  Existing
+    /// children are reused.
+    uint32_t add_child(uint32_t parent, const std::string& key, size_t index, bool any) {
+        for (auto c : nodes[parent].children) {
+            auto& n = nodes[c];
+            if (n.any == any && n.key == key) {
+                return c;
+            }
+        }
+        const uint32_t ret = uint32_t(nodes.size());
+        nodes[parent].children.push_back(ret);
+        nodes.push_back({key, index, any, false, {}}); // invalidates references to nodes
+        return ret;
+    }
+
+    /// Mark the value of node as parsed whole (the end of a path).
+    void set_complete(uint32_t node) { nodes[node].complete = true; }
+
+    /// The child of node for an object key.
+    uint32_t match_key(uint32_t node, const char* key, size_t length) const {
+        if (node == whole) {
+            return whole;
+        }
+        uint32_t any = none;
+        for (auto c : nodes[node].children) {
+            auto& n = nodes[c];
+            if (n.any) {
+                any = c;
+            } else if (
+                n.key.length() == length
+                && memcmp(n.key.data(), key, length) == 0) {
+                return n.complete ? whole : c;
+            }
+        }
+        return any == none || !nodes[any].complete ? any : whole;
+    }
+
+    /// The child of node for an array index.
+    uint32_t match_index(uint32_t node, size_t index) const {
+        if (node == whole) {
+            return whole;
+        }
+        uint32_t any = none;
+        for (auto c : nodes[node].children) {
+            auto& n = nodes[c];
+            if (n.any) {
+                any = c;
+            } else if (n.index == index) {
+                return n.complete ? whole : c;
+            }
+        }
+        return any == none || !nodes[any].complete ? any : whole;
+    }
+
+private:
+    struct node {
+        std::string key;
+        size_t index; ///< size_t(-1) if the key is not an array index
+        bool any;
+        bool complete;
+        std::vector<uint32_t> children;
+    };
+    std::vector<node> nodes = {node{{}, size_t(-1), false, false, {}}};
+};
+
 // I thought about putting parser in the internal namespace but I don't
 // want to indent it further...
 /// \cond INTERNAL
 template <typename Allocator>
 class parser {
 public:
-    parser(const mutable_string_view& msv, Allocator&& allocator_)
+    parser(const mutable_string_view& msv, Allocator&& allocator_, const parse_options& options = {})
         : input(msv)
         , input_end(input.get_data() + input.length())
         , allocator(std::move(allocator_))
+        , lazy(options.lazy)
+        , lazy_numbers(options.lazy_numbers)
+        , lazy_strings(options.lazy_strings)
+        , strict_utf8(options.strict_utf8)
+        , check_offsets(internal::ast_size(input.length(), options) >= internal::VALUE_MASK)
+        , record_ends(options.record_ends)
+        , known_ends(options.known_ends)
+        , spans(options.spans)
+        , proj(options.proj)
         , root_tag(internal::tag::null)
         , error_line(0)
-        , error_column(0) {}
+        , error_column(0)
+        , error_offset(0) {}
 
     document get_document() {
         if (parse()) {
-            size_t* ast_root = allocator.get_ast_root();
+            ast_word* ast_root = allocator.get_ast_root();
+            if (spans) {
+                spans->root = ast_root;
+                spans->root_end_offset = allocator.get_write_offset();
+            }
             return document(
                 input, allocator.transfer_ownership(), root_tag, ast_root);
         } else {
             return document(
-                input, error_line, error_column, error_code, error_arg);
+                input, error_line, error_column, error_offset, error_code, error_arg);
         }
     }
 
+    /// Unescapes and validates the input as the contents of a string which
+    /// are followed by the closing quote (huse addition, see
+    /// value::is_raw_string).  Returns the length of the unescaped string, or
+    /// size_t(-1) if it's invalid.  The allocator is not used.
+    size_t unescape_string_contents() {
+        ast_word string_tag[2];
+        if (!parse_string_slow(input.get_data(), string_tag, 0)) {
+            return size_t(-1);
+        }
+        return string_tag[1];
+    }
+
 private:
     struct error_result {
         operator bool() const { return false; }
@@ -1217,6 +1570,7 @@ private:
 
         error_line = 1;
         error_column = 1;
+        error_offset = p - input.get_data();
 
         char* c = input.get_data();
         while (c < p) {
@@ -1264,6 +1618,15 @@ private:
         // current_base is an offset to the first element of the current
         // structure (object or array)
         size_t current_base = stack.get_size();
+        char* value_start = nullptr; // used to record source spans
+        if (spans) {
+            structure_starts.push_back(p - input.get_data());
+        }
+        // projection node of the current value (for structures)
+        uint32_t value_projection = projection::whole;
+        if (proj) {
+            projection_stack.push_back(proj->get_root());
+        }
         tag current_structure_tag;
         if (*p == '[') {
             current_structure_tag = tag::array;
@@ -1287,7 +1650,7 @@ private:
 
         // BEGIN STATE MACHINE
 
-        size_t pop_element; // used as an argument into the `pop` routine
+        ast_word pop_element; // used as an argument into the `pop` routine
 
         if (0) { // purely for structure
 
@@ -1351,7 +1714,7 @@ private:
         // ASSUMES: *p == '}'
         pop_object : {
             ++p;
-            size_t* base_ptr = stack.get_pointer_from_offset(current_base);
+            ast_word* base_ptr = stack.get_pointer_from_offset(current_base);
             pop_element = *base_ptr;
             if (SAJSON_UNLIKELY(
                     !install_object(base_ptr + 1, stack.get_top()))) {
@@ -1363,7 +1726,7 @@ private:
         // ASSUMES: *p == ']'
         pop_array : {
             ++p;
-            size_t* base_ptr = stack.get_pointer_from_offset(current_base);
+            ast_word* base_ptr = stack.get_pointer_from_offset(current_base);
             pop_element = *base_ptr;
             if (SAJSON_UNLIKELY(
                     !install_array(base_ptr + 1, stack.get_top()))) {
@@ -1382,7 +1745,7 @@ private:
                 return make_error(p, ERROR_MISSING_OBJECT_KEY);
             }
             bool success_;
-            size_t* out = stack.reserve(2, &success_);
+            ast_word* out = stack.reserve(2, &success_);
             if (SAJSON_UNLIKELY(!success_)) {
                 return oom(p, "reserve for object key");
             }
@@ -1395,17 +1758,50 @@ private:
                 return make_error(p, ERROR_EXPECTED_COLON);
             }
             ++p;
-            goto next_element;
+            if (proj) {
+                value_projection = proj->match_key(
+                    projection_stack.back(),
+                    input.get_data() + out[0],
+                    out[1] - out[0]);
+                if (value_projection == projection::none) {
+                    // leave the member out
+                    stack.reset(stack.get_size() - 2);
+                    p = skip_value(p);
+                    if (!p) {
+                        return false;
+                    }
+                    goto structure_close_or_comma;
+                }
+            }
+            goto element_value;
         }
 
         // ASSUMES: byte at p SHOULD NOT be skipped
         next_element:
+            if (proj && current_structure_tag == tag::array) {
+                value_projection = proj->match_index(
+                    projection_stack.back(),
+                    stack.get_size() - current_base - 1);
+            }
+        // ASSUMES: byte at p SHOULD NOT be skipped
+        element_value:
             p = skip_whitespace(p);
             if (SAJSON_UNLIKELY(!p)) {
                 return unexpected_end();
             }
+            value_start = p;
 
             tag value_tag_result;
+            if (SAJSON_UNLIKELY(value_projection == projection::none)) {
+                // only array elements get here: keep their indices
+                value_projection = projection::whole;
+                p = skip_value(p);
+                if (!p) {
+                    return false;
+                }
+                value_tag_result = tag::null;
+                goto push_value;
+            }
             switch (*p) {
             case 0:
                 return unexpected_end(p);
@@ -1441,7 +1837,7 @@ private:
             case '8':
             case '9':
             case '-': {
-                auto result = parse_number(p);
+                auto result = lazy_numbers ? scan_number(p) : parse_number(p);
                 p = result.first;
                 if (!p) {
                     return false;
@@ -1450,8 +1846,15 @@ private:
                 break;
             }
             case '"': {
+                if (lazy_strings) {
+                    p = scan_string(p, value_tag_result);
+                    if (!p) {
+                        return false;
+                    }
+                    break;
+                }
                 bool success_;
-                size_t* string_tag = allocator.reserve(2, &success_);
+                ast_word* string_tag = allocator.reserve(2, &success_);
                 if (SAJSON_UNLIKELY(!success_)) {
                     return oom(p, "reserve for string tag");
                 }
@@ -1464,30 +1867,85 @@ private:
             }
 
             case '[': {
+                if (lazy && value_projection == projection::whole && !is_empty_structure(p)) {
+                    goto lazy_structure;
+                }
                 size_t previous_base = current_base;
+                if (SAJSON_UNLIKELY(check_offsets && previous_base >= VALUE_MASK)) {
+                    return make_error(p, ERROR_DOCUMENT_TOO_LARGE);
+                }
                 current_base = stack.get_size();
                 bool s = stack.push(
                     make_element(current_structure_tag, previous_base));
                 if (SAJSON_UNLIKELY(!s)) {
                     return oom(p, "stack.push array");
                 }
+                if (spans) {
+                    structure_starts.push_back(p - input.get_data());
+                }
+                if (proj) {
+                    projection_stack.push_back(value_projection);
+                    value_projection = projection::whole;
+                }
                 current_structure_tag = tag::array;
                 goto array_close_or_element;
             }
             case '{': {
+                if (lazy && value_projection == projection::whole && !is_empty_structure(p)) {
+                    goto lazy_structure;
+                }
                 size_t previous_base = current_base;
+                if (SAJSON_UNLIKELY(check_offsets && previous_base >= VALUE_MASK)) {
+                    return make_error(p, ERROR_DOCUMENT_TOO_LARGE);
+                }
                 current_base = stack.get_size();
                 bool s = stack.push(
                     make_element(current_structure_tag, previous_base));
                 if (SAJSON_UNLIKELY(!s)) {
                     return oom(p, "stack.push object");
                 }
+                if (spans) {
+                    structure_starts.push_back(p - input.get_data());
+                }
+                if (proj) {
+                    projection_stack.push_back(value_projection);
+                    value_projection = projection::whole;
+                }
                 current_structure_tag = tag::object;
                 goto object_close_or_element;
             }
+            lazy_structure : {
+                bool success_;
+                ast_word* lazy_payload = allocator.reserve(3, &success_);
+                if (SAJSON_UNLIKELY(!success_)) {
+                    return oom(p, "reserve for lazy structure");
+                }
+                lazy_payload[0] = p - input.get_data();
+                p = skip_structure(p);
+                if (!p) {
+                    return false;
+                }
+                lazy_payload[1] = p - input.get_data();
+                lazy_payload[2] = 0; // not parsed yet
+                value_tag_result = tag::lazy;
+                break;
+            }
             pop : {
                 size_t parent = get_element_value(pop_element);
+                if (spans) {
+                    value_start = input.get_data() + structure_starts.back();
+                    structure_starts.pop_back();
+                }
+                if (proj) {
+                    projection_stack.pop_back();
+                }
                 if (parent == ROOT_MARKER) {
+                    if (SAJSON_UNLIKELY(check_offsets && allocator.get_write_offset() >= VALUE_MASK)) {
+                        return make_error(p, ERROR_DOCUMENT_TOO_LARGE);
+                    }
+                    if (spans) {
+                        spans->root_span = {size_t(value_start - input.get_data()), size_t(p - input.get_data())};
+                    }
                     root_tag = current_structure_tag;
                     p = skip_whitespace(p);
                     if (SAJSON_UNLIKELY(p)) {
@@ -1507,12 +1965,21 @@ private:
             default:
                 return make_error(p, ERROR_EXPECTED_VALUE);
             }
+            value_projection = projection::whole;
 
+        push_value:
+            if (SAJSON_UNLIKELY(check_offsets && allocator.get_write_offset() >= VALUE_MASK)) {
+                return make_error(p, ERROR_DOCUMENT_TOO_LARGE);
+            }
             bool s = stack.push(
                 make_element(value_tag_result, allocator.get_write_offset()));
             if (SAJSON_UNLIKELY(!s)) {
                 return oom(p, "stack.push value");
             }
+            if (spans) {
+                // parallel to the elements on the stack
+                value_spans.push_back({size_t(value_start - input.get_data()), size_t(p - input.get_data())});
+            }
 
             goto structure_close_or_comma;
         }
@@ -1520,6 +1987,202 @@ private:
         SAJSON_UNREACHABLE();
     }
 
+    // empty structures are never lazy: parsing them is as cheap as skipping
+    // them, and this guarantees that the lazy payload fits in the single
+    // allocation buffer
+    bool is_empty_structure(char* p) {
+        char* q = skip_whitespace(p + 1);
+        return !q || *q == (*p == '[' ? ']' : '}');
+    }
+
+    // bracket-match a structure without parsing it
+    // only strings are tracked (so that brackets in them are ignored)
+    // the contents are validated only when (and if) the structure is parsed
+    char* skip_structure(char* p) {
+        if (known_ends) {
+            if (char* end = known_ends->find(p)) {
+                return end;
+            }
+        }
+        size_t depth = 0;
+        for (;;) {
+            if (SAJSON_UNLIKELY(p == input_end)) {
+                return unexpected_end(p);
+            }
+            switch (*p++) {
+            case '[':
+            case '{':
+                if (record_ends) {
+                    record_ends->open.push_back(record_ends->ends.size());
+                    record_ends->ends.push_back({p - 1, nullptr});
+                }
+                ++depth;
+                break;
+            case ']':
+            case '}':
+                if (record_ends) {
+                    record_ends->ends[record_ends->open.back()].end = p;
+                    record_ends->open.pop_back();
+                }
+                if (--depth == 0) {
+                    return p;
+                }
+                break;
+            case '"':
+                p = skip_string(p);
+                if (!p) {
+                    return p;
+                }
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    // string which is unescaped only when read (huse addition)
+    // strings with no escapes are plain strings, as they need no work, and the
+    // others are only bracket-matched
+    char* scan_string(char* p, internal::tag& value_tag) {
+        using namespace internal;
+
+        ++p; // "
+        const size_t start = p - input.get_data();
+        while (p < input_end && is_plain_string_character(*p)) {
+            ++p;
+        }
+        if (SAJSON_UNLIKELY(p >= input_end)) {
+            return make_error(p, ERROR_UNEXPECTED_END);
+        }
+        if (*p >= 0 && *p < 0x20) {
+            return make_error(p, ERROR_ILLEGAL_CODEPOINT, static_cast<int>(*p));
+        }
+
+        bool success_;
+        if (SAJSON_LIKELY(*p == '"')) {
+            ast_word* string_tag = allocator.reserve(2, &success_);
+            if (SAJSON_UNLIKELY(!success_)) {
+                return oom(p, "reserve for string tag");
+            }
+            string_tag[0] = start;
+            string_tag[1] = p - input.get_data();
+            *p = '\0';
+            value_tag = tag::string;
+            return p + 1;
+        }
+
+        char* non_plain = p;
+        p = skip_string(p);
+        if (!p) {
+            return 0;
+        }
+        char* const end = p - 1; // the closing quote
+
+        // non-ascii characters don't need unescaping, but they are validated here
+        // like parse_string does (unless they're validated as strict UTF-8 below)
+        bool escaped = false;
+        for (char* q = non_plain; q != end; ++q) {
+            const unsigned char c = static_cast<unsigned char>(*q);
+            if (c == '\\') {
+                escaped = true;
+                ++q; // skip_string checked that the escaped character is before end
+            } else if (c < 0x20) {
+                return make_error(q, ERROR_ILLEGAL_CODEPOINT, static_cast<int>(c));
+            } else if (c >= 128 && !strict_utf8) {
+                if (c >= 248) {
+                    return make_error(q, ERROR_INVALID_UTF8);
+                }
+                const int continuations = c < 224 ? 1 : c < 240 ? 2 : 3;
+                for (int i = 0; i < continuations; ++i) {
+                    ++q;
+                    // the closing quote is not a continuation byte
+                    const unsigned char cc = static_cast<unsigned char>(*q);
+                    if (cc < 128 || cc >= 192) {
+                        return make_error(q, ERROR_INVALID_UTF8);
+                    }
+                }
+            }
+        }
+
+        if (strict_utf8) {
+            // validated here, as unescaping doesn't report errors while parsing
+            huse::impl::Utf8State utf8;
+            if (auto invalid = huse::impl::findInvalidUtf8(utf8, non_plain, end)) {
+                return make_error(const_cast<char*>(invalid), ERROR_INVALID_UTF8);
+            }
+            if (!utf8.complete()) {
+                return make_error(end, ERROR_INVALID_UTF8);
+            }
+        }
+
+        if (!escaped) {
+            ast_word* string_tag = allocator.reserve(2, &success_);
+            if (SAJSON_UNLIKELY(!success_)) {
+                return oom(p, "reserve for string tag");
+            }
+            string_tag[0] = start;
+            string_tag[1] = end - input.get_data();
+            *end = '\0';
+            value_tag = tag::string;
+            return p;
+        }
+
+        ast_word* string_tag = allocator.reserve(3, &success_);
+        if (SAJSON_UNLIKELY(!success_)) {
+            return oom(p, "reserve for raw string tag");
+        }
+        string_tag[0] = start;
+        string_tag[1] = end - input.get_data();
+        string_tag[2] = 0; // not unescaped
+        value_tag = tag::raw_string;
+        return p;
+    }
+
+    // skip the rest of a string after its opening quote without parsing it
+    char* skip_string(char* p) {
+        for (;;) {
+            char* q = static_cast<char*>(memchr(p, '"', size_t(input_end - p)));
+            if (SAJSON_UNLIKELY(!q)) {
+                return unexpected_end(input_end);
+            }
+            // the quote is escaped if it's after an odd number of backslashes
+            char* b = q;
+            while (b > p && b[-1] == '\\') {
+                --b;
+            }
+            p = q + 1;
+            if ((q - b) % 2 == 0) {
+                return p;
+            }
+        }
+    }
+
+    // skip a value which is not in the projection without parsing it
+    // structures are bracket-matched, and scalars end at the first delimiter
+    char* skip_value(char* p) {
+        p = skip_whitespace(p);
+        if (SAJSON_UNLIKELY(!p)) {
+            return unexpected_end();
+        }
+        switch (*p) {
+        case '[':
+        case '{':
+            return skip_structure(p);
+        case '"':
+            return skip_string(p + 1);
+        case ',':
+        case ']':
+        case '}':
+            return make_error(p, ERROR_EXPECTED_VALUE);
+        default:
+            while (p != input_end && *p != ',' && *p != ']' && *p != '}'
+                   && !internal::is_whitespace(*p)) {
+                ++p;
+            }
+            return p;
+        }
+    }
+
     bool has_remaining_characters(char* p, ptrdiff_t remaining) {
         return input_end - p >= remaining;
     }
@@ -1568,61 +2231,50 @@ private:
 
     std::pair<char*, internal::tag> parse_number(char* p) {
         using internal::tag;
-        auto begin = p;
+        char* const begin = p;
 
-        if ('-' == *p) {
-            ++p;
-            if (SAJSON_UNLIKELY(at_eof(p))) {
-                return std::make_pair(
-                    make_error(p, ERROR_UNEXPECTED_END), tag::null);
-            }
+        bool integer;
+        if (SAJSON_UNLIKELY(!internal::match_number(p, input_end, integer))) {
+            return std::make_pair(
+                make_error(p, at_eof(p) ? ERROR_UNEXPECTED_END : ERROR_INVALID_NUMBER), tag::null);
         }
-
-        while (*p >= '0' && *p <= '9') {
-            ++p;
-            if (SAJSON_UNLIKELY(at_eof(p))) {
-                return std::make_pair(
-                    make_error(p, ERROR_UNEXPECTED_END), tag::null);
-            }
+        if (SAJSON_UNLIKELY(at_eof(p))) {
+            return std::make_pair(
+                make_error(p, ERROR_UNEXPECTED_END), tag::null);
         }
 
         double double_value = 0;
-
-        bool match_double = *p == '.' || *p == 'e' || *p == 'E';
-        if (!match_double) {
+        bool converted = false;
+        if (integer) {
             int64_t value = 0;
             auto res = std::from_chars(begin, p, value);
-            if (res.ec == std::errc::result_out_of_range) {
-                match_double = true;
-            } else if (res.ec != std::errc()) {
-                return std::make_pair(
-                    make_error(p, ERROR_INVALID_NUMBER), tag::null);
-            } else if (value >= std::numeric_limits<int32_t>::min() && value <= std::numeric_limits<int32_t>::max()) {
-                bool success;
-                size_t* out
-                    = allocator.reserve(integer_storage::word_length, &success);
-                if (SAJSON_UNLIKELY(!success)) {
-                    return std::make_pair(oom(p, "integer"), tag::null);
+            // out of range integers are doubles
+            if (res.ec == std::errc()) {
+                if (value >= std::numeric_limits<int32_t>::min() && value <= std::numeric_limits<int32_t>::max()) {
+                    bool success;
+                    ast_word* out
+                        = allocator.reserve(integer_storage::word_length, &success);
+                    if (SAJSON_UNLIKELY(!success)) {
+                        return std::make_pair(oom(p, "integer"), tag::null);
+                    }
+                    integer_storage::store(out, int(value));
+                    return std::make_pair(p, tag::integer);
                 }
-                integer_storage::store(out, int(value));
-                return std::make_pair(p, tag::integer);
-            }
-            else {
                 double_value = static_cast<double>(value);
+                converted = true;
             }
         }
 
-        if (match_double) {
-            auto res = std::from_chars(begin, input_end, double_value);
+        if (!converted) {
+            auto res = std::from_chars(begin, p, double_value);
             if (res.ec != std::errc()) {
                 return std::make_pair(
                     make_error(p, ERROR_INVALID_NUMBER), tag::null);
             }
-            p = const_cast<char*>(res.ptr);
         }
 
         bool success;
-        size_t* out
+        ast_word* out
             = allocator.reserve(double_storage::word_length, &success);
         if (SAJSON_UNLIKELY(!success)) {
             return std::make_pair(oom(p, "double"), tag::null);
@@ -1631,35 +2283,84 @@ private:
         return std::make_pair(p, tag::double_);
     }
 
-    bool install_array(size_t* array_base, size_t* array_end) {
+    // validate a number and store its source, to be converted when it's read
+    std::pair<char*, internal::tag> scan_number(char* p) {
+        using internal::tag;
+        char* const begin = p;
+
+        bool integer;
+        if (SAJSON_UNLIKELY(!internal::match_number(p, input_end, integer))) {
+            return std::make_pair(
+                make_error(p, at_eof(p) ? ERROR_UNEXPECTED_END : ERROR_INVALID_NUMBER), tag::null);
+        }
+        if (SAJSON_UNLIKELY(at_eof(p))) {
+            return std::make_pair(
+                make_error(p, ERROR_UNEXPECTED_END), tag::null);
+        }
+
+        bool success;
+        ast_word* out = allocator.reserve(2, &success);
+        if (SAJSON_UNLIKELY(!success)) {
+            return std::make_pair(oom(p, "raw number"), tag::null);
+        }
+        out[0] = begin - input.get_data();
+        out[1] = p - input.get_data();
+
+        // like the converted ones, integers which fit in 32 bits are TYPE_INTEGER
+        // (the ones with fewer than 10 digits always do)
+        if (integer) {
+            int i;
+            if (p - begin - (*begin == '-') < 10 || std::from_chars(begin, p, i).ec == std::errc()) {
+                return std::make_pair(p, tag::raw_integer);
+            }
+        }
+        return std::make_pair(p, tag::raw_number);
+    }
+
+    bool install_array(ast_word* array_base, ast_word* array_end) {
         using namespace sajson::internal;
 
         const size_t length = array_end - array_base;
         bool success;
-        size_t* const new_base = allocator.reserve(length + 1, &success);
+        ast_word* const new_base = allocator.reserve(length + 1, &success);
         if (SAJSON_UNLIKELY(!success)) {
             return false;
         }
-        size_t* out = new_base + length + 1;
-        size_t* const structure_end = allocator.get_write_pointer_of(0);
+        ast_word* out = new_base + length + 1;
+        ast_word* const structure_end = allocator.get_write_pointer_of(0);
 
         while (array_end > array_base) {
-            size_t element = *--array_end;
+            ast_word element = *--array_end;
             tag element_type = get_element_tag(element);
             size_t element_value = get_element_value(element);
-            size_t* element_ptr = structure_end - element_value;
+            ast_word* element_ptr = structure_end - element_value;
             *--out = make_element(element_type, element_ptr - new_base);
+            if (spans) {
+                record_span(out, value_spans[value_spans.size() - length + size_t(array_end - array_base)]);
+            }
         }
         *--out = length;
+        if (spans) {
+            value_spans.resize(value_spans.size() - length);
+        }
         return true;
     }
 
-    bool install_object(size_t* object_base, size_t* object_end) {
+    bool install_object(ast_word* object_base, ast_word* object_end) {
         using namespace internal;
 
         assert((object_end - object_base) % 3 == 0);
         const size_t length_times_3 = object_end - object_base;
         const size_t length = length_times_3 / 3;
+        // the spans are in the order of the input, so sorting the keys
+        // requires a lookup by key start (which is unique)
+        const bool sorted_spans = spans && should_binary_search(length);
+        if (sorted_spans) {
+            sorted_span_keys.clear();
+            for (size_t i = 0; i < length; ++i) {
+                sorted_span_keys.push_back(object_base[3 * i]);
+            }
+        }
         if (SAJSON_UNLIKELY(should_binary_search(length))) {
             std::sort(
                 reinterpret_cast<object_key_record*>(object_base),
@@ -1668,29 +2369,48 @@ private:
         }
 
         bool success;
-        size_t* const new_base
+        ast_word* const new_base
             = allocator.reserve(length_times_3 + 1, &success);
         if (SAJSON_UNLIKELY(!success)) {
             return false;
         }
-        size_t* out = new_base + length_times_3 + 1;
-        size_t* const structure_end = allocator.get_write_pointer_of(0);
+        ast_word* out = new_base + length_times_3 + 1;
+        ast_word* const structure_end = allocator.get_write_pointer_of(0);
 
         while (object_end > object_base) {
-            size_t element = *--object_end;
+            ast_word element = *--object_end;
             tag element_type = get_element_tag(element);
             size_t element_value = get_element_value(element);
-            size_t* element_ptr = structure_end - element_value;
+            ast_word* element_ptr = structure_end - element_value;
 
             *--out = make_element(element_type, element_ptr - new_base);
+            if (spans) {
+                const size_t first_span = value_spans.size() - length;
+                size_t i = size_t(object_end - object_base) / 3;
+                if (sorted_spans) {
+                    // key start is two words before the value
+                    i = size_t(std::lower_bound(sorted_span_keys.begin(), sorted_span_keys.end(), object_end[-2])
+                        - sorted_span_keys.begin());
+                }
+                record_span(out, value_spans[first_span + i]);
+            }
             *--out = *--object_end;
             *--out = *--object_end;
         }
         *--out = length;
+        if (spans) {
+            value_spans.resize(value_spans.size() - length);
+        }
         return true;
     }
 
-    char* parse_string(char* p, size_t* tag) {
+    // the elements are installed in order of decreasing address
+    // so the records are sorted by distance from the end
+    void record_span(ast_word* element, const source_span& span) {
+        spans->records.push_back({size_t(allocator.get_write_pointer_of(0) - element), span});
+    }
+
+    char* parse_string(char* p, ast_word* tag) {
         using namespace internal;
 
         ++p; // "
@@ -1781,7 +2501,7 @@ private:
         }
     }
 
-    char* parse_string_slow(char* p, size_t* tag, size_t start) {
+    char* parse_string_slow(char* p, ast_word* tag, size_t start) {
         char* end = p;
         char* input_end_local = input_end;
 
@@ -1881,6 +2601,16 @@ private:
                 break;
 
             default:
+                if (strict_utf8 && static_cast<unsigned char>(*p) >= 128) {
+                    const size_t n = huse::impl::utf8SequenceLength(p, input_end_local);
+                    if (SAJSON_UNLIKELY(!n)) {
+                        return make_error(p, ERROR_INVALID_UTF8);
+                    }
+                    for (size_t i = 0; i < n; ++i) {
+                        *end++ = *p++;
+                    }
+                    break;
+                }
                 // validate UTF-8
                 unsigned char c0 = p[0];
                 if (c0 < 128) {
@@ -1947,10 +2677,30 @@ private:
     mutable_string_view input;
     char* const input_end;
     Allocator allocator;
+    const bool lazy; // only parse the root structure, skipping nested ones
+    const bool lazy_numbers; // store the source of numbers instead of converting them
+    const bool lazy_strings; // don't unescape strings
+    const bool strict_utf8; // reject overlong forms, surrogates, and code points above U+10FFFF
+    const bool check_offsets; // the AST may be too big for the offsets in it
+
+    // ends of the bracket-matched structures (if recorded or known)
+    structure_ends* const record_ends;
+    const structure_ends* const known_ends;
+
+    // source spans (if recorded)
+    source_map* const spans;
+    std::vector<size_t> structure_starts; // input offsets of the open structures
+    std::vector<source_span> value_spans; // parallel to the values on the stack
+    std::vector<ast_word> sorted_span_keys; // key starts of an object with sorted keys
+
+    // projection (if any)
+    const projection* const proj;
+    std::vector<uint32_t> projection_stack; // nodes of the open structures
 
     internal::tag root_tag;
     size_t error_line;
     size_t error_column;
+    size_t error_offset;
     error error_code;
     int error_arg; // optional argument for the error
 };
@@ -1966,19 +2716,34 @@ private:
  *
  * A \ref document is returned whether or not the parse succeeds: success
  * state is available by calling document::is_valid().
+ *
+ * The options are huse additions (see \ref parse_options).
  */
 template <typename AllocationStrategy, typename StringType>
-document parse(const AllocationStrategy& strategy, const StringType& string) {
+document parse(const AllocationStrategy& strategy, const StringType& string, const parse_options& options) {
     mutable_string_view input(string);
 
+    // offsets in the input are stored in whole words
+    // (offsets in the AST are checked while parsing, see internal::ast_size)
+    if constexpr (sizeof(ast_word) < sizeof(size_t)) {
+        if (input.length() > size_t(ast_word(-1))) {
+            return document(input, 1, 1, 0, ERROR_DOCUMENT_TOO_LARGE, 0);
+        }
+    }
+
     bool success;
-    auto allocator = strategy.make_allocator(input.length(), &success);
+    auto allocator = strategy.make_allocator(internal::ast_size(input.length(), options), &success);
     if (!success) {
-        return document(input, 1, 1, ERROR_OUT_OF_MEMORY, 0);
+        return document(input, 1, 1, 0, ERROR_OUT_OF_MEMORY, 0);
     }
 
     return parser<typename AllocationStrategy::allocator>(
-               input, std::move(allocator))
+               input, std::move(allocator), options)
         .get_document();
 }
+
+template <typename AllocationStrategy, typename StringType>
+document parse(const AllocationStrategy& strategy, const StringType& string) {
+    return parse(strategy, string, parse_options{});
+}
 } // namespace sajson
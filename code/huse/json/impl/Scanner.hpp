@@ -0,0 +1,399 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "../Validator.hpp"
+#include <algorithm>
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace huse::json::impl {
+
+// stack of the open structures: one bit per level (set for objects)
+// the first levels are stored inline, so no allocation happens for
+// documents which are not very deeply nested
+class StructureStack {
+public:
+    void push(bool object) {
+        const size_t word = m_size / 64;
+        const uint64_t bit = uint64_t(1) << (m_size % 64);
+        uint64_t* words = m_heap.empty() ? m_inline : m_heap.data();
+        if (word == Num_Inline_Words && m_heap.empty()) {
+            m_heap.assign(m_inline, m_inline + Num_Inline_Words);
+        }
+        if (!m_heap.empty()) {
+            if (word == m_heap.size()) m_heap.push_back(0);
+            words = m_heap.data();
+        }
+        if (object) words[word] |= bit;
+        else words[word] &= ~bit;
+        ++m_size;
+    }
+
+    void pop() { --m_size; }
+
+    bool empty() const { return m_size == 0; }
+
+    bool topIsObject() const {
+        const size_t i = m_size - 1;
+        const uint64_t* words = m_heap.empty() ? m_inline : m_heap.data();
+        return (words[i / 64] >> (i % 64)) & 1;
+    }
+
+private:
+    static constexpr size_t Num_Inline_Words = 4;
+    uint64_t m_inline[Num_Inline_Words] = {};
+    std::vector<uint64_t> m_heap;
+    size_t m_size = 0;
+};
+
+// mirrors the state machine of sajson::parser, including its error codes and offsets,
+// but doesn't write to the input and doesn't produce an AST
+//
+// the tokens are reported to Events, which must have:
+//      static constexpr bool Decode_Values; // whether the value functions are called
+//      void openObject(); void closeObject(); void openArray(); void closeArray();
+//      void key(std::string_view); void stringValue(std::string_view);
+//      void integerValue(int64_t); void floatValue(double); void boolValue(bool); void nullValue();
+// strings are passed unescaped and views of them are only valid during the call
+//
+// Events can optionally have rawStringValue(std::string_view) and rawNumberValue(std::string_view)
+// to receive the source text of values instead (including the quotes for strings)
+template <typename Events>
+class Scanner {
+public:
+    Scanner(std::string_view str, Events& events)
+        : m_begin(str.data())
+        , m_end(str.data() + str.size())
+        , m_events(events)
+    {}
+
+    ValidationResult run() {
+        const char* p = skipWhitespace(m_begin);
+        if (!p) {
+            fail(p, sajson::ERROR_MISSING_ROOT_ELEMENT);
+            return m_result;
+        }
+        if (*p != '[' && *p != '{') {
+            fail(p, sajson::ERROR_BAD_ROOT);
+            return m_result;
+        }
+
+        for (;;) {
+            // p points to a value (possibly preceded by whitespace)
+            p = skipWhitespace(p);
+            if (!p) return unexpectedEnd();
+            if (*p == '[' || *p == '{') {
+                const bool object = *p == '{';
+                m_stack.push(object);
+                if (object) m_events.openObject();
+                else m_events.openArray();
+                p = skipWhitespace(p + 1);
+                if (!p) return unexpectedEnd();
+                if (*p != closing(object)) {
+                    if (object && !(p = key(p))) return m_result;
+                    continue; // first element
+                }
+                // empty structure: fall through to close it
+            }
+            else if (!(p = scalar(p))) {
+                return m_result;
+            }
+
+            // after a value: close structures or continue with the next element
+            for (;;) {
+                p = skipWhitespace(p);
+                if (!p) return unexpectedEnd();
+                const bool object = m_stack.topIsObject();
+                if (*p == closing(object)) {
+                    ++p;
+                    m_stack.pop();
+                    if (object) m_events.closeObject();
+                    else m_events.closeArray();
+                    if (m_stack.empty()) {
+                        p = skipWhitespace(p);
+                        if (p) fail(p, sajson::ERROR_EXPECTED_END_OF_INPUT);
+                        return m_result;
+                    }
+                    continue;
+                }
+                if (*p != ',') {
+                    fail(p, sajson::ERROR_EXPECTED_COMMA);
+                    return m_result;
+                }
+                ++p;
+                if (object && !(p = key(p))) return m_result;
+                break;
+            }
+        }
+    }
+
+private:
+    static constexpr bool Has_Raw_Strings = requires(Events& e, std::string_view s) { e.rawStringValue(s); };
+    static constexpr bool Has_Raw_Numbers = requires(Events& e, std::string_view s) { e.rawNumberValue(s); };
+
+    const char* const m_begin;
+    const char* const m_end;
+    Events& m_events;
+    ValidationResult m_result;
+    StructureStack m_stack;
+
+    // unescaped strings
+    // its size is bound by the longest string with escapes, and not by the document size
+    std::string m_unescaped;
+
+    // functions which can fail return nullptr after setting m_result
+
+    std::nullptr_t fail(const char* p, sajson::error code) {
+        if (!p) p = m_end;
+        m_result.code = code;
+        m_result.offset = size_t(p - m_begin);
+        return nullptr;
+    }
+
+    bool hasRemaining(const char* p, ptrdiff_t n) const {
+        return m_end - p >= n;
+    }
+
+    const char* skipWhitespace(const char* p) const {
+        while (p != m_end) {
+            if (!sajson::internal::is_whitespace(*p)) return p;
+            ++p;
+        }
+        return nullptr;
+    }
+
+    const char* literal(const char* p, std::string_view lit, sajson::error mismatch) {
+        if (!hasRemaining(p, ptrdiff_t(lit.size()))) return fail(p, sajson::ERROR_UNEXPECTED_END);
+        if (std::string_view(p + 1, lit.size() - 1) != lit.substr(1)) return fail(p, mismatch);
+        return p + lit.size();
+    }
+
+    const char* number(const char* p) {
+        // same as sajson so that exactly the same numbers are accepted
+        const char* begin = p;
+        bool integer;
+        if (!sajson::internal::match_number(p, m_end, integer)) {
+            return fail(p, p == m_end ? sajson::ERROR_UNEXPECTED_END : sajson::ERROR_INVALID_NUMBER);
+        }
+        if (p == m_end) return fail(p, sajson::ERROR_UNEXPECTED_END);
+
+        if (integer) {
+            int64_t i;
+            if (std::from_chars(begin, p, i).ec == std::errc()) {
+                if constexpr (Has_Raw_Numbers) m_events.rawNumberValue(std::string_view(begin, size_t(p - begin)));
+                else if constexpr (Events::Decode_Values) m_events.integerValue(i);
+                return p;
+            }
+            // out of range integers are parsed as doubles
+        }
+
+        double d;
+        if (std::from_chars(begin, p, d).ec != std::errc()) return fail(p, sajson::ERROR_INVALID_NUMBER);
+        if constexpr (Has_Raw_Numbers) m_events.rawNumberValue(std::string_view(begin, size_t(p - begin)));
+        else if constexpr (Events::Decode_Values) m_events.floatValue(d);
+        return p;
+    }
+
+    const char* hex(const char* p, unsigned& u) {
+        unsigned v = 0;
+        for (int i = 0; i < 4; ++i) {
+            unsigned char c = *p++;
+            if (c >= '0' && c <= '9') c -= '0';
+            else if (c >= 'a' && c <= 'f') c = c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') c = c - 'A' + 10;
+            else return fail(p, sajson::ERROR_INVALID_UNICODE_ESCAPE);
+            v = (v << 4) + c;
+        }
+        u = v;
+        return p;
+    }
+
+    static char closing(bool object) {
+        return object ? '}' : ']';
+    }
+
+    static bool isContinuation(unsigned char c) {
+        return c >= 128 && c < 192;
+    }
+
+    // p points to the opening quote
+    const char* parseString(const char* p, bool isKey) {
+        ++p;
+        const char* const begin = p;
+        bool escaped = false;
+        while (p != m_end && sajson::internal::is_plain_string_character(*p)) ++p;
+
+        for (;;) {
+            if (p >= m_end) return fail(p, sajson::ERROR_UNEXPECTED_END);
+            if (sajson::internal::is_plain_string_character(*p)) {
+                ++p;
+                continue;
+            }
+
+            const char c = *p;
+            if (c == '"') {
+                if constexpr (Has_Raw_Strings) {
+                    if (!isKey) {
+                        m_events.rawStringValue(std::string_view(begin - 1, size_t(p + 1 - (begin - 1))));
+                        return p + 1;
+                    }
+                }
+                if constexpr (Events::Decode_Values) {
+                    std::string_view str(begin, size_t(p - begin));
+                    if (escaped) str = unescape(begin, p);
+                    if (isKey) m_events.key(str);
+                    else m_events.stringValue(str);
+                }
+                return p + 1;
+            }
+            if (c >= 0 && c < 0x20) return fail(p, sajson::ERROR_ILLEGAL_CODEPOINT);
+
+            if (c == '\\') {
+                escaped = true;
+                ++p;
+                if (p >= m_end) return fail(p, sajson::ERROR_UNEXPECTED_END);
+                switch (*p) {
+                case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
+                    ++p;
+                    break;
+                case 'u': {
+                    ++p;
+                    if (!hasRemaining(p, 4)) return fail(p, sajson::ERROR_UNEXPECTED_END);
+                    unsigned u = 0;
+                    p = hex(p, u);
+                    if (!p) return nullptr;
+                    if (u >= 0xD800 && u <= 0xDBFF) {
+                        if (!hasRemaining(p, 6)) return fail(p, sajson::ERROR_UNEXPECTED_END_OF_UTF16);
+                        if (p[0] != '\\' || p[1] != 'u') return fail(p, sajson::ERROR_EXPECTED_U);
+                        p += 2;
+                        unsigned v = 0;
+                        p = hex(p, v);
+                        if (!p) return nullptr;
+                        if (v < 0xDC00 || v > 0xDFFF) return fail(p, sajson::ERROR_INVALID_UTF16_TRAIL_SURROGATE);
+                    }
+                    break;
+                }
+                default:
+                    return fail(p, sajson::ERROR_UNKNOWN_ESCAPE);
+                }
+                continue;
+            }
+
+            // validate UTF-8 (as leniently as sajson does)
+            const unsigned char c0 = c;
+            int len;
+            if (c0 < 224) len = 2;
+            else if (c0 < 240) len = 3;
+            else if (c0 < 248) len = 4;
+            else return fail(p, sajson::ERROR_INVALID_UTF8);
+
+            if (!hasRemaining(p, len)) return fail(p, sajson::ERROR_UNEXPECTED_END);
+            for (int i = 1; i < len; ++i) {
+                if (!isContinuation(p[i])) return fail(p + i, sajson::ERROR_INVALID_UTF8);
+            }
+            p += len;
+        }
+    }
+
+    void writeUtf8(unsigned codepoint) {
+        // same as sajson
+        if (codepoint < 0x80) {
+            m_unescaped.push_back(char(codepoint));
+        }
+        else if (codepoint < 0x800) {
+            m_unescaped.push_back(char(0xC0 | (codepoint >> 6)));
+            m_unescaped.push_back(char(0x80 | (codepoint & 0x3F)));
+        }
+        else if (codepoint < 0x10000) {
+            m_unescaped.push_back(char(0xE0 | (codepoint >> 12)));
+            m_unescaped.push_back(char(0x80 | ((codepoint >> 6) & 0x3F)));
+            m_unescaped.push_back(char(0x80 | (codepoint & 0x3F)));
+        }
+        else {
+            m_unescaped.push_back(char(0xF0 | (codepoint >> 18)));
+            m_unescaped.push_back(char(0x80 | ((codepoint >> 12) & 0x3F)));
+            m_unescaped.push_back(char(0x80 | ((codepoint >> 6) & 0x3F)));
+            m_unescaped.push_back(char(0x80 | (codepoint & 0x3F)));
+        }
+    }
+
+    // string contents between begin and end (which have already been validated)
+    std::string_view unescape(const char* p, const char* end) {
+        m_unescaped.clear();
+        for (;;) {
+            auto bs = std::find(p, end, '\\');
+            m_unescaped.append(p, bs);
+            if (bs == end) return m_unescaped;
+            p = bs + 1;
+            switch (*p++) {
+            case 'b': m_unescaped.push_back('\b'); break;
+            case 'f': m_unescaped.push_back('\f'); break;
+            case 'n': m_unescaped.push_back('\n'); break;
+            case 'r': m_unescaped.push_back('\r'); break;
+            case 't': m_unescaped.push_back('\t'); break;
+            case 'u': {
+                unsigned u = 0;
+                p = hex(p, u);
+                if (u >= 0xD800 && u <= 0xDBFF) {
+                    unsigned v = 0;
+                    p = hex(p + 2, v);
+                    u = 0x10000 + (((u - 0xD800) << 10) | (v - 0xDC00));
+                }
+                writeUtf8(u);
+                break;
+            }
+            default: m_unescaped.push_back(p[-1]); break; // " \ /
+            }
+        }
+    }
+
+    // parses a single non-structure value
+    const char* scalar(const char* p) {
+        switch (*p) {
+        case 0: return fail(p, sajson::ERROR_UNEXPECTED_END);
+        case 'n':
+            p = literal(p, "null", sajson::ERROR_EXPECTED_NULL);
+            if constexpr (Events::Decode_Values) if (p) m_events.nullValue();
+            return p;
+        case 'f':
+            p = literal(p, "false", sajson::ERROR_EXPECTED_FALSE);
+            if constexpr (Events::Decode_Values) if (p) m_events.boolValue(false);
+            return p;
+        case 't':
+            p = literal(p, "true", sajson::ERROR_EXPECTED_TRUE);
+            if constexpr (Events::Decode_Values) if (p) m_events.boolValue(true);
+            return p;
+        case '0': case '1': case '2': case '3': case '4':
+        case '5': case '6': case '7': case '8': case '9':
+        case '-':
+            return number(p);
+        case '"': return parseString(p, false);
+        case ',': return fail(p, sajson::ERROR_UNEXPECTED_COMMA);
+        default: return fail(p, sajson::ERROR_EXPECTED_VALUE);
+        }
+    }
+
+    // p is at the key (possibly preceded by whitespace)
+    // returns the position after the colon
+    const char* key(const char* p) {
+        p = skipWhitespace(p);
+        if (!p) return fail(p, sajson::ERROR_UNEXPECTED_END);
+        if (*p != '"') return fail(p, sajson::ERROR_MISSING_OBJECT_KEY);
+        p = parseString(p, true);
+        if (!p) return nullptr;
+        p = skipWhitespace(p);
+        if (!p || *p != ':') return fail(p, sajson::ERROR_EXPECTED_COLON);
+        return p + 1;
+    }
+
+    ValidationResult unexpectedEnd() {
+        fail(nullptr, sajson::ERROR_UNEXPECTED_END);
+        return m_result;
+    }
+};
+
+} // namespace huse::json::impl
@@ -7,6 +7,15 @@
 #include <huse/helpers/Identity.hpp>
 #include <huse/helpers/StdVector.hpp>
 #include <huse/helpers/StdMap.hpp>
+#include <huse/helpers/StdUnorderedMap.hpp>
+#include <huse/helpers/StdDeque.hpp>
+#include <huse/helpers/StdArray.hpp>
+#include <huse/helpers/StdSpan.hpp>
+#include <huse/helpers/StdSet.hpp>
+#include <huse/helpers/StdUnorderedSet.hpp>
+#include <huse/helpers/StdOptional.hpp>
+#include <huse/helpers/StdVariant.hpp>
+#include <huse/helpers/StdTuple.hpp>
 #include <huse/helpers/IntAsString.hpp>
 
 #include <huse/Exception.hpp>
@@ -14,6 +23,7 @@
 #include <doctest/doctest.h>
 
 #include <sstream>
+#include <memory_resource>
 
 TEST_SUITE_BEGIN("huse");
 
@@ -80,6 +90,104 @@ TEST_CASE("map") {
     CHECK(isclone == is);
 }
 
+TEST_CASE("unordered map") {
+    std::unordered_map<std::string, int> si = {{"a", 1}, {"foo", 43}, {"bagavag", 32}};
+    CHECK(sclone(si) == si);
+
+    std::unordered_map<int, std::string> is = {{1, "foo"}, {4, "dsfsd"}, {-5, "boo"}};
+    CHECK(sclone(is) == is);
+
+    // many keys: sorted by the parser
+    std::map<std::string, int> big;
+    for (int i = 0; i < 300; ++i) {
+        big.emplace("key" + std::to_string(i), i);
+    }
+    CHECK(sclone(big) == big);
+    std::unordered_map<std::string, int> ubig(big.begin(), big.end());
+    CHECK(sclone(ubig) == ubig);
+
+    // existing keys are not overwritten
+    const std::string json = R"({"a": 1, "b": 2})";
+    huse::json::DeserializerRoot d(json);
+    std::unordered_map<std::string, int> existing = {{"a", 5}};
+    d.val(existing);
+    CHECK(existing == std::unordered_map<std::string, int>{{"a", 5}, {"b", 2}});
+}
+
+TEST_CASE("sequences") {
+    std::deque<std::string> deq = {"a", "bb", "ccc"};
+    CHECK(sclone(deq, R"({"t":["a","bb","ccc"]})") == deq);
+
+    std::array<int, 3> arr = {1, 2, 3};
+    CHECK(sclone(arr, R"({"t":[1,2,3]})") == arr);
+
+    {
+        const std::string json = R"({"t":[1,2]})";
+        huse::json::DeserializerRoot d(json);
+        ObjWrap<std::array<int, 3>, huse::Identity> w(huse::Identity{});
+        CHECK_THROWS_WITH_AS(d.val(w), "array size mismatch", huse::DeserializerException);
+    }
+
+    int buf[3] = {};
+    {
+        std::stringstream sout;
+        {
+            huse::json::SerializerRoot s(sout);
+            s.val(std::span<const int>(arr));
+        }
+        CHECK(sout.str() == "[1,2,3]");
+
+        huse::json::DeserializerRoot d(sout.str());
+        std::span<int> span(buf);
+        d.val(span);
+        CHECK(buf[0] == 1);
+        CHECK(buf[2] == 3);
+    }
+}
+
+TEST_CASE("sets") {
+    std::set<std::string> set = {"x", "y", "a"};
+    CHECK(sclone(set, R"({"t":["a","x","y"]})") == set);
+
+    std::multiset<int> mset = {1, 1, 2};
+    CHECK(sclone(mset) == mset);
+
+    std::unordered_set<int> uset = {5, 6, 7};
+    CHECK(sclone(uset) == uset);
+}
+
+TEST_CASE("optional variant tuple") {
+    std::optional<int> o = 5;
+    CHECK(sclone(o, R"({"t":5})") == o);
+    o.reset();
+    CHECK(sclone(o, R"({"t":null})") == o);
+
+    std::vector<std::optional<std::string>> vo = {"a", std::nullopt, "b"};
+    CHECK(sclone(vo, R"({"t":["a",null,"b"]})") == vo);
+
+    using Var = std::variant<int, std::string, std::vector<int>>;
+    Var var = std::string("str");
+    CHECK(sclone(var, R"({"t":{"index":1,"value":"str"}})") == var);
+    var = std::vector<int>{1, 2};
+    CHECK(sclone(var) == var);
+    {
+        const std::string json = R"({"t":{"index":3,"value":0}})";
+        huse::json::DeserializerRoot d(json);
+        ObjWrap<Var, huse::Identity> w(huse::Identity{});
+        auto ex = huse::DeserializerException(huse::ErrorCode::None);
+        try { d.val(w); }
+        catch (huse::DeserializerException& e) { ex = e; }
+        CHECK(ex.code() == huse::ErrorCode::IndexOutOfBounds);
+        CHECK(ex.path() == "/t/index");
+    }
+
+    std::tuple<int, std::string, double> tup = {1, "two", 3.5};
+    CHECK(sclone(tup, R"({"t":[1,"two",3.5]})") == tup);
+
+    std::pair<std::string, std::vector<int>> pair = {"p", {1}};
+    CHECK(sclone(pair, R"({"t":["p",[1]]})") == pair);
+}
+
 TEST_CASE("istr") {
     const int i = 551122;
     const auto ic = cclone(i, huse::IntAsString{}, R"({"t":"551122"})");
@@ -104,3 +212,114 @@ TEST_CASE("istr") {
     }
 }
 
+
+namespace {
+// counts the allocations passed to upstream
+class CountingResource : public std::pmr::memory_resource {
+public:
+    std::pmr::memory_resource* upstream;
+    size_t allocations = 0;
+    explicit CountingResource(std::pmr::memory_resource* u) : upstream(u) {}
+private:
+    void* do_allocate(size_t bytes, size_t align) override {
+        ++allocations;
+        return upstream->allocate(bytes, align);
+    }
+    void do_deallocate(void* p, size_t bytes, size_t align) override {
+        upstream->deallocate(p, bytes, align);
+    }
+    bool do_is_equal(const memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+struct PmrItem {
+    std::pmr::string name; // not allocator-aware itself
+    std::pmr::vector<int> values;
+
+    template <typename D>
+    void huseDeserialize(huse::DeserializerNode<D>& n) {
+        auto obj = n.obj();
+        obj.val("name", name);
+        obj.val("values", values);
+    }
+};
+
+// makes every allocation from the default resource fail
+struct NoDefaultResource {
+    std::pmr::memory_resource* prev = std::pmr::set_default_resource(std::pmr::null_memory_resource());
+    ~NoDefaultResource() { std::pmr::set_default_resource(prev); }
+};
+}
+
+TEST_CASE("pmr") {
+    const std::string json = R"({
+        "strings": ["a string which is too long for the small string buffer", "b"],
+        "map": {"a key which is too long for the small string buffer": [1, 2], "k": [3]},
+        "items": [{"name": "a name which is too long for the small string buffer", "values": [4, 5]}]
+    })";
+
+    std::pmr::monotonic_buffer_resource arena;
+    CountingResource counter(&arena);
+    {
+        NoDefaultResource ndr;
+
+        std::pmr::vector<std::pmr::string> strings;
+        std::pmr::map<std::pmr::string, std::pmr::vector<int>> map;
+        std::pmr::vector<PmrItem> items;
+
+        huse::json::DeserializerRoot d(json);
+        d.setMemoryResource(&counter);
+        CHECK(d.memoryResource() == &counter);
+        auto obj = d.obj();
+        obj.val("strings", strings);
+        obj.val("map", map);
+        obj.val("items", items);
+
+        CHECK(counter.allocations > 0);
+        CHECK(strings.get_allocator().resource() == &counter);
+        CHECK(strings.size() == 2);
+        CHECK(strings[0] == "a string which is too long for the small string buffer");
+        CHECK(strings[0].get_allocator().resource() == &counter);
+        CHECK(map.get_allocator().resource() == &counter);
+        CHECK(map.size() == 2);
+        CHECK(map.begin()->first.get_allocator().resource() == &counter);
+        CHECK(map.rbegin()->second.size() == 1);
+        CHECK(map.rbegin()->second[0] == 3);
+        CHECK(items.size() == 1);
+        CHECK(items[0].name == "a name which is too long for the small string buffer");
+        CHECK(items[0].name.get_allocator().resource() == &counter);
+        CHECK(items[0].values.get_allocator().resource() == &counter);
+    }
+
+    // without a resource the values are left as they are
+    {
+        std::pmr::vector<std::pmr::string> s2;
+        huse::json::DeserializerRoot d(json);
+        CHECK_FALSE(d.memoryResource());
+        d.obj().val("strings", s2);
+        CHECK(s2.get_allocator().resource() == std::pmr::get_default_resource());
+        CHECK(s2[1] == "b");
+    }
+
+    // values with a resource other than the default one keep it
+    {
+        std::pmr::monotonic_buffer_resource other;
+        std::pmr::vector<std::pmr::string> s3(&other);
+        huse::json::DeserializerRoot d(json);
+        d.setMemoryResource(&counter);
+        d.obj().val("strings", s3);
+        CHECK(s3.get_allocator().resource() == &other);
+        CHECK(s3[0].get_allocator().resource() == &other);
+    }
+
+    // and so do non-empty values
+    {
+        std::pmr::vector<std::pmr::string> s4(1);
+        huse::json::DeserializerRoot d(json);
+        d.setMemoryResource(&counter);
+        d.obj().val("strings", s4);
+        CHECK(s4.get_allocator().resource() == std::pmr::get_default_resource());
+        CHECK(s4.size() == 2);
+    }
+}
@@ -6,6 +6,22 @@
 #include <huse/json/DeserializerRoot.hpp>
 #include <huse/json/SerializerRoot.hpp>
 #include <huse/json/Limits.hpp>
+#include <huse/json/Validator.hpp>
+#include <huse/json/Sax.hpp>
+#include <huse/json/Transcoder.hpp>
+#include <huse/json/Pointer.hpp>
+#include <huse/json/Projection.hpp>
+#include <huse/json/Patch.hpp>
+#include <huse/json/DocumentCache.hpp>
+#include <huse/json/DomSerializerRoot.hpp>
+#include <huse/json/SizeSerializer.hpp>
+#include <huse/json/SegmentedOutput.hpp>
+#include <huse/json/AsyncOutput.hpp>
+#include <huse/json/FragmentCache.hpp>
+#include <huse/json/CanonicalSerializer.hpp>
+#if HUSE_HAS_ZLIB
+#include <huse/json/Deflate.hpp>
+#endif
 
 #include <huse/helpers/StdVector.hpp>
 
@@ -14,6 +30,14 @@
 #include <sstream>
 #include <limits>
 #include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 TEST_SUITE_BEGIN("json");
 
@@ -176,6 +200,561 @@ TEST_CASE("serializer exceptions")
     }
 }
 
+TEST_CASE("serialized size")
+{
+    auto write = [](huse::SerializerNode<huse::json::JsonSerializer>& n) {
+        auto obj = n.obj();
+        obj.val("int", -1234567);
+        obj.val("big", 1ull << 52);
+        obj.val("float", 0.1);
+        obj.val("esc", "a\"b\\c\n\x01 n\xc3\xa9");
+        obj.val("null", nullptr);
+        obj.val("skipped", std::nullopt);
+        obj.val("flag", false);
+        obj.obj("empty");
+        {
+            auto ar = obj.ar("ar");
+            ar.val(1);
+            ar.ar();
+            ar.obj().val("k\t", "v");
+            ar.open(huse::StringStream{}) << "stream " << 42 << "\t";
+        }
+    };
+
+    for (bool pretty : {false, true}) {
+        JsonSerializerPack pack(pretty);
+        {
+            auto node = pack.node();
+            write(node);
+        }
+        const auto expected = pack.str();
+
+        CHECK(huse::json::serializedSize(write, pretty) == expected.size());
+        CHECK(huse::json::serializeExact(write, pretty) == expected);
+    }
+
+    CHECK(huse::json::serializedSize([](auto& n) { n.val(std::vector<int>{1, 22, 333}); }) == 10);
+    CHECK(huse::json::serializeExact([](auto& n) { n.val("x"); }) == R"("x")");
+}
+
+TEST_CASE("segmented output")
+{
+    const std::string big(100, 'x');
+    const std::string bigEscaped = big + "\n";
+    const std::string small = "small";
+    const std::string raw = R"({"raw": [1, 2, 3]})";
+
+    auto write = [&](auto& s) {
+        auto obj = s.obj();
+        obj.val("big", big);
+        obj.val("esc", bigEscaped);
+        obj.val("small", small);
+        obj.val("raw", huse::json::RawJson{raw});
+        obj.val("big2", std::string_view(big));
+    };
+
+    std::ostringstream expected;
+    {
+        huse::json::SerializerRoot s(expected, true);
+        write(s);
+    }
+
+    huse::json::SegmentedOutput out(16);
+    {
+        huse::json::SerializerRoot s(out, true);
+        write(s);
+    }
+    CHECK(out.size() == expected.str().size());
+    CHECK(out.str() == expected.str());
+
+    // the large strings which need no escaping are referenced
+    int refs = 0;
+    for (auto& seg : out.segments()) {
+        if (seg.data == big.data()) {
+            CHECK(seg.size == big.size());
+            ++refs;
+        }
+        CHECK(seg.data != bigEscaped.data());
+        CHECK(seg.data != small.data());
+        if (seg.data == raw.data()) ++refs;
+    }
+    CHECK(refs == 3);
+
+    // partial output
+    out.clear();
+    CHECK(out.size() == 0);
+    {
+        huse::json::SerializerRoot s(out);
+        auto ar = s.ar();
+        ar.val(big);
+        const auto segs = out.segments();
+        CHECK(segs.size() == 3); // [" big "
+        CHECK(segs[1].data == big.data());
+        ar.val(1);
+        CHECK(out.segments().size() == 4); // the ones which are there don't change
+        CHECK(out.segments()[2].data == segs[2].data);
+    }
+    CHECK(out.str() == "[\"" + big + "\",1]");
+
+    // more text than a chunk
+    out.clear();
+    {
+        huse::json::SerializerRoot s(out);
+        auto ar = s.ar();
+        for (int i = 0; i < 10000; ++i) ar.val(i);
+    }
+    std::ostringstream ints;
+    {
+        huse::json::SerializerRoot s(ints);
+        auto ar = s.ar();
+        for (int i = 0; i < 10000; ++i) ar.val(i);
+    }
+    CHECK(out.str() == ints.str());
+    CHECK(out.segments().size() > 1);
+}
+
+struct Profile {
+    std::string name;
+    std::vector<int> scores;
+    mutable int serializations = 0;
+
+    void huseSerialize(huse::SerializerNode<huse::json::JsonSerializer>& n) const {
+        ++serializations;
+        auto obj = n.obj();
+        obj.val("name", name);
+        obj.val("scores", scores);
+    }
+};
+
+TEST_CASE("fragment cache")
+{
+    Profile p{"Alice \"A\"", {1, 2}};
+    uint64_t version = 1;
+    huse::json::FragmentCache cache;
+
+    auto write = [&](bool pretty) {
+        JsonSerializerPack pack(pretty);
+        {
+            auto obj = pack.node().obj();
+            obj.val("id", 5);
+            obj.val("profile", cache.memoized(p, version));
+            obj.ar("list").val(cache.memoized(p, version));
+        }
+        return pack.str();
+    };
+    auto expected = [&](bool pretty) {
+        JsonSerializerPack pack(pretty);
+        {
+            auto obj = pack.node().obj();
+            obj.val("id", 5);
+            obj.val("profile", p);
+            obj.ar("list").val(p);
+        }
+        return pack.str();
+    };
+
+    CHECK(write(false) == expected(false));
+    CHECK(p.serializations == 3); // once for the cache and twice for expected
+    CHECK(cache.stats().misses == 1);
+    CHECK(cache.stats().hits == 1);
+    CHECK(cache.size() == 1);
+    const auto compactSize = cache.bytes();
+    CHECK(cache.stats().bytesSaved == compactSize);
+
+    CHECK(write(false) == expected(false));
+    CHECK(p.serializations == 5);
+    CHECK(cache.stats().hits == 3);
+    CHECK(cache.stats().hitRate() == 0.75);
+
+    // pretty fragments are indented for their depth
+    CHECK(write(true) == expected(true));
+    CHECK(p.serializations == 8);
+    CHECK(cache.bytes() > compactSize);
+
+    // a new version is serialized again
+    p.scores.push_back(3);
+    ++version;
+    cache.resetStats();
+    CHECK(write(false) == expected(false));
+    CHECK(cache.stats().misses == 1);
+    CHECK(cache.stats().hits == 1);
+    CHECK(cache.size() == 1);
+
+    cache.invalidate(&p);
+    CHECK(cache.size() == 0);
+    CHECK(cache.bytes() == 0);
+    CHECK(write(true) == expected(true));
+    CHECK(cache.stats().misses == 2);
+
+    // with strict UTF-8 fragments are validated like values which are written directly
+    auto writeStr = [&](const std::string& str, bool strict) {
+        JsonSerializerPack pack;
+        pack.s->setStrictUtf8(strict);
+        pack.node().val(cache.memoized(str, 1));
+        return pack.str();
+    };
+    const std::string bad = "a\xff";
+    cache.resetStats();
+    writeStr(bad, false);
+    CHECK_THROWS_AS(writeStr(bad, true), huse::SerializerException);
+    CHECK_THROWS_AS(writeStr(bad, true), huse::SerializerException);
+    CHECK(cache.stats().misses == 3);
+
+    // and the ones which were validated are used without it
+    const std::string good = "\xc3\xa9";
+    CHECK(writeStr(good, true) == "\"\xc3\xa9\"");
+    CHECK(writeStr(good, false) == "\"\xc3\xa9\"");
+    CHECK(writeStr(good, true) == "\"\xc3\xa9\"");
+    CHECK(cache.stats().misses == 4);
+    CHECK(cache.stats().hits == 2);
+}
+
+TEST_CASE("canonical output")
+{
+    auto canonical = [](auto f) {
+        std::ostringstream out;
+        uint64_t hash;
+        {
+            huse::json::CanonicalJsonSerializer s(out);
+            {
+                huse::SerializerNode<huse::json::JsonSerializer> node(s);
+                f(node);
+            }
+            hash = s.hash();
+        }
+        auto str = out.str();
+        huse::impl::Xxh64 x;
+        x.update(str.data(), str.size());
+        CHECK(x.digest() == hash);
+        CHECK(huse::json::canonicalHash(f) == hash);
+        return str;
+    };
+
+    auto a = canonical([](auto& n) {
+        auto obj = n.obj();
+        obj.val("b", 1.0);
+        obj.val("skipped", std::nullopt);
+        obj.val("a", "x");
+        {
+            auto ar = obj.ar("c");
+            {
+                auto o = ar.obj();
+                o.val("z", -0.0);
+                o.val("\xc3\xa9", true);
+                o.val("y\n", nullptr);
+            }
+            ar.val(0.1f);
+        }
+        obj.key("\"").open(huse::StringStream{}) << "stream";
+        obj.obj("empty");
+    });
+    CHECK(a == R"({"\"":"stream","a":"x","b":1,"c":[{"y\n":null,"z":0,"é":true},0.1],"empty":{}})");
+
+    // the same values in another order and of other types
+    auto b = canonical([](auto& n) {
+        auto obj = n.obj();
+        obj.obj("empty");
+        obj.val("\"", "stream");
+        {
+            auto ar = obj.ar("c");
+            {
+                auto o = ar.obj();
+                o.val("\xc3\xa9", true);
+                o.val("y\n", nullptr);
+                o.val("z", 0);
+            }
+            ar.val(0.1);
+        }
+        obj.val("b", 1);
+        obj.val("a", "x");
+    });
+    CHECK(a == b);
+
+    // numbers (examples from RFC 8785)
+    auto number = [&](double d) {
+        return canonical([&](auto& n) { n.val(d); });
+    };
+    CHECK(number(333333333.33333329) == "333333333.3333333");
+    CHECK(number(1e30) == "1e+30");
+    CHECK(number(4.50) == "4.5");
+    CHECK(number(2e-3) == "0.002");
+    CHECK(number(0.000000000000000000000000001) == "1e-27");
+    CHECK(number(1e21) == "1e+21");
+    CHECK(number(1e20) == "100000000000000000000");
+    CHECK(number(1e-6) == "0.000001");
+    CHECK(number(1e-7) == "1e-7");
+    CHECK(number(-1.5e-9) == "-1.5e-9");
+    CHECK(number(9007199254740991.0) == "9007199254740991");
+
+    // objects and output bigger than the buffer
+    auto big = [](bool reverse) {
+        return [reverse](auto& n) {
+            auto ar = n.ar();
+            for (int i = 0; i < 3; ++i) {
+                auto obj = ar.obj();
+                for (int j = 0; j < 2000; ++j) {
+                    const int k = reverse ? 1999 - j : j;
+                    char key[8];
+                    snprintf(key, sizeof(key), "%04d", k);
+                    obj.val(key, "value " + std::to_string(k));
+                }
+            }
+        };
+    };
+    auto sorted = canonical(big(false));
+    CHECK(sorted.size() > 100000);
+    CHECK(canonical(big(true)) == sorted);
+
+    // compact output of sorted members is already canonical
+    JsonSerializerPack pack;
+    {
+        auto node = pack.node();
+        big(false)(node);
+    }
+    CHECK(pack.str() == sorted);
+
+    // transcoded values are decoded, so that they are canonicalized
+    CHECK(canonical([](auto& n) {
+        huse::json::transcode(R"({"b": 1.0, "a": "\u0041", "c": 1e2})", n._s());
+    }) == R"({"a":"A","b":1,"c":100})");
+
+    // and cached fragments are rendered as canonical
+    struct Unordered {
+        void huseSerialize(huse::SerializerNode<huse::json::JsonSerializer>& n) const {
+            auto obj = n.obj();
+            obj.val("b", 1.0);
+            obj.val("a", 2);
+        }
+    };
+    const Unordered u;
+    huse::json::FragmentCache cache;
+    {
+        JsonSerializerPack p;
+        p.node().val(cache.memoized(u, 1));
+    }
+    CHECK(canonical([&](auto& n) { n.obj().val("u", cache.memoized(u, 1)); }) == R"({"u":{"a":2,"b":1}})");
+    CHECK(cache.stats().misses == 2);
+    CHECK(cache.stats().hits == 1); // by canonicalHash
+}
+
+#if HUSE_HAS_ZLIB
+TEST_CASE("compressed streams")
+{
+    using namespace huse::json;
+
+    // bigger than the buffers, with a string which is compressed without copying it
+    const std::string big(100 * 1024, 'b');
+    auto write = [&](auto& n) {
+        auto ar = n.ar();
+        for (int i = 0; i < 5000; ++i) {
+            auto obj = ar.obj();
+            obj.val("id", i);
+            obj.val("name", "item " + std::to_string(i));
+        }
+        ar.val(big);
+    };
+
+    std::ostringstream expectedOut;
+    {
+        SerializerRoot s(expectedOut);
+        write(s);
+    }
+    const auto expected = expectedOut.str();
+
+    auto code = [](auto f) {
+        try {
+            f();
+        }
+        catch (huse::Exception& ex) {
+            return ex.code();
+        }
+        return huse::ErrorCode::None;
+    };
+
+    for (auto format : {DeflateFormat::Raw, DeflateFormat::Zlib, DeflateFormat::Gzip}) {
+        std::ostringstream compressedOut;
+        DeflateOutput out(compressedOut, -1, format);
+        {
+            SerializerRoot s(out.stream());
+            write(s);
+        }
+        out.finish();
+        CHECK(out.inSize() == expected.size());
+        const auto compressed = compressedOut.str();
+        CHECK(out.outSize() == compressed.size());
+        CHECK(compressed.size() < expected.size() / 4);
+
+        {
+            std::istringstream in(compressed);
+            InflateInput inflate(in, format);
+            std::string str((std::istreambuf_iterator<char>(inflate.stream())), std::istreambuf_iterator<char>());
+            CHECK(str == expected);
+            CHECK(inflate.done());
+            CHECK(inflate.inSize() == compressed.size());
+        }
+
+        // with an exact, a wrong, and no size hint
+        for (size_t hint : {expected.size(), size_t(10), size_t(0)}) {
+            std::istringstream in(compressed);
+            DeserializerRoot d(parseCompressed(in, format, {}, hint));
+            CHECK(d.jsonParser().document._internal_get_input().length() == expected.size());
+            auto ar = d.ar();
+            CHECK(ar.size() == 5001);
+            std::string name;
+            ar.obj().val("name", name);
+            CHECK(name == "item 0");
+        }
+
+        // the input can continue after the compressed stream
+        {
+            std::istringstream in(compressed + "tail");
+            Parser p = parseCompressed(in, format);
+            CHECK(p.rootValue().get_length() == 5001);
+            std::string tail;
+            in >> tail;
+            CHECK(tail == "tail");
+        }
+        {
+            std::istringstream in(compressed + "TRAILER");
+            InflateInput inflate(in, format);
+            std::string str((std::istreambuf_iterator<char>(inflate.stream())), std::istreambuf_iterator<char>());
+            CHECK(str == expected);
+            CHECK(inflate.inSize() == compressed.size());
+            std::string tail;
+            in >> tail;
+            CHECK(tail == "TRAILER");
+        }
+
+        // truncated and corrupted input
+        CHECK(code([&]() {
+            std::istringstream in(compressed.substr(0, compressed.size() / 2));
+            parseCompressed(in, format);
+        }) == huse::ErrorCode::Compression);
+        auto corrupted = compressed;
+        for (size_t i = 0; i < corrupted.size(); i += 7) corrupted[i] = char(~corrupted[i]);
+        CHECK(code([&]() {
+            std::istringstream in(corrupted);
+            parseCompressed(in, format);
+        }) == huse::ErrorCode::Compression);
+    }
+
+    // errors are thrown through the streams
+    {
+        char small[16];
+        impl::FixedBufferStreambuf buf(small, sizeof(small));
+        std::ostream target(&buf);
+        DeflateOutput out(target, 0);
+        CHECK(code([&]() {
+            out.stream().write(big.data(), std::streamsize(big.size()));
+        }) == huse::ErrorCode::Compression);
+    }
+    {
+        std::istringstream in("this is not compressed");
+        InflateInput inflate(in);
+        int i = 0;
+        CHECK(code([&]() {
+            inflate.stream() >> i;
+        }) == huse::ErrorCode::Compression);
+    }
+
+    // the stream is finished when the output is destroyed
+    std::ostringstream compressedOut;
+    {
+        DeflateOutput out(compressedOut, 9);
+        SerializerRoot s(out.stream());
+        s.val(std::vector<int>{1, 2, 3});
+    }
+    std::istringstream in(compressedOut.str());
+    CHECK(parseCompressed(in).rootValue().get_length() == 3);
+}
+#endif
+
+huse::json::SerializeTask produceItems(huse::json::AsyncOutput& out, int count, double last = 0) {
+    huse::json::SerializerRoot s(out.stream());
+    auto ar = s.ar();
+    for (int i = 0; i < count; ++i) {
+        auto obj = ar.obj();
+        obj.val("id", i);
+        obj.val("name", "item " + std::to_string(i));
+        co_await out.drain();
+    }
+    ar.val(last);
+}
+
+TEST_CASE("async output")
+{
+    constexpr int count = 10000;
+    std::ostringstream expected;
+    {
+        huse::json::SerializerRoot s(expected);
+        auto ar = s.ar();
+        for (int i = 0; i < count; ++i) {
+            auto obj = ar.obj();
+            obj.val("id", i);
+            obj.val("name", "item " + std::to_string(i));
+        }
+        ar.val(0.0);
+    }
+
+    huse::json::AsyncOutput out(256);
+
+#if !defined(_WIN32)
+    // drain to a pipe which is read in the same loop
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+
+    std::string received;
+    auto receive = [&] {
+        char buf[4096];
+        ssize_t n;
+        while ((n = read(fds[0], buf, sizeof(buf))) > 0) received.append(buf, size_t(n));
+    };
+
+    auto task = produceItems(out, count);
+    int suspensions = 0;
+    while (!task.done()) {
+        task.resume();
+        ++suspensions;
+        while (!out.pending().empty()) {
+            auto n = write(fds[1], out.pending().data(), out.pending().size());
+            if (n > 0) out.consume(size_t(n));
+            else receive(); // the pipe is full
+        }
+    }
+    close(fds[1]);
+    receive();
+    close(fds[0]);
+
+    CHECK(received == expected.str());
+    CHECK(suspensions > 100);
+    CHECK(out.bufferSize() == 512); // no value is bigger than the capacity
+#endif
+
+    // values bigger than the capacity grow the buffer
+    {
+        huse::json::AsyncOutput small(4);
+        auto t = produceItems(small, 3);
+        std::string str;
+        while (!t.done()) {
+            t.resume();
+            str += small.pending();
+            small.consume(small.pending().size());
+        }
+        CHECK(str == R"([{"id":0,"name":"item 0"},{"id":1,"name":"item 1"},{"id":2,"name":"item 2"},0])");
+        CHECK(small.bufferSize() > 8);
+    }
+
+    // exceptions are propagated to the consumer
+    {
+        huse::json::AsyncOutput o(64);
+        auto t = produceItems(o, 10, std::numeric_limits<double>::infinity());
+        CHECK_THROWS_AS([&] { while (!t.done()) { t.resume(); o.consume(o.pending().size()); } }(), huse::SerializerException);
+        CHECK(t.done());
+    }
+}
+
 huse::json::DeserializerRoot makeD(std::string_view str)
 {
     return huse::json::DeserializerRoot(str);
@@ -458,118 +1037,1152 @@ TEST_CASE("deserializer exceptions")
     }
 }
 
-TEST_CASE("string i/o")
-{
-    std::string zeroStart = "0starts with zero";
-    zeroStart[0] = 0;
-    std::string midZero = R"(C:\Windows\foo\n\tIndented text\nSomething "else")";
-    midZero += '\0';
-    midZero += "After zero";
-    const std::vector<std::string_view> vec = {
-        "",
-        "simple string",
-        midZero,
-        zeroStart,
-        "\"quoted string\"",
-        "windows newline\r\n",
-        "something\b\t\ff\tu\nn\rk\fy\nor other\t\t\t",
-        (const char*)(
-        u8"\u0417\u0434\u0440\u0430\u0432\u0435\u0439\u002c\u0020\u0441\u0432\u044f"
-        u8"\u0442\u0021\u000d\u000a\u662f\u6307\u5728\u96fb\u8166\u87a2\u5e55\u986f"
-        u8"\u793a\u000d\u000a\u03a0\u03c1\u03cc\u03b3\u03c1\u03b1\u03bc\u03bc\u03b1"
-        u8"\u0020\u0022\u0068\u0065\u006c\u006c\u006f\u0020\u0077\u006f\u0072\u006c"
-        u8"\u0064\u0022\u000d\u000a\u30cf\u30ed\u30fc\u30fb\u30ef\u30fc\u30eb\u30c9"
-        u8"\U0001f34c"
-        ),
-    };
-
-    JsonSerializeTester j;
-    j.compact().val(vec);
-
-    auto json = j.str();
-
-    std::vector<std::string> copy;
-    makeD(json).val(copy);
+template <typename F>
+huse::DeserializerException catchD(F f) {
+    try {
+        f();
+    }
+    catch (huse::DeserializerException& ex) {
+        return ex;
+    }
+    return huse::DeserializerException(huse::ErrorCode::None);
+}
 
-    REQUIRE(vec.size() == copy.size());
-    for (size_t i=0; i<vec.size(); ++i)
+TEST_CASE("deserializer error codes and paths")
+{
+    constexpr std::string_view json = R"({"ar": [2.3, {"x": 1, "y/~": 3.3}, -5], "val": 5})";
     {
-        CHECK(vec[i] == copy[i]);
+        auto ex = catchD([] { makeD(R"({"a": [1, 2,]})"); });
+        CHECK(ex.code() == huse::ErrorCode::Parse);
+        CHECK(ex.inputOffset() == 12);
+        CHECK(ex.path().empty());
+    }
+    {
+        auto ex = catchD([&] { makeD(json).ar(); });
+        CHECK(ex.code() == huse::ErrorCode::NotArray);
+        CHECK(ex.pathSegments().empty());
+        CHECK(ex.path() == "");
+    }
+    {
+        uint32_t u;
+        auto ex = catchD([&] { makeD(json).obj().ar("ar").index(2).val(u); });
+        CHECK(ex.code() == huse::ErrorCode::NegativeInteger);
+        CHECK(std::string(ex.what()) == "negative integer");
+        CHECK(ex.path() == "/ar/2");
+        REQUIRE(ex.pathSegments().size() == 2);
+        CHECK(ex.pathSegments()[0].key == "ar");
+        CHECK(ex.pathSegments()[1].index == 2);
+    }
+    {
+        std::string_view str;
+        auto ex = catchD([&] { makeD(json).obj().ar("ar").index(1).obj().val("y/~", str); });
+        CHECK(ex.code() == huse::ErrorCode::NotString);
+        CHECK(ex.path() == "/ar/1/y~1~0");
+    }
+    {
+        auto ex = catchD([&] { makeD(json).obj().key("zzz"); });
+        CHECK(ex.code() == huse::ErrorCode::KeyNotFound);
+        CHECK(ex.path() == ""); // path to the object
+    }
+    {
+        auto ex = catchD([&] { makeD(json).obj().obj("val"); });
+        CHECK(ex.code() == huse::ErrorCode::NotObject);
+        CHECK(ex.path() == "/val");
+    }
+    {
+        std::nullptr_t n;
+        auto ex = catchD([&] { makeD(json).obj().val("ar", n); });
+        CHECK(ex.code() == huse::ErrorCode::NotNull);
+        CHECK(ex.path() == "/ar");
+    }
+    {
+        auto ex = catchD([&] { makeD(json).obj().ar("ar").index(1).throwException("custom"); });
+        CHECK(ex.code() == huse::ErrorCode::Custom);
+        CHECK(std::string(ex.what()) == "custom");
+        CHECK(ex.path() == "/ar/1");
+    }
+    {
+        // nodes outlive the objects and arrays which they were opened from
+        auto d = makeD(json);
+        auto ar = d.obj().key("ar");
+        auto elem = d.obj().ar("ar").index(1);
+        auto ex = catchD([&] { ar.obj(); });
+        CHECK(ex.code() == huse::ErrorCode::NotObject);
+        CHECK(ex.path() == "/ar");
+        std::string_view str;
+        ex = catchD([&] { elem.obj().val("y/~", str); });
+        CHECK(ex.code() == huse::ErrorCode::NotString);
+        CHECK(ex.path() == "/ar/1/y~1~0");
     }
 }
 
-TEST_CASE("float i/o") {
-    const double nums[] = {
-        1, -3, -0.25, 1e-10, 1e60, 1e-120, // easy
-        1.65, 0.3, 0.333, 3.141592, 3e-121, //tricky
-        27.900001108646396, 0.9689776221127033 // super tricky
+TEST_CASE("validate")
+{
+    // validation must agree with the parser
+    const char* inputs[] = {
+        "{}", "[]", " [ ] ", "[1, 2.5, -3e2, true, false, null]",
+        R"({"a": {"b": [1, {"c": "d"}]}, "e": "\u00e9\ud83d\ude00\n"})",
+        "[12345678901234567890123]", "[-.5]", "[1.]", "[\"\xc3\xa9\"]",
+        "", "  ", "5", "\"str\"", "[", "{", "[1,]", "[,]", "{,}", "[1 2]", "{\"a\" 1}",
+        "{\"a\":}", "{1:2}", "[}", "{]", "[1]]", "[1] x", "[nul]", "[tru]", "[fals]", "[nu",
+        "[-]", "[-x]", "[1e999]", "[\"abc", "[\"\\x\"]", "[\"\\u12g4\"]", "[\"\\ud83d\"]",
+        "[\"\\ud83dxx\"]", "[\"\\ud83d\\u0041\"]", "[\"\x01\"]", "[\"\xc3\"]", "[\"\xc3(\"]", "[\"\xff\"]",
+        "[[[[[[[[[[[[[[[[[[[[]]]]]]]]]]]]]]]]]]]", "[[[[[[[[[[[[[[[[[[[[]]]]]]]]]]]]]]]]]]",
     };
-
-    JsonSerializeTester j;
-    {
-        auto root = j.compact();
-        auto ar = root.ar();
-        for (double d : nums) ar.val(d);
+    for (auto in : inputs) {
+        auto res = huse::json::validate(in);
+        auto doc = huse::json::Parser::parseDocument(in);
+        CHECK(bool(res) == doc.is_valid());
+        if (!doc.is_valid()) {
+            CHECK(res.code == doc._internal_get_error_code());
+            CHECK(res.offset == doc.get_error_offset());
+            CHECK(std::string_view(res.message()) == doc._internal_get_error_text());
+        }
     }
 
-    auto json = j.str();
-    CHECK(json == "[1,-3,-0.25,1e-10,1e+60,1e-120,1.65,0.3,0.333,3.141592,3e-121,27.900001108646396,0.9689776221127033]");
-
-    auto root = makeD(json);
-    auto ar = root.ar();
-    CHECK(ar.size() == int(std::size(nums)));
-    for (int i = 0; i < ar.size(); ++i) {
-        double d;
-        ar.val(d);
-        CHECK(d == nums[i]);
-    }
+    // deeper than the inline structure stack
+    std::string deep = std::string(1000, '[') + std::string(1000, ']');
+    CHECK(huse::json::validate(deep));
+    deep.back() = '}';
+    auto res = huse::json::validate(deep);
+    CHECK(res.code == huse::json::sajson::ERROR_EXPECTED_COMMA);
+    CHECK(res.offset == deep.size() - 1);
 }
 
-struct BigIntegers
-{
-    int32_t min32;
-    int32_t max32;
-    uint32_t maxu32;
-    uint32_t pad = 0; // guarantee that padding bytes don't mess up memcmp
-    int64_t i64_d;
-    uint64_t u64_d;
+struct SaxTrace : public huse::json::SaxHandler {
+    std::string trace;
+    virtual void openObject() override { trace += '{'; }
+    virtual void closeObject() override { trace += '}'; }
+    virtual void openArray() override { trace += '['; }
+    virtual void closeArray() override { trace += ']'; }
+    virtual void key(std::string_view k) override { trace += "k:"; trace += k; trace += ' '; }
+    virtual void stringValue(std::string_view str) override { trace += "s:"; trace += str; trace += ' '; }
+    virtual void integerValue(int64_t i) override { trace += "i:" + std::to_string(i) + ' '; }
+    virtual void floatValue(double d) override { trace += "f:" + std::to_string(d) + ' '; }
+    virtual void boolValue(bool b) override { trace += b ? "true " : "false "; }
+    virtual void nullValue() override { trace += "null "; }
 };
 
-template <typename N, typename B>
-void serializeBI(N& n, B& b)
+TEST_CASE("sax")
 {
-    auto ar = n.ar();
-    ar.val(b.min32);
-    ar.val(b.max32);
-    ar.val(b.maxu32);
-    ar.val(b.i64_d);
-    ar.val(b.u64_d);
+    SaxTrace t;
+    auto res = huse::json::parseSax(
+        R"( {"a": [1, -2, 2.5, 10000000000, 1e2], "b\tc": "x\"y\u00e9\ud83d\ude00", "d": {}, "e": [true, false, null], "f": [[]]} )", t);
+    CHECK(res);
+    CHECK(t.trace ==
+        "{k:a [i:1 i:-2 f:2.500000 i:10000000000 f:100.000000 ]"
+        "k:b\tc s:x\"y\xc3\xa9\xf0\x9f\x98\x80 "
+        "k:d {}k:e [true false null ]k:f [[]]}");
+
+    t.trace.clear();
+    CHECK(huse::json::parseSax("[12345678901234567890123]", t));
+    CHECK(t.trace.starts_with("[f:1234567890123456"));
+
+    // same errors as the validator (and the parser)
+    const char* invalid[] = {"", "5", "[1,]", "{\"a\" 1}", "[\"\\ud83d\"]", "[1] x", "[\"\xc3(\"]"};
+    for (auto in : invalid) {
+        SaxTrace e;
+        auto sres = huse::json::parseSax(in, e);
+        auto vres = huse::json::validate(in);
+        CHECK(!sres);
+        CHECK(sres.code == vres.code);
+        CHECK(sres.offset == vres.offset);
+    }
+
+    // tokens before the error are reported
+    t.trace.clear();
+    res = huse::json::parseSax("[1, 2 3]", t);
+    CHECK(res.code == huse::json::sajson::ERROR_EXPECTED_COMMA);
+    CHECK(t.trace == "[i:1 i:2 ");
+
+    // handler exceptions are propagated
+    struct Thrower : public huse::json::SaxHandler {
+        virtual void nullValue() override { throw std::runtime_error("null"); }
+    } thrower;
+    CHECK_THROWS_WITH_AS(huse::json::parseSax("[1, null]", thrower), "null", std::runtime_error);
 }
 
-TEST_CASE("limit i/o")
+TEST_CASE("transcode")
 {
-    BigIntegers bi = {
-        std::numeric_limits<int32_t>::min(),
-        std::numeric_limits<int32_t>::max(),
-        std::numeric_limits<uint32_t>::max(),
-        0,
-        -9007199254730992ll,
-        9007199254730992ull,
-    };
+    const char* src = R"( {"a" : [1, -2.50, 1e2, 123456789012345678901],
+        "b\tc": "x\"y\u00e9", "d": {}, "e": [true, false, null], "f": [[]]} )";
 
-    JsonSerializeTester j;
+    // json to json: strings and numbers are copied
     {
-        auto root = j.compact();
-        serializeBI(root, bi);
+        JsonSerializerPack p;
+        huse::json::transcode(src, *p.s);
+        CHECK(p.str() == R"({"a":[1,-2.50,1e2,123456789012345678901],"b\tc":"x\"y\u00e9","d":{},"e":[true,false,null],"f":[[]]})");
     }
-
-    const auto json = j.str();
-    CHECK(json == "[-2147483648,2147483647,4294967295,-9007199254730992,9007199254730992]");
-
-    BigIntegers cc;
     {
-        auto d = makeD(json);
-        serializeBI(d, cc);
+        JsonSerializerPack p(true);
+        huse::json::transcode("[1,{\"a\":[]}]", *p.s);
+        CHECK(p.str() == "[\n  1,\n  {\n    \"a\":[]\n  }\n]");
+    }
+
+    // strings are validated (and thus decoded) for strict UTF-8
+    for (auto bad : {"[\"\xed\xa0\x80\"]", "[\"a\xc0\xaf\"]", R"(["\udc00"])"}) {
+        JsonSerializerPack p;
+        p.s->setStrictUtf8(true);
+        CHECK_THROWS_AS(huse::json::transcode(bad, *p.s), huse::SerializerException);
+        CHECK(p.str().back() == ']');
+    }
+    {
+        JsonSerializerPack p;
+        p.s->setStrictUtf8(true);
+        huse::json::transcode(R"(["x\u00e9\n", 1.50])", *p.s);
+        CHECK(p.str() == "[\"x\xc3\xa9\\n\",1.50]");
+    }
+
+    // to another backend: values are decoded
+    {
+        huse::json::DomSerializerRoot s;
+        huse::json::transcode(R"({"b\tc": "x\"y\u00e9", "a": [1, 2.5, null]})", s);
+        huse::json::DeserializerRoot d(s.releaseDocument());
+        auto obj = d.obj();
+        std::string str;
+        obj.val("b\tc", str);
+        CHECK(str == "x\"y\xc3\xa9");
+        auto ar = obj.ar("a");
+        int i;
+        double f;
+        ar.val(i);
+        ar.val(f);
+        CHECK(i == 1);
+        CHECK(f == 2.5);
+        CHECK(ar.val().type().isNull());
+    }
+
+    // errors close the open structures
+    {
+        JsonSerializerPack p;
+        try {
+            huse::json::transcode(R"({"a": [1, {"b": x)", *p.s);
+            CHECK(false);
+        }
+        catch (huse::DeserializerException& ex) {
+            CHECK(ex.code() == huse::ErrorCode::Parse);
+            CHECK(ex.inputOffset() == 16);
+        }
+        CHECK(p.str() == R"({"a":[1,{}]})");
+    }
+}
+
+TEST_CASE("patch")
+{
+    const std::string src = R"( { "a" : [1, "x\"y", {"b": null}, 2.5] , "c~/d": {} ,
+        "e": "\u00e9", "f": true } )";
+    huse::json::Parser p(src, {.sourceSpans = true});
+
+    auto patched = [&](const huse::json::Patch& patch) {
+        std::ostringstream out;
+        patch.apply(p, src, out);
+        return out.str();
+    };
+
+    {
+        huse::json::Patch patch;
+        CHECK(patched(patch) == src);
+
+        patch.set("/a/1", "new");
+        patch.set("/a/2/b", std::vector<int>{1, 2});
+        patch.set("/e", huse::json::RawJson{"5"});
+        patch.set("/c~0~1d/x", 3);
+        patch.set("/c~0~1d/y", false);
+        patch.set("/a/2/z", nullptr);
+        CHECK(patched(patch) == R"( { "a" : [1, "new", {"b": [1,2],"z":null}, 2.5] , "c~/d": {"x":3,"y":false} ,
+        "e": 5, "f": true } )");
+
+        patch.clear();
+        patch.set("/a", huse::json::RawJson{"[]"});
+        patch.set("", huse::json::RawJson{"{}"});
+        CHECK_THROWS_WITH_AS(patched(patch), "overlapping patch edits", huse::DeserializerException);
+
+        patch.clear();
+        patch.set("", huse::json::RawJson{"{}"});
+        CHECK(patched(patch) == " {} ");
+    }
+
+    // large objects have their keys sorted in the AST
+    {
+        std::string big = "{";
+        for (int i = 0; i < 200; ++i) {
+            if (i) big += ", ";
+            big += "\"k" + std::to_string(199 - i) + "\": " + std::to_string(i);
+        }
+        big += "}";
+        huse::json::Parser bp(big, {.sourceSpans = true});
+        huse::json::Patch patch;
+        patch.set("/k150", 1000);
+        std::ostringstream out;
+        patch.apply(bp, big, out);
+        auto expected = big;
+        const std::string_view old = "\"k150\": 49";
+        expected.replace(expected.find(old), old.size(), "\"k150\": 1000");
+        CHECK(out.str() == expected);
+    }
+
+    auto error = [&](const huse::json::Patch& patch) {
+        try {
+            patched(patch);
+        }
+        catch (huse::DeserializerException& ex) {
+            return ex;
+        }
+        return huse::DeserializerException(huse::ErrorCode::None);
+    };
+    {
+        huse::json::Patch patch;
+        patch.set("/a/7", 1);
+        auto ex = error(patch);
+        CHECK(ex.code() == huse::ErrorCode::IndexOutOfBounds);
+        CHECK(ex.path() == "/a/7");
+
+        patch.clear();
+        patch.set("/x/y", 1);
+        ex = error(patch);
+        CHECK(ex.code() == huse::ErrorCode::KeyNotFound);
+        CHECK(ex.path() == "/x");
+
+        patch.clear();
+        patch.set("/f/y", 1);
+        ex = error(patch);
+        CHECK(ex.code() == huse::ErrorCode::NotObject);
+    }
+
+    CHECK_THROWS_AS(huse::json::Patch().set("a", 1), huse::DeserializerException);
+    CHECK_THROWS_AS(huse::json::Patch().set("/a~2", 1), huse::DeserializerException);
+
+    // no spans
+    {
+        huse::json::Parser np(src);
+        huse::json::Patch patch;
+        std::ostringstream out;
+        CHECK_THROWS_WITH_AS(patch.apply(np, src, out), "source not available", huse::DeserializerException);
+    }
+}
+
+TEST_CASE("pointer")
+{
+    using huse::json::Pointer;
+    const std::string json = R"({"a": [1, {"b": "x"}, 3], "c~/d": 5, "": {"0": true}, "e": {"f": null, "g": 2}})";
+
+    {
+        huse::json::Parser p(json);
+        auto root = p.rootValue();
+
+        auto v = Pointer("/a/1/b").find(root);
+        REQUIRE(v);
+        CHECK(v->as_cstring() == std::string_view("x"));
+        v = Pointer("/c~0~1d").find(root);
+        REQUIRE(v);
+        CHECK(v->get_integer_value() == 5);
+        v = Pointer("//0").find(root);
+        REQUIRE(v);
+        CHECK(v->get_type() == huse::json::sajson::TYPE_TRUE);
+        v = Pointer().find(root);
+        REQUIRE(v);
+        CHECK(v->get_type() == huse::json::sajson::TYPE_OBJECT);
+
+        CHECK_FALSE(Pointer("/a/3").find(root));
+        CHECK_FALSE(Pointer("/a/01").find(root));
+        CHECK_FALSE(Pointer("/a/-").find(root));
+        CHECK_FALSE(Pointer("/x").find(root));
+        CHECK_FALSE(Pointer("/c~0~1d/x").find(root));
+    }
+
+    CHECK(Pointer("/a/10/~1").segments()[1].index == 10);
+    CHECK(Pointer("/a/10/~1").segments()[2].key == "/");
+    CHECK(Pointer("/a/-1").segments()[1].index == -1);
+    CHECK_THROWS_AS(Pointer("a"), huse::DeserializerException);
+    CHECK_THROWS_AS(Pointer("/a~"), huse::DeserializerException);
+
+    {
+        auto d = makeD(json);
+        int i;
+        Pointer("/a/2").at(d).val(i);
+        CHECK(i == 3);
+        std::string_view str;
+        Pointer("/a/1/b").at(d).val(str);
+        CHECK(str == "x");
+
+        CHECK(Pointer("/e/g").find(d));
+        CHECK_FALSE(Pointer("/e/h").find(d));
+        CHECK_FALSE(Pointer("/e/f/h").find(d));
+        CHECK_FALSE(Pointer("/a/5").find(d));
+
+        auto error = [&](std::string_view pointer) {
+            try {
+                Pointer(pointer).at(d);
+            }
+            catch (huse::DeserializerException& ex) {
+                return ex;
+            }
+            return huse::DeserializerException(huse::ErrorCode::None);
+        };
+        auto ex = error("/e/h");
+        CHECK(ex.code() == huse::ErrorCode::KeyNotFound);
+        CHECK(ex.path() == "/e");
+        ex = error("/a/5");
+        CHECK(ex.code() == huse::ErrorCode::IndexOutOfBounds);
+        CHECK(ex.path() == "/a");
+        ex = error("/c~0~1d/x");
+        CHECK(ex.code() == huse::ErrorCode::NotObject);
+    }
+
+    // batches
+    {
+        const std::vector<Pointer> pointers = {
+            Pointer("/e/f"), Pointer("/a/1/b"), Pointer("/e/x"), Pointer("/a/0"), Pointer("/e/g"), Pointer("/e"), Pointer("/a/1/b")
+        };
+        huse::json::PointerBatch batch(pointers);
+        CHECK(batch.size() == 7);
+        CHECK(batch.add(Pointer("/q")) == 7);
+
+        huse::json::Parser p(json);
+        std::vector<std::optional<huse::ImValue>> res(batch.size());
+        batch.find(p.rootValue(), res);
+        REQUIRE(res[0]);
+        CHECK(res[0]->get_type() == huse::json::sajson::TYPE_NULL);
+        REQUIRE(res[1]);
+        CHECK(res[1]->as_cstring() == std::string_view("x"));
+        CHECK_FALSE(res[2]);
+        REQUIRE(res[3]);
+        CHECK(res[3]->get_integer_value() == 1);
+        REQUIRE(res[4]);
+        CHECK(res[4]->get_integer_value() == 2);
+        REQUIRE(res[5]);
+        CHECK(res[5]->get_type() == huse::json::sajson::TYPE_OBJECT);
+        REQUIRE(res[6]);
+        CHECK(res[6]->as_cstring() == std::string_view("x"));
+        CHECK_FALSE(res[7]);
+
+        auto d = makeD(json);
+        auto nodes = batch.find(d);
+        REQUIRE(nodes.size() == 8);
+        CHECK_FALSE(nodes[2]);
+        CHECK_FALSE(nodes[7]);
+        int i;
+        nodes[4]->val(i);
+        CHECK(i == 2);
+        std::string_view str;
+        nodes[6]->val(str);
+        CHECK(str == "x");
+    }
+
+    // in document order the cursor finds all keys
+    {
+        auto d = makeD(R"({"a": 1, "b": 2, "c": {"x": 3, "y": 4}, "d": 5})");
+        huse::json::PointerBatch batch;
+        for (auto p : {"/a", "/c/x", "/c/y", "/d"}) {
+            batch.add(Pointer(p));
+        }
+        auto nodes = batch.find(d);
+        int i;
+        nodes[3]->val(i);
+        CHECK(i == 5);
+        if constexpr (huse::Instrumentation_Enabled) {
+            CHECK(d.stats().keyLookups == 5);
+            CHECK(d.stats().linearKeySearches == 1); // skipping "b"
+        }
+    }
+}
+
+TEST_CASE("projection")
+{
+    using huse::json::Projection;
+    using huse::json::ParseOptions;
+    const std::string json = R"({"s" : "a\"}]" , "id": 5, "big": {"x": [1, {"]": "}"}]},
+        "items": [{"price": 1, "name": "x"}, {"junk": [tru], "price": 2.5}, 7],
+        "k\u0041": -3e2 , "arr": [1, [2], 3], "bad": [nul]})";
+
+    {
+        const Projection proj = {"/id", "/items/*/price", "/kA", "/arr/1"};
+        huse::json::DeserializerRoot d(json, ParseOptions{.projection = &proj});
+        auto obj = d.obj();
+        CHECK(obj.size() == 4);
+        int i;
+        obj.val("id", i);
+        CHECK(i == 5);
+        double f;
+        obj.val("kA", f);
+        CHECK(f == -300);
+        CHECK_FALSE(obj.optkey("s"));
+        CHECK_FALSE(obj.optkey("big"));
+        CHECK_THROWS_WITH_AS(obj.key("bad"), "key not found in object", huse::DeserializerException);
+
+        auto items = obj.ar("items");
+        CHECK(items.size() == 3);
+        {
+            auto item = items.obj();
+            CHECK(item.size() == 1);
+            item.val("price", f);
+            CHECK(f == 1);
+            CHECK_FALSE(item.optkey("name"));
+        }
+        {
+            auto item = items.obj();
+            CHECK(item.size() == 1);
+            item.val("price", f);
+            CHECK(f == 2.5);
+        }
+        CHECK(items.index(2).type().isInteger()); // scalars on a path are parsed
+
+        // other elements are null
+        auto arr = obj.ar("arr");
+        CHECK(arr.size() == 3);
+        CHECK(arr.index(0).type().isNull());
+        CHECK(arr.index(1).type().isArray());
+        CHECK(arr.index(2).type().isNull());
+    }
+
+    // errors in projected values
+    {
+        const Projection proj = {"/bad"};
+        CHECK_THROWS_AS(huse::json::Parser(json, {.projection = &proj}), huse::DeserializerException);
+    }
+    {
+        const Projection proj = {"/items/1"};
+        CHECK_THROWS_AS(huse::json::Parser(json, {.projection = &proj}), huse::DeserializerException);
+    }
+
+    // wildcards only match what isn't matched otherwise
+    {
+        const Projection proj = {"/items/*/price", "/items/1/junk/5", "/big/x"};
+        huse::json::Parser p(R"({"items": [{"price": 1}, {"price": 2, "junk": []}], "big": {"x": [1, {"]": "}"}]}})",
+            {.projection = &proj});
+        auto items = p.rootValue().get_value_of_key({"items", 5});
+        CHECK(items.get_array_element(0).get_length() == 1);
+        CHECK(items.get_array_element(1).get_length() == 1);
+        CHECK(items.get_array_element(1).get_object_key(0) == "junk");
+        auto x = p.rootValue().get_value_of_key({"big", 3}).get_value_of_key({"x", 1});
+        CHECK(x.get_length() == 2);
+    }
+
+    // the root is everything
+    {
+        const Projection proj = {""};
+        huse::json::Parser p(R"({"a": 1, "b": [2]})", {.projection = &proj});
+        CHECK(p.rootValue().get_length() == 2);
+    }
+
+    // lazy values at the ends of paths
+    {
+        const Projection proj = {"/big", "/items/0"};
+        huse::json::DeserializerRoot d(json, ParseOptions{.lazy = true, .projection = &proj});
+        auto obj = d.obj();
+        CHECK(obj.size() == 2);
+        int i;
+        obj.obj("big").ar("x").val(i);
+        CHECK(i == 1);
+        obj.ar("items").obj().val("price", i);
+        CHECK(i == 1);
+    }
+}
+
+TEST_CASE("lazy")
+{
+    constexpr std::string_view json = R"({
+        "a": 1,
+        "big": {"x": [1, 2, {"y": "]}\"["}], "z": {}},
+        "arr": [[1, 2], [3]],
+        "e": [],
+        "deep": {"d": ["a\"b", nul]},
+        "bad": {"q": tru}
+    })";
+
+    CHECK_THROWS_AS(makeD(json), huse::DeserializerException);
+
+    huse::json::DeserializerRoot d(json, huse::json::ParseOptions{.lazy = true});
+    auto& lazyDocs = d.jsonParser().lazyDocuments;
+    auto obj = d.obj();
+
+    int i;
+    obj.val("a", i);
+    CHECK(i == 1);
+    CHECK(obj.key("big").type().isObject());
+    CHECK(obj.key("arr").type().isArray());
+    CHECK(lazyDocs.empty());
+
+    {
+        auto big = obj.obj("big");
+        CHECK(lazyDocs.size() == 1);
+        CHECK(big.size() == 2);
+        auto x = big.ar("x");
+        CHECK(lazyDocs.size() == 2);
+        x.val(i);
+        CHECK(i == 1);
+        x.val(i);
+        CHECK(i == 2);
+        std::string_view y;
+        x.obj().val("y", y);
+        CHECK(y == R"(]}"[)");
+        CHECK(big.obj("z").size() == 0);
+        CHECK(lazyDocs.size() == 3); // z is empty, so not lazy
+
+        // values nested deeper than the root are parsed in place in the copy of the source
+        // of the value of the root which contains them
+        auto within = [](const huse::json::sajson::document& inner, const huse::json::sajson::document& outer) {
+            auto i = inner._internal_get_input();
+            auto o = outer._internal_get_input();
+            return i.get_data() > o.get_data() && i.get_data() + i.length() <= o.get_data() + o.length();
+        };
+        CHECK(within(lazyDocs[1], lazyDocs[0]));
+        CHECK(within(lazyDocs[2], lazyDocs[1]));
+
+        // their source remains intact
+        huse::json::RawJson raw;
+        big.val("x", raw);
+        CHECK(raw.str == R"([1, 2, {"y": "]}\"["}])");
+    }
+
+    {
+        // parsed values are reused
+        auto big = obj.obj("big");
+        CHECK(lazyDocs.size() == 3);
+        auto ex = catchD([&] { big.ar("x").index(2).obj().val("y", i); });
+        CHECK(ex.code() == huse::ErrorCode::NotInteger);
+        CHECK(ex.path() == "/big/x/2/y");
+    }
+
+    std::vector<std::vector<int>> arr;
+    obj.val("arr", arr);
+    CHECK(arr == std::vector<std::vector<int>>{{1, 2}, {3}});
+
+    CHECK(obj.ar("e").size() == 0);
+
+    // a failed parse in place is reported in the same way every time
+    for (int n = 0; n < 2; ++n) {
+        auto deepEx = catchD([&] { obj.obj("deep").ar("d"); });
+        CHECK(deepEx.code() == huse::ErrorCode::Parse);
+        CHECK(deepEx.path() == "/deep/d");
+        CHECK(deepEx.inputOffset() == json.find("nul"));
+    }
+
+    auto ex = catchD([&] { obj.obj("bad"); });
+    CHECK(ex.code() == huse::ErrorCode::Parse);
+    CHECK(ex.path() == "/bad");
+    CHECK(ex.inputOffset() == json.find("tru"));
+
+    // unbalanced structures are still errors
+    CHECK_THROWS_AS(huse::json::DeserializerRoot(R"({"a": [1, 2})", huse::json::ParseOptions{.lazy = true}), huse::DeserializerException);
+}
+
+TEST_CASE("lazy numbers")
+{
+    const std::string json = R"({"i": -42, "big": 18446744073709551615, "min": -9223372036854775808,
+        "d": 2.5, "e": 1e3, "f": 0.1, "huge": 123456789012345678901234, "inf": 1e999, "b": true, "a": [1, -2.5e-3]})";
+    huse::json::DeserializerRoot d(json, huse::json::ParseOptions{.lazyNumbers = true});
+    auto obj = d.obj();
+
+    CHECK(obj.key("i").type().isInteger());
+    CHECK(obj.key("big").type().isFloat()); // like the converted ones: doesn't fit in 32 bits
+    CHECK(obj.key("d").type().isFloat());
+
+    // the types are the same as the ones of the converted numbers
+    {
+        constexpr std::string_view nums = "[2147483647, -2147483648, 2147483648, -2147483649, 123456789, -0, 1.0, 1e2]";
+        huse::json::Parser lazy(nums, {.lazyNumbers = true});
+        auto lazyRoot = lazy.rootValue();
+        huse::json::Parser eager(nums);
+        auto eagerRoot = eager.rootValue();
+        for (size_t n = 0; n < eagerRoot.get_length(); ++n) {
+            CHECK(lazyRoot.get_array_element(n).is_raw_number());
+            CHECK(lazyRoot.get_array_element(n).get_type() == eagerRoot.get_array_element(n).get_type());
+        }
+        CHECK(eagerRoot.get_array_element(1).get_type() == huse::json::sajson::TYPE_INTEGER);
+        CHECK(eagerRoot.get_array_element(2).get_type() == huse::json::sajson::TYPE_DOUBLE);
+    }
+
+    int i;
+    obj.val("i", i);
+    CHECK(i == -42);
+    uint64_t u64;
+    obj.val("big", u64);
+    CHECK(u64 == 18446744073709551615ull); // exact
+    int64_t i64;
+    obj.val("min", i64);
+    CHECK(i64 == std::numeric_limits<int64_t>::min());
+    double dbl;
+    obj.val("d", dbl);
+    CHECK(dbl == 2.5);
+    obj.val("e", i64);
+    CHECK(i64 == 1000);
+    float f;
+    obj.val("f", f);
+    CHECK(f == 0.1f); // directly to float
+    obj.val("huge", dbl);
+    CHECK(dbl == 123456789012345678901234.0);
+    bool b;
+    obj.val("b", b);
+    CHECK(b);
+    std::vector<double> a;
+    obj.val("a", a);
+    CHECK(a == std::vector<double>{1, -2.5e-3});
+
+    auto code = [&](auto&& f) {
+        try {
+            f();
+        }
+        catch (huse::DeserializerException& ex) {
+            return ex.code();
+        }
+        return huse::ErrorCode::None;
+    };
+    CHECK(code([&] { obj.val("d", i); }) == huse::ErrorCode::NotInteger);
+    CHECK(code([&] { obj.val("d", i64); }) == huse::ErrorCode::NotInteger);
+    CHECK(code([&] { obj.val("big", i); }) == huse::ErrorCode::NotInteger);
+    CHECK(code([&] { obj.val("huge", u64); }) == huse::ErrorCode::IntegerTooBig);
+    CHECK(code([&] { obj.val("inf", dbl); }) == huse::ErrorCode::NotNumber);
+    CHECK(code([&] { obj.val("i", u64); }) == huse::ErrorCode::NegativeInteger);
+    CHECK(code([&] { obj.val("b", i); }) == huse::ErrorCode::NotInteger);
+
+    huse::json::RawJson raw;
+    obj.val("e", raw);
+    CHECK(raw.str == "1e3");
+
+    // the numbers are still validated, with the same grammar as the converted ones
+    for (auto bad : {R"([1.])", R"([-])", R"([1e])", R"([.5])", R"([1e+])", R"([01])", R"([-01.5])", R"([1.e3])", R"({"a": 1)"}) {
+        CHECK_THROWS_AS(huse::json::Parser(bad, {.lazyNumbers = true}), huse::DeserializerException);
+        CHECK_THROWS_AS((void)huse::json::Parser(bad), huse::DeserializerException);
+    }
+    for (auto good : {R"([0])", R"([-0])", R"([0.5])", R"([-0e-1])", R"([10E+2])"}) {
+        CHECK_NOTHROW((void)huse::json::Parser(good, {.lazyNumbers = true}));
+        CHECK_NOTHROW((void)huse::json::Parser(good));
+    }
+
+    // in lazy values
+    {
+        huse::json::DeserializerRoot ld(R"({"x": {"y": 4294967295}})", huse::json::ParseOptions{.lazy = true, .lazyNumbers = true});
+        uint32_t u32;
+        ld.obj().obj("x").val("y", u32);
+        CHECK(u32 == 4294967295u);
+    }
+
+    // in caches
+    {
+        huse::json::Parser p(R"({"n": [7, 0.5]})", {.lazyNumbers = true});
+        std::stringstream cache;
+        huse::json::saveDocumentCache(p, cache);
+        const auto str = cache.str();
+        std::vector<huse::json::sajson::ast_word> buf(str.size() / sizeof(huse::json::sajson::ast_word) + 1);
+        memcpy(buf.data(), str.data(), str.size());
+        huse::json::DeserializerRoot cd(huse::json::loadDocumentCache(buf.data(), str.size()));
+        std::vector<double> n;
+        cd.obj().val("n", n);
+        CHECK(n == std::vector<double>{7, 0.5});
+    }
+}
+
+TEST_CASE("lazy strings")
+{
+    const std::string json = R"({"plain": "abc", "esc": "a\"b\\c\n", "u": "\u00e9\ud83d\ude00", "utf8": "né",
+        "bad": "x\q", "arr": ["\t", "y"]})";
+    huse::json::DeserializerRoot d(json, huse::json::ParseOptions{.lazyStrings = true});
+    auto obj = d.obj();
+
+    // strings which need no work (without escapes) are plain
+    auto root = d.getRootValue();
+    auto value = [&](std::string_view key) { return root.get_object_value(root.find_object_key(key)); };
+    CHECK_FALSE(value("plain").is_raw_string());
+    CHECK(value("esc").is_raw_string());
+    CHECK_FALSE(value("utf8").is_raw_string());
+    CHECK(obj.key("esc").type().isString());
+
+    // views need a deserializer to unescape them
+    std::string_view direct;
+    CHECK(value("esc").readValue(direct) == huse::ErrorCode::NotUnescaped);
+
+    // forwarded without unescaping
+    huse::json::RawJson raw;
+    obj.val("u", raw);
+    CHECK(raw.str == R"("\u00e9\ud83d\ude00")");
+    obj.val("bad", raw);
+    CHECK(raw.str == R"("x\q")");
+
+    auto code = [&](auto&& f) {
+        try {
+            f();
+        }
+        catch (huse::DeserializerException& ex) {
+            return ex.code();
+        }
+        return huse::ErrorCode::None;
+    };
+
+    std::string_view sv;
+    obj.val("plain", sv);
+    CHECK(sv == "abc");
+    obj.val("esc", sv);
+    CHECK(sv == "a\"b\\c\n");
+    std::string_view again;
+    obj.val("esc", again);
+    CHECK(again.data() == sv.data()); // unescaped once
+    // in place in the input, so the source is gone
+    CHECK(sv.data() == value("esc")._internal_get_text() + value("esc")._internal_get_payload()[0]);
+    CHECK(code([&] { obj.val("esc", raw); }) == huse::ErrorCode::NoSource);
+    obj.val("u", sv);
+    CHECK(sv == "\xc3\xa9\xf0\x9f\x98\x80");
+    obj.val("utf8", sv);
+    CHECK(sv == "né");
+
+    std::string str;
+    obj.val("esc", str);
+    CHECK(str == "a\"b\\c\n");
+    std::vector<std::string> arr;
+    obj.val("arr", arr);
+    CHECK(arr == std::vector<std::string>{"\t", "y"});
+
+    // errors are reported when read
+    CHECK(code([&] { obj.val("bad", sv); }) == huse::ErrorCode::Parse);
+    CHECK(code([&] { obj.val("bad", sv); }) == huse::ErrorCode::Parse); // and when read again
+    CHECK(code([&] { obj.val("bad", str); }) == huse::ErrorCode::Parse);
+
+    // but the structure is validated
+    for (auto bad : {R"(["a\"])", "[\"a\nb\"]", "[\"\xc3\xa9\nb\"]", R"(["a\)"}) {
+        CHECK_THROWS_AS(huse::json::Parser(bad, {.lazyStrings = true}), huse::DeserializerException);
+    }
+
+    // and UTF-8 is validated like by eager parses
+    for (auto bad : {"[\"a\xff b\"]", "[\"a\xc3\"]", "[\"\xe2\x82\"]", "[\"\\n\xc3\"]", "[\"\xc3\\\\\"]", "[\"\xf8\x80\"]"}) {
+        CHECK_THROWS_AS((void)huse::json::Parser(bad), huse::DeserializerException);
+        CHECK_THROWS_AS(huse::json::Parser(bad, {.lazyStrings = true}), huse::DeserializerException);
+    }
+    for (auto good : {"[\"\xc3\xa9\"]", "[\"\\n\xe2\x82\xac\"]", "[\"\xf0\x9f\x98\x80\\\\\"]"}) {
+        (void)huse::json::Parser(good);
+        huse::json::DeserializerRoot ld(good, huse::json::ParseOptions{.lazyStrings = true});
+        std::vector<std::string> lazyRead;
+        ld.val(lazyRead);
+        std::vector<std::string> eagerRead;
+        huse::json::DeserializerRoot(good).val(eagerRead);
+        CHECK(lazyRead == eagerRead);
+    }
+
+    // in lazy values
+    {
+        huse::json::DeserializerRoot ld(R"({"x": {"y": "a\/b"}})", huse::json::ParseOptions{.lazy = true, .lazyStrings = true});
+        ld.obj().obj("x").val("y", sv);
+        CHECK(sv == "a/b");
+    }
+
+    // shared documents are immutable
+    {
+        auto p = std::make_shared<huse::json::Parser>(R"({"a": "1\n", "b": "2\n"})", huse::json::ParseOptions{.lazyStrings = true});
+        auto proot = p->rootValue();
+        p->unescapeString(proot.get_object_value(proot.find_object_key("a")));
+        huse::json::DeserializerRoot sd{std::shared_ptr<const huse::json::Parser>(p)};
+        auto sobj = sd.obj();
+        sobj.val("a", sv);
+        CHECK(sv == "1\n");
+        CHECK(code([&] { sobj.val("b", sv); }) == huse::ErrorCode::SharedLazy);
+        sobj.val("b", str);
+        CHECK(str == "2\n");
+    }
+
+    // and can't be cached
+    {
+        huse::json::Parser p(R"(["\n"])", {.lazyStrings = true});
+        std::stringstream cache;
+        CHECK(code([&] { huse::json::saveDocumentCache(p, cache); }) == huse::ErrorCode::BadCache);
+    }
+}
+
+TEST_CASE("strict utf8")
+{
+    const std::string valid = "n\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80 \xef\xbf\xbf \xf4\x8f\xbf\xbf";
+    const std::string invalid[] = {
+        "\xc0\xaf", // overlong
+        "\xe0\x80\xaf", // overlong
+        "\xed\xa0\x80", // surrogate
+        "\xf4\x90\x80\x80", // above U+10FFFF
+        "\xf5\x80\x80\x80",
+        "\xbf\xbf", // continuation bytes
+        "\xe2\x82", // incomplete
+    };
+
+    auto code = [&](auto&& f) {
+        try {
+            f();
+        }
+        catch (huse::Exception& ex) {
+            return ex.code();
+        }
+        return huse::ErrorCode::None;
+    };
+
+    // parser
+    {
+        const huse::json::ParseOptions strict = {.strictUtf8 = true};
+        const std::string json = R"({")" + valid + R"(": [")" + valid + R"(\n"]})";
+        huse::json::DeserializerRoot d(json, strict);
+        std::vector<std::string> v;
+        d.obj().val(valid, v);
+        CHECK(v == std::vector<std::string>{valid + "\n"});
+
+        for (auto& bad : invalid) {
+            // after enough ascii to be skipped a word at a time
+            const std::string prefix = "[\"some ascii text \", \"a\\nb ";
+            const std::string json = prefix + bad + "\"]";
+            try {
+                huse::json::Parser p(json, strict);
+                CHECK(false);
+            }
+            catch (huse::DeserializerException& ex) {
+                CHECK(ex.code() == huse::ErrorCode::Parse);
+                CHECK(ex.inputOffset() >= prefix.size());
+            }
+            CHECK(code([&] { huse::json::Parser p("{\"" + bad + "\": 1}", strict); }) == huse::ErrorCode::Parse);
+
+            // also in strings which are not unescaped
+            CHECK(code([&] {
+                huse::json::Parser(json, {.lazyStrings = true, .strictUtf8 = true});
+            }) == huse::ErrorCode::Parse);
+
+            // and in lazy values when they are parsed
+            huse::json::DeserializerRoot ld("[[\"" + bad + "\"]]", huse::json::ParseOptions{.lazy = true, .strictUtf8 = true});
+            CHECK(code([&] { ld.ar().ar(); }) == huse::ErrorCode::Parse);
+        }
+    }
+
+    // serializer
+    {
+        JsonSerializerPack pack;
+        pack.s->setStrictUtf8(true);
+        pack.node().val(valid);
+        CHECK(pack.str() == '"' + valid + '"');
+
+        for (auto& bad : invalid) {
+            JsonSerializerPack loose;
+            loose.node().val(bad);
+            CHECK(loose.str() == '"' + bad + '"');
+
+            JsonSerializerPack strict;
+            strict.s->setStrictUtf8(true);
+            CHECK(code([&] { strict.node().val("ascii text \"before\" it " + bad); }) == huse::ErrorCode::InvalidUtf8);
+        }
+
+        // string streams can split sequences
+        {
+            JsonSerializerPack sp;
+            sp.s->setStrictUtf8(true);
+            {
+                auto root = sp.node();
+                auto s = root.open(huse::StringStream{});
+                s << "\xe2";
+                s.get().put('\x82');
+                s << "\xac\n";
+            }
+            CHECK(sp.str() == "\"\xe2\x82\xac\\n\"");
+        }
+        {
+            JsonSerializerPack sp;
+            sp.s->setStrictUtf8(true);
+            auto root = sp.node();
+            auto s = root.open(huse::StringStream{});
+            CHECK(code([&] { s << "\xe2\x82x"; }) == huse::ErrorCode::InvalidUtf8);
+        }
+    }
+}
+
+TEST_CASE("raw json")
+{
+    constexpr std::string_view json = R"({"id": 5, "payload": { "x" : [1, 2,3], "s": "a\nb" }, "list": [ {"y": 1} ,[]], "e": [ ], "s": "str"})";
+    huse::json::DeserializerRoot d(json, huse::json::ParseOptions{.lazy = true});
+    auto obj = d.obj();
+
+    huse::json::RawJson raw;
+    obj.val("payload", raw);
+    CHECK(raw.str == R"({ "x" : [1, 2,3], "s": "a\nb" })");
+    CHECK(raw.str.data() != json.data() + json.find('{', 1)); // the parser has its own copy of the input
+
+    // the source remains intact after the value is parsed
+    std::string_view s;
+    obj.obj("payload").val("s", s);
+    CHECK(s == "a\nb");
+    obj.val("payload", raw);
+    CHECK(raw.str == R"({ "x" : [1, 2,3], "s": "a\nb" })");
+
+    {
+        auto list = obj.ar("list");
+        list.val(raw);
+        CHECK(raw.str == R"({"y": 1})");
+        list.val(raw);
+        CHECK(raw.str == "[]");
+    }
+
+    obj.val("e", raw);
+    CHECK(raw.str == "[]");
+
+    auto ex = catchD([&] { obj.val("s", raw); });
+    CHECK(ex.code() == huse::ErrorCode::NoSource);
+    CHECK(ex.path() == "/s");
+
+    // forward
+    std::ostringstream out;
+    {
+        huse::json::SerializerRoot s(out);
+        auto o = s.obj();
+        obj.val("payload", raw);
+        o.val("fwd", raw);
+    }
+    CHECK(out.str() == R"({"fwd":{ "x" : [1, 2,3], "s": "a\nb" }})");
+}
+
+struct TryTest {
+    int a = 0;
+    std::vector<int> b;
+
+    void huseDeserialize(huse::DeserializerNode<huse::json::JsonDeserializer>& n) {
+        auto obj = n.obj();
+        obj.val("a", a);
+        obj.val("b", b);
+    }
+};
+
+TEST_CASE("tryDeserialize")
+{
+    {
+        TryTest t;
+        auto r = huse::json::tryDeserialize(R"({"a": 5, "b": [1, 2]})", t);
+        CHECK(r);
+        CHECK(t.a == 5);
+        CHECK(t.b == std::vector<int>{1, 2});
+    }
+    {
+        TryTest t;
+        auto r = huse::json::tryDeserialize(R"({"a": 5, "b": [1, )", t);
+        REQUIRE_FALSE(r);
+        CHECK(r.error().code() == huse::ErrorCode::Parse);
+        CHECK(r.error().inputOffset() == 18);
+    }
+    {
+        TryTest t;
+        auto r = huse::json::tryDeserialize(R"({"a": 5, "b": [1, "x"]})", t);
+        REQUIRE_FALSE(r);
+        CHECK(r.error().code() == huse::ErrorCode::NotInteger);
+        CHECK(r.error().path() == "/b/1");
+    }
+    {
+        char json[] = R"({"a": 7, "b": []})";
+        TryTest t;
+        auto r = huse::json::tryDeserialize(json, sizeof(json) - 1, t);
+        CHECK(r);
+        CHECK(t.a == 7);
+        CHECK(t.b.empty());
+    }
+}
+
+TEST_CASE("string i/o")
+{
+    std::string zeroStart = "0starts with zero";
+    zeroStart[0] = 0;
+    std::string midZero = R"(C:\Windows\foo\n\tIndented text\nSomething "else")";
+    midZero += '\0';
+    midZero += "After zero";
+    const std::vector<std::string_view> vec = {
+        "",
+        "simple string",
+        midZero,
+        zeroStart,
+        "\"quoted string\"",
+        "windows newline\r\n",
+        "something\b\t\ff\tu\nn\rk\fy\nor other\t\t\t",
+        (const char*)(
+        u8"\u0417\u0434\u0440\u0430\u0432\u0435\u0439\u002c\u0020\u0441\u0432\u044f"
+        u8"\u0442\u0021\u000d\u000a\u662f\u6307\u5728\u96fb\u8166\u87a2\u5e55\u986f"
+        u8"\u793a\u000d\u000a\u03a0\u03c1\u03cc\u03b3\u03c1\u03b1\u03bc\u03bc\u03b1"
+        u8"\u0020\u0022\u0068\u0065\u006c\u006c\u006f\u0020\u0077\u006f\u0072\u006c"
+        u8"\u0064\u0022\u000d\u000a\u30cf\u30ed\u30fc\u30fb\u30ef\u30fc\u30eb\u30c9"
+        u8"\U0001f34c"
+        ),
+    };
+
+    JsonSerializeTester j;
+    j.compact().val(vec);
+
+    auto json = j.str();
+
+    std::vector<std::string> copy;
+    makeD(json).val(copy);
+
+    REQUIRE(vec.size() == copy.size());
+    for (size_t i=0; i<vec.size(); ++i)
+    {
+        CHECK(vec[i] == copy[i]);
+    }
+}
+
+TEST_CASE("float i/o") {
+    const double nums[] = {
+        1, -3, -0.25, 1e-10, 1e60, 1e-120, // easy
+        1.65, 0.3, 0.333, 3.141592, 3e-121, //tricky
+        27.900001108646396, 0.9689776221127033 // super tricky
+    };
+
+    JsonSerializeTester j;
+    {
+        auto root = j.compact();
+        auto ar = root.ar();
+        for (double d : nums) ar.val(d);
+    }
+
+    auto json = j.str();
+    CHECK(json == "[1,-3,-0.25,1e-10,1e+60,1e-120,1.65,0.3,0.333,3.141592,3e-121,27.900001108646396,0.9689776221127033]");
+
+    auto root = makeD(json);
+    auto ar = root.ar();
+    CHECK(ar.size() == int(std::size(nums)));
+    for (int i = 0; i < ar.size(); ++i) {
+        double d;
+        ar.val(d);
+        CHECK(d == nums[i]);
+    }
+}
+
+struct BigIntegers
+{
+    int32_t min32;
+    int32_t max32;
+    uint32_t maxu32;
+    uint32_t pad = 0; // guarantee that padding bytes don't mess up memcmp
+    int64_t i64_d;
+    uint64_t u64_d;
+};
+
+template <typename N, typename B>
+void serializeBI(N& n, B& b)
+{
+    auto ar = n.ar();
+    ar.val(b.min32);
+    ar.val(b.max32);
+    ar.val(b.maxu32);
+    ar.val(b.i64_d);
+    ar.val(b.u64_d);
+}
+
+TEST_CASE("limit i/o")
+{
+    BigIntegers bi = {
+        std::numeric_limits<int32_t>::min(),
+        std::numeric_limits<int32_t>::max(),
+        std::numeric_limits<uint32_t>::max(),
+        0,
+        -9007199254730992ll,
+        9007199254730992ull,
+    };
+
+    JsonSerializeTester j;
+    {
+        auto root = j.compact();
+        serializeBI(root, bi);
+    }
+
+    const auto json = j.str();
+    CHECK(json == "[-2147483648,2147483647,4294967295,-9007199254730992,9007199254730992]");
+
+    BigIntegers cc;
+    {
+        auto d = makeD(json);
+        serializeBI(d, cc);
     }
 
     CHECK(memcmp(&bi, &cc, sizeof(BigIntegers)) == 0);
@@ -853,3 +2466,405 @@ TEST_CASE("stream i/o")
     CHECK(mvs.b.x == cc.b.x);
     CHECK(mvs.b.y == cc.b.y);
 }
+
+struct InstrumentationTest
+{
+    int a = 0;
+    std::vector<int> b;
+
+    void huseDeserialize(huse::DeserializerNode<huse::json::JsonDeserializer>& n)
+    {
+        auto o = n.obj();
+        o.val("a", a);
+        o.val("b", b);
+        std::string_view s;
+        o.val("s", s); // skips "c"
+        int none;
+        CHECK_FALSE(o.optval("none", none));
+    }
+};
+
+TEST_CASE("instrumentation")
+{
+    std::ostringstream sout;
+    {
+        huse::json::SerializerRoot s(sout);
+        {
+            auto obj = s.obj();
+            obj.val("a", 1);
+            {
+                auto ar = obj.ar("b");
+                ar.val(2);
+                ar.val(3);
+            }
+            obj.obj("c").ar("d");
+            obj.key("s").open(huse::StringStream{}) << "q\n";
+        }
+
+        auto& stats = s.stats();
+        if constexpr (huse::Instrumentation_Enabled) {
+            CHECK(stats.bytesWritten == sout.str().size());
+            CHECK(stats.values == 3);
+            CHECK(stats.objects == 2);
+            CHECK(stats.arrays == 2);
+            CHECK(stats.maxDepth == 3);
+            CHECK(stats.stringStreamOpens == 1);
+        }
+        else {
+            CHECK(stats.bytesWritten == 0);
+            CHECK(stats.values == 0);
+        }
+    }
+
+    const auto json = sout.str();
+    CHECK(json == R"({"a":1,"b":[2,3],"c":{"d":[]},"s":"q\n"})");
+
+    huse::json::DeserializerRoot d(json);
+    InstrumentationTest t;
+    d.val(t);
+    CHECK(t.a == 1);
+    CHECK(t.b == std::vector<int>{2, 3});
+
+    auto& stats = d.stats();
+    if constexpr (huse::Instrumentation_Enabled) {
+        CHECK(stats.bytesRead == json.size());
+        CHECK(stats.values == 4);
+        CHECK(stats.objects == 1);
+        CHECK(stats.arrays == 1);
+        CHECK(stats.maxDepth == 2);
+        CHECK(stats.keyLookups == 4);
+        CHECK(stats.linearKeySearches == 2);
+        CHECK(stats.binaryKeySearches == 0);
+    }
+    else {
+        CHECK(stats.bytesRead == 0);
+        CHECK(stats.keyLookups == 0);
+    }
+}
+
+TEST_CASE("ast layout")
+{
+    if (HUSE_JSON_COMPACT_AST) {
+        CHECK(sizeof(huse::json::sajson::ast_word) == 4);
+    }
+    else {
+        CHECK(sizeof(huse::json::sajson::ast_word) == sizeof(size_t));
+    }
+
+    const std::string longStr(5000, 'x');
+    const std::string json = R"({"d":[0.5,-1e300,3.25],"i":[2147483647,-2147483648,9007199254740992],"s":")"
+        + longStr + R"("})";
+    huse::json::DeserializerRoot d(json);
+    auto obj = d.obj();
+    std::vector<double> ds;
+    obj.val("d", ds);
+    CHECK(ds == std::vector<double>{0.5, -1e300, 3.25});
+    std::vector<int64_t> is;
+    obj.val("i", is);
+    CHECK(is == std::vector<int64_t>{2147483647, -2147483648ll, 9007199254740992ll});
+    std::string s;
+    obj.val("s", s);
+    CHECK(s == longStr);
+}
+
+struct CacheTest {
+    int a = 0;
+    std::vector<int> b;
+    std::string s;
+    double d = 0;
+
+    void huseDeserialize(huse::DeserializerNode<huse::json::JsonDeserializer>& n) {
+        auto obj = n.obj();
+        obj.val("a", a);
+        obj.val("b", b);
+        obj.val("s", s);
+        obj.val("d", d);
+    }
+};
+
+TEST_CASE("document cache")
+{
+    const char* json = R"({"a": 5, "b": [1, 2, 3], "s": "x\ty\u00e9", "d": 2.5, "n": null})";
+
+    std::stringstream cache;
+    {
+        huse::json::Parser p(json);
+        huse::json::saveDocumentCache(p, cache);
+    }
+    const auto str = cache.str();
+
+    // ast_word-aligned copy
+    std::vector<huse::json::sajson::ast_word> buf(str.size() / sizeof(huse::json::sajson::ast_word) + 1);
+    memcpy(buf.data(), str.data(), str.size());
+
+    {
+        huse::json::DeserializerRoot d(huse::json::loadDocumentCache(buf.data(), str.size()));
+        CacheTest t;
+        d.val(t);
+        CHECK(t.a == 5);
+        CHECK(t.b == std::vector<int>{1, 2, 3});
+        CHECK(t.s == "x\ty\xc3\xa9");
+        CHECK(t.d == 2.5);
+    }
+
+    // truncated and corrupted
+    CHECK_THROWS_WITH_AS(huse::json::loadDocumentCache(buf.data(), str.size() - 1),
+        "invalid or incompatible document cache", huse::DeserializerException);
+    CHECK_THROWS_AS(huse::json::loadDocumentCache(buf.data(), 10), huse::DeserializerException);
+    buf[0] ^= 1;
+    CHECK_THROWS_AS(huse::json::loadDocumentCache(buf.data(), str.size()), huse::DeserializerException);
+
+    // lazy documents can't be cached
+    {
+        huse::json::Parser p(R"({"a": 5, "b": []})", {.lazy = true});
+        std::stringstream out;
+        CHECK_NOTHROW(huse::json::saveDocumentCache(p, out)); // empty containers aren't lazy
+        huse::json::Parser lp(R"({"a": [1]})", {.lazy = true});
+        CHECK_THROWS_AS(huse::json::saveDocumentCache(lp, out), huse::DeserializerException);
+    }
+
+    // mapped file
+    auto path = std::filesystem::temp_directory_path() / "huse-t-json-document-cache.bin";
+    {
+        std::ofstream fout(path, std::ios::binary);
+        fout.write(str.data(), std::streamsize(str.size()));
+    }
+    {
+        huse::json::MappedDocumentCache mapped(path.string().c_str());
+        CHECK(mapped.size() == str.size());
+        for (int i = 0; i < 2; ++i) {
+            huse::json::DeserializerRoot d(mapped.document());
+            CacheTest t;
+            d.val(t);
+            CHECK(t.a == 5);
+            CHECK(t.s == "x\ty\xc3\xa9");
+        }
+    }
+    std::filesystem::remove(path);
+
+    CHECK_THROWS_WITH_AS(huse::json::MappedDocumentCache(path.string().c_str()),
+        "document cache i/o error", huse::DeserializerException);
+}
+
+struct SharedViews {
+    std::shared_ptr<const huse::json::Parser> doc; // keeps the views alive
+    std::string_view name;
+    std::vector<std::string_view> tags;
+
+    void huseDeserialize(huse::DeserializerNode<huse::json::JsonDeserializer>& n) {
+        doc = n._d().sharedDocument();
+        auto obj = n.obj();
+        obj.val("name", name);
+        obj.val("tags", tags);
+    }
+};
+
+TEST_CASE("shared document")
+{
+    SharedViews sv;
+    {
+        auto doc = std::make_shared<const huse::json::Parser>(R"({"name": "n\u00e9", "tags": ["a", "b\nc"]})");
+        huse::json::DeserializerRoot d(doc);
+        CHECK(d.sharedDocument() == doc);
+        CHECK(&d.jsonParser() == doc.get());
+        d.val(sv);
+    }
+    // the root and the local handle are gone
+    CHECK(sv.doc.use_count() == 1);
+    CHECK(sv.name == "n\xc3\xa9");
+    CHECK(sv.tags == std::vector<std::string_view>{"a", "b\nc"});
+
+    {
+        huse::json::DeserializerRoot d(R"({"a": 1})");
+        CHECK_FALSE(d.sharedDocument());
+    }
+
+    // concurrent readers
+    {
+        std::string json = "[";
+        for (int i = 0; i < 1000; ++i) {
+            if (i) json += ',';
+            json += std::to_string(i);
+        }
+        json += ']';
+        auto doc = std::make_shared<const huse::json::Parser>(json);
+
+        std::vector<int> sums(4);
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < sums.size(); ++t) {
+            threads.emplace_back([&, t]() {
+                for (int r = 0; r < 10; ++r) {
+                    huse::json::DeserializerRoot d(doc);
+                    std::vector<int> vec;
+                    d.val(vec);
+                    int sum = 0;
+                    for (auto i : vec) sum += i;
+                    sums[t] = sum;
+                }
+            });
+        }
+        for (auto& t : threads) t.join();
+        for (auto sum : sums) CHECK(sum == 999 * 1000 / 2);
+    }
+
+    // lazy values can only be read if they have been parsed before sharing
+    {
+        auto doc = std::make_shared<huse::json::Parser>(R"({"a": [1], "b": [2]})", huse::json::ParseOptions{.lazy = true});
+        doc->parseLazyValue(doc->rootValue().get_value_of_key({"a", 1}));
+
+        std::shared_ptr<const huse::json::Parser> shared = doc;
+        huse::json::DeserializerRoot d(shared);
+        auto obj = d.obj();
+        std::vector<int> a;
+        obj.val("a", a);
+        CHECK(a == std::vector<int>{1});
+        std::vector<int> b;
+        auto ex = catchD([&]() { obj.val("b", b); });
+        CHECK(ex.code() == huse::ErrorCode::SharedLazy);
+        CHECK(ex.path() == "/b");
+    }
+}
+
+template <typename N>
+void writeDomTest(N& n)
+{
+    auto obj = n.obj();
+    obj.val("int", -42);
+    obj.val("big", 9007199254730992ull);
+    obj.val("i64", int64_t(-5000000000));
+    obj.val("dbl", 2.5);
+    obj.val("str", std::string_view("hello\n\"world\""));
+    obj.val("null", nullptr);
+    obj.val("t", true);
+    obj.val("f", false);
+    obj.val("skip", std::nullopt);
+    {
+        auto ar = obj.ar("ar");
+        ar.val(1);
+        ar.val("x");
+        ar.obj().val("in", 3);
+        ar.ar();
+        ar.val(nullptr);
+    }
+    obj.key("stream").open(huse::StringStream{}) << 1 << ' ' << 2;
+    {
+        auto big = obj.obj("big obj");
+        for (int i = 0; i < 150; ++i) {
+            big.val(("k" + std::to_string(149 - i)).c_str(), i);
+        }
+    }
+}
+
+struct DomTest
+{
+    int i = 0;
+    uint64_t big = 0;
+    int64_t i64 = 0;
+    double dbl = 0;
+    std::string str;
+    bool t = false, f = true, null = false, hasSkip = true;
+    std::vector<int> arInts;
+    std::string arStr;
+    int in = 0;
+    size_t arSize = 0;
+    std::string stream;
+    std::vector<int> bigVals;
+
+    void huseDeserialize(huse::DeserializerNode<huse::json::JsonDeserializer>& n)
+    {
+        auto obj = n.obj();
+        obj.val("int", i);
+        obj.val("big", big);
+        obj.val("i64", i64);
+        obj.val("dbl", dbl);
+        obj.val("str", str);
+        null = obj.key("null").type().isNull();
+        obj.val("t", t);
+        obj.val("f", f);
+        hasSkip = !!obj.optkey("skip");
+        {
+            auto ar = obj.ar("ar");
+            arSize = size_t(ar.size());
+            int x;
+            ar.val(x);
+            arInts.push_back(x);
+            ar.val(arStr);
+            ar.obj().val("in", in);
+            arInts.push_back(ar.ar().size());
+        }
+        obj.val("stream", stream);
+        {
+            auto big = obj.obj("big obj");
+            for (int k = 0; k < 150; ++k) {
+                int v;
+                big.val(("k" + std::to_string(k)).c_str(), v);
+                bigVals.push_back(v);
+            }
+        }
+    }
+};
+
+bool operator==(const DomTest& a, const DomTest& b)
+{
+    return a.i == b.i && a.big == b.big && a.i64 == b.i64 && a.dbl == b.dbl && a.str == b.str
+        && a.t == b.t && a.f == b.f && a.null == b.null && a.hasSkip == b.hasSkip
+        && a.arInts == b.arInts && a.arStr == b.arStr && a.in == b.in && a.arSize == b.arSize
+        && a.stream == b.stream && a.bigVals == b.bigVals;
+}
+
+TEST_CASE("dom serializer")
+{
+    JsonSerializeTester j;
+    {
+        auto root = j.compact();
+        writeDomTest(root);
+    }
+    DomTest fromText;
+    {
+        auto d = makeD(j.str());
+        d.val(fromText);
+    }
+
+    huse::json::DomSerializerRoot s;
+    writeDomTest(s);
+
+    DomTest fromDom;
+    {
+        huse::json::DeserializerRoot d(s.releaseDocument());
+        d.val(fromDom);
+    }
+
+    CHECK(fromDom == fromText);
+    CHECK(fromDom.i == -42);
+    CHECK(fromDom.big == 9007199254730992ull);
+    CHECK(fromDom.str == "hello\n\"world\"");
+    CHECK(fromDom.null);
+    CHECK(!fromDom.hasSkip);
+    CHECK(fromDom.arSize == 5);
+    CHECK(fromDom.stream == "1 2");
+    CHECK(fromDom.bigVals[0] == 149);
+
+    // the serializer can be reused
+    s.ar().val(5);
+    {
+        huse::json::DeserializerRoot d(s.releaseDocument());
+        std::vector<int> vec;
+        d.val(vec);
+        CHECK(vec == std::vector<int>{5});
+    }
+
+    // limits are the same as the ones of json text
+    {
+        huse::json::DomSerializerRoot e;
+        auto ar = e.ar();
+        CHECK_THROWS_WITH_AS(ar.val(std::numeric_limits<double>::infinity()), "Floating point value is not finite. Not supported by JSON", huse::SerializerException);
+        CHECK_THROWS_WITH_AS(ar.val(std::numeric_limits<uint64_t>::max()), "Integer value is bigger than maximum allowed for JSON", huse::SerializerException);
+    }
+
+    // only objects and arrays can be roots
+    {
+        huse::json::DomSerializerRoot e;
+        CHECK_THROWS_AS(e.val(5), huse::SerializerException);
+        CHECK_THROWS_AS(e.releaseDocument(), huse::SerializerException);
+    }
+}